@@ -1,9 +1,11 @@
 #include "application.h"
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 #include <vector>
 #include <codecvt>
 #include <fstream>
-#include <map>
 
 #if defined(_MSC_VER)
 #pragma warning(push)
@@ -24,18 +26,39 @@
 #include <GLFW/glfw3.h>
 
 #include "graphics/graphics.h"
-#include "noise.h"
+#include "mesh-cache.h"
+#include "mesh.h"
+#include "software-shaders.h"
 
 namespace {
 
 constexpr float kMinScale = 0.2f;
 constexpr float kPi = 3.14159265358979323846f;
 
-template<typename T, uint32_t kSize>
-constexpr uint32_t array_length(T (&)[kSize])
-{
-    return kSize;
-}
+#if defined(_DEBUG)
+constexpr unsigned int kNumAsteroidMeshes = 20;
+#else
+constexpr unsigned int kNumAsteroidMeshes = 1000;
+#endif
+/// Fixed so the generated meshes can be cached between runs
+constexpr unsigned int kAsteroidMeshSeed = 0x5eed1234;
+constexpr char kMeshCacheFilename[] = "asteroid-meshes.cache";
+
+/// Levels of the geosphere each asteroid is displaced from; only the most
+/// detailed one is drawn, the coarser ones are simplified from it
+constexpr unsigned int kNumSubdivLevels = 4;
+/// Share of the most detailed level's triangles kept by each simplified level
+/// of detail, coarsest first
+constexpr float kLodTriangleRatios[] = {1.0f / 64.0f, 1.0f / 16.0f, 1.0f / 4.0f};
+constexpr unsigned int kNumSimplifiedLods =
+    sizeof(kLodTriangleRatios) / sizeof(kLodTriangleRatios[0]);
+/// Largest simplification error, in pixels, of a level of detail to draw
+constexpr float kMaxLodPixelError = 1.0f;
+/// The simplified levels of detail of a mesh, and its full detail
+constexpr unsigned int kLevelsPerMesh = kNumSimplifiedLods + 1;
+/// Most render pass command buffers a frame is recorded into, leaving the
+/// rest of the pool to the frames in flight
+constexpr size_t kMaxRecordChunks = 32;
 
 std::string get_executable_directory()
 {
@@ -56,6 +79,9 @@ std::string get_executable_directory()
 std::string get_absolute_path(char const* const filename)
 {
     auto const exe_dir = get_executable_directory();
+    if (exe_dir.empty()) {
+        return filename;  // relative to the working directory
+    }
     return exe_dir + "/" + std::string(filename);
 }
 
@@ -74,255 +100,13 @@ std::vector<uint8_t> get_file_contents(char const* const filename)
     return contents;
 }
 
-//
-// Meshes
-//
-struct Mesh
-{
-    using IndexType = uint16_t;
-
-    struct Edge
-    {
-        Edge(IndexType i0, IndexType i1)
-            : v0(i0)
-            , v1(i1)
-        {
-            if (v0 > v1) {
-                std::swap(v0, v1);
-            }
-        }
-        IndexType v0;
-        IndexType v1;
-
-        bool operator<(const Edge& c) const { return v0 < c.v0 || (v0 == c.v0 && v1 < c.v1); }
-    };
-
-    struct Vertex
-    {
-        mathfu::float3 pos;
-        mathfu::float3 norm;
-    };
-
-    std::vector<Vertex> vertices;
-    std::vector<IndexType> indices;
-
-    void spherify(float const radius)
-    {
-        for (auto& v : vertices) {
-            float const n =
-                radius / std::sqrt(v.pos.x * v.pos.x + v.pos.y * v.pos.y + v.pos.z * v.pos.z);
-            v.pos.x *= n;
-            v.pos.y *= n;
-            v.pos.z *= n;
-        }
-    }
-    void bumpify()
-    {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-
-        std::uniform_real_distribution<float> random_noise(0.0f, 10000.0f);
-        std::normal_distribution<float> random_persistence(0.95f, 0.04f);
-        float const noise_scale = 0.5f;
-        float const radius_scale = 0.9f;
-        float const radius_bias = 0.3f;
-
-        NoiseOctaves<4> const texture_noise(random_persistence(gen));
-        float const noise = random_noise(gen);
-
-        for (auto& v : vertices) {
-            float radius = texture_noise(v.pos.x * noise_scale, v.pos.y * noise_scale,
-                                         v.pos.z * noise_scale, noise);
-            radius = radius * radius_scale + radius_bias;
-            v.pos *= radius;
-        }
-    }
-    void subdivide()
-    {
-        std::map<Edge, IndexType> midpoints;
-        auto const add_midpoint = [&](Edge const& edge) -> IndexType {
-            auto const found = midpoints.find(edge);
-            if (found != midpoints.end()) {
-                return found->second;
-            }
-
-            auto const& p0 = vertices[edge.v0].pos;
-            auto const& p1 = vertices[edge.v1].pos;
-
-            Vertex const mid = {{
-                (p0 + p1) * 0.5f,
-            }};
-
-            IndexType const new_index = static_cast<IndexType>(vertices.size());
-            vertices.push_back(mid);
-            midpoints[edge] = new_index;
-            return new_index;
-        };
-
-        std::vector<IndexType> new_indices;
-        new_indices.reserve(indices.size());
-
-        for (size_t ii = 0; ii < indices.size(); ii += 3) {
-            auto& i0 = indices[ii + 0];
-            auto& i1 = indices[ii + 1];
-            auto& i2 = indices[ii + 2];
-
-            auto const m0 = add_midpoint(Edge(i0, i1));
-            auto const m1 = add_midpoint(Edge(i1, i2));
-            auto const m2 = add_midpoint(Edge(i2, i0));
-
-            IndexType const updated_indices[] = {
-                i0, m0, m2, m0, i1, m1, m0, m1, m2, m2, m1, i2,
-            };
-            new_indices.insert(new_indices.end(), updated_indices,
-                               updated_indices + array_length(updated_indices));
-        }
-
-        std::swap(indices, new_indices);
-    }
-    void calculate_normals()
-    {
-        for (auto& v : vertices) {
-            v.norm = {0, 0, 0};
-        }
-
-        assert(indices.size() % 3 == 0);  // trilist
-        for (size_t ii = 0; ii < indices.size(); ii += 3) {
-            auto& v0 = vertices[indices[ii + 0]];
-            auto& v1 = vertices[indices[ii + 1]];
-            auto& v2 = vertices[indices[ii + 2]];
-
-            // Two edge vectors u,v
-            auto const u = v1.pos - v0.pos;
-            auto const v = v2.pos - v0.pos;
-
-            // cross(u,v)
-            auto const n = mathfu::float3::CrossProduct(u, v);
-
-            // Add them all together
-            v0.norm += n;
-            v1.norm += n;
-            v2.norm += n;
-        }
-
-        // Normalize
-        for (auto& v : vertices) {
-            v.norm.Normalize();
-        }
-    }
-
-    static Mesh icosahedron()
-    {
-        float const a = std::sqrt(2.0f / (5.0f - std::sqrt(5.0f)));
-        float const b = std::sqrt(2.0f / (5.0f + std::sqrt(5.0f)));
-        // clang-format off
-        Mesh const mesh = {
-            {
-                { {-b,  a,  0}, },
-                { { b,  a,  0}, },
-                { {-b, -a,  0}, },
-                { { b, -a,  0}, },
-                { { 0, -b,  a}, },
-                { { 0,  b,  a}, },
-                { { 0, -b, -a}, },
-                { { 0,  b, -a}, },
-                { { a,  0, -b}, },
-                { { a,  0,  b}, },
-                { {-a,  0, -b}, },
-                { {-a,  0,  b}, },
-            },
-            {
-                 0,  5, 11,
-                 0,  1,  5,
-                 0,  7,  1,
-                 0, 10,  7,
-                 0, 11, 10,
-                 1,  9,  5,
-                 5,  4, 11,
-                11,  2, 10,
-                10,  6,  7,
-                 7,  8,  1,
-                 3,  4,  9,
-                 3,  2,  4,
-                 3,  6,  2,
-                 3,  8,  6,
-                 3,  9,  8,
-                 4,  5,  9,
-                 2, 11,  4,
-                 6, 10,  2,
-                 8,  7,  6,
-                 9,  1,  8,
-            },
-        };
-        // clang-format on
-        return mesh;
-    }
-    static Mesh cube()
-    {
-        // clang-format off
-        Mesh const mesh = {
-            {
-                { { -0.5f,  0.5f, -0.5f }, {  0.0f,  1.0f,  0.0f } },
-                { {  0.5f,  0.5f, -0.5f }, {  0.0f,  1.0f,  0.0f } },
-                { {  0.5f,  0.5f,  0.5f }, {  0.0f,  1.0f,  0.0f } },
-                { { -0.5f,  0.5f,  0.5f }, {  0.0f,  1.0f,  0.0f } },
-
-                { { -0.5f, -0.5f, -0.5f }, {  0.0f, -1.0f,  0.0f } },
-                { {  0.5f, -0.5f, -0.5f }, {  0.0f, -1.0f,  0.0f } },
-                { {  0.5f, -0.5f,  0.5f }, {  0.0f, -1.0f,  0.0f } },
-                { { -0.5f, -0.5f,  0.5f }, {  0.0f, -1.0f,  0.0f } },
-
-                { { -0.5f, -0.5f,  0.5f }, { -1.0f,  0.0f,  0.0f } },
-                { { -0.5f, -0.5f, -0.5f }, { -1.0f,  0.0f,  0.0f } },
-                { { -0.5f,  0.5f, -0.5f }, { -1.0f,  0.0f,  0.0f } },
-                { { -0.5f,  0.5f,  0.5f }, { -1.0f,  0.0f,  0.0f } },
-
-                { {  0.5f, -0.5f,  0.5f }, {  1.0f,  0.0f,  0.0f } },
-                { {  0.5f, -0.5f, -0.5f }, {  1.0f,  0.0f,  0.0f } },
-                { {  0.5f,  0.5f, -0.5f }, {  1.0f,  0.0f,  0.0f } },
-                { {  0.5f,  0.5f,  0.5f }, {  1.0f,  0.0f,  0.0f } },
-
-                { { -0.5f, -0.5f, -0.5f }, {  0.0f,  0.0f, -1.0f } },
-                { {  0.5f, -0.5f, -0.5f }, {  0.0f,  0.0f, -1.0f } },
-                { {  0.5f,  0.5f, -0.5f }, {  0.0f,  0.0f, -1.0f } },
-                { { -0.5f,  0.5f, -0.5f }, {  0.0f,  0.0f, -1.0f } },
-
-                { { -0.5f, -0.5f,  0.5f }, {  0.0f,  0.0f,  1.0f } },
-                { {  0.5f, -0.5f,  0.5f }, {  0.0f,  0.0f,  1.0f } },
-                { {  0.5f,  0.5f,  0.5f }, {  0.0f,  0.0f,  1.0f } },
-                { { -0.5f,  0.5f,  0.5f }, {  0.0f,  0.0f,  1.0f } },
-            },
-            {
-                3,1,0,
-                2,1,3,
-
-                6,4,5,
-                7,4,6,
-
-                11,9,8,
-                10,9,11,
-
-                14,12,13,
-                15,12,14,
-
-                19,17,16,
-                18,17,19,
-
-                22,20,21,
-                23,20,22,
-            },
-        };
-        // clang-format on
-        return mesh;
-    }
-};
-
 }  // anonymous namespace
 
-Application::Application(void* native_window, void* native_instance)
+Application::Application(void* native_window, void* native_instance, Config const& config)
     : _window(native_window)
     , _instance(native_instance)
-    , _graphics(ak::create_graphics(ak::Graphics::kDefault))
+    , _graphics(ak::create_graphics(config.api))
+    , _jobs(config.num_threads)
 {
     bool const result = _graphics->create_swap_chain(_window, _instance);
     assert(result && "Could not create swap chain");
@@ -330,20 +114,85 @@ Application::Application(void* native_window, void* native_instance)
     //
     // Create resources
     //
-    auto mesh = Mesh::icosahedron();
-    mesh.subdivide();
-    mesh.subdivide();
-    mesh.spherify(1.0f);
-    mesh.bumpify();
-    mesh.calculate_normals();
-    auto const index_count = static_cast<uint32_t>(mesh.indices.size());
-    auto const vertex_count = static_cast<uint32_t>(mesh.vertices.size());
-    _cube_model.vertex_buffer =
-        _graphics->create_vertex_buffer(vertex_count * sizeof(mesh.vertices[0]),
-                                        mesh.vertices.data());
-    _cube_model.index_buffer =
-        _graphics->create_index_buffer(index_count * sizeof(mesh.indices[0]), mesh.indices.data());
-    _cube_model.index_count = index_count;
+    std::random_device rd;
+
+    // Asteroid meshes are used straight from the mapped cache file when it
+    // was generated with the same parameters, otherwise generated and cached
+    auto const cache_path = get_absolute_path(kMeshCacheFilename);
+    auto const cache_key = asteroid_mesh_cache_key(
+        kNumSubdivLevels - 1, kNumAsteroidMeshes, kAsteroidMeshSeed, AsteroidNoiseParams(),
+        kLodTriangleRatios, kNumSimplifiedLods);
+    MeshCache cache;
+    if (config.mesh_cache) {
+        cache = MeshCache(cache_path.c_str(), cache_key);
+    }
+    PackedMesh generated;
+    MeshCacheView mesh = cache.mesh();
+    _asteroid_model.lod_index_offsets.resize(kNumSubdivLevels + 1);
+    if (cache.valid()) {
+        assert(mesh.subdiv_offset_count == _asteroid_model.lod_index_offsets.size());
+        std::copy(mesh.subdiv_index_offsets, mesh.subdiv_index_offsets + mesh.subdiv_offset_count,
+                  _asteroid_model.lod_index_offsets.begin());
+    } else {
+        CreateAsteroidsFromGeospheres(&generated, kNumSubdivLevels - 1, kNumAsteroidMeshes,
+                                      kAsteroidMeshSeed, _asteroid_model.lod_index_offsets.data(),
+                                      &mesh.vertices_per_mesh, &_jobs);
+        SimplifyAsteroidLods(&generated, kNumSubdivLevels - 1,
+                             _asteroid_model.lod_index_offsets.data(), mesh.vertices_per_mesh,
+                             kLodTriangleRatios, kNumSimplifiedLods, &_jobs);
+        // Past the simplified levels, only full detail is drawn
+        DropCoarseGeosphereLevels(&generated, kNumSubdivLevels - 1,
+                                  _asteroid_model.lod_index_offsets.data(),
+                                  &mesh.vertices_per_mesh);
+        mesh.vertices = generated.vertices.data();
+        mesh.vertex_count = generated.vertices.size();
+        mesh.indices = generated.indices.data();
+        mesh.index_count = generated.indices.size();
+        mesh.subdiv_index_offsets = _asteroid_model.lod_index_offsets.data();
+        mesh.subdiv_offset_count = _asteroid_model.lod_index_offsets.size();
+        mesh.position_scales = generated.positionScales.data();
+        mesh.mesh_count = generated.positionScales.size();
+        mesh.meshlets = generated.meshlets.data();
+        mesh.meshlet_count = generated.meshlets.size();
+        mesh.meshlet_bounds = generated.meshletBounds.data();
+        mesh.lod_index_offsets = generated.lodIndexOffsets.data();
+        mesh.lod_errors = generated.lodErrors.data();
+        mesh.lod_count = kNumSimplifiedLods;
+        mesh.bounding_radius = 0.0f;
+        for (size_t ii = 0; ii < mesh.vertex_count; ++ii) {
+            auto const& v = generated.vertices[ii];
+            float const x = static_cast<float>(v.x);
+            float const y = static_cast<float>(v.y);
+            float const z = static_cast<float>(v.z);
+            float const scale = mesh.position_scales[ii / mesh.vertices_per_mesh] / 32767.0f;
+            mesh.bounding_radius =
+                std::max(mesh.bounding_radius, std::sqrt(x * x + y * y + z * z) * scale);
+        }
+        if (config.mesh_cache) {
+            // failing to write (e.g. a read-only directory) only costs the
+            // next run a regeneration
+            MeshCache::write(cache_path.c_str(), cache_key, mesh);
+        }
+    }
+    _asteroid_model.vertices_per_mesh = mesh.vertices_per_mesh;
+    _asteroid_model.bounding_radius = mesh.bounding_radius;
+    _asteroid_model.position_scales.assign(mesh.position_scales,
+                                           mesh.position_scales + mesh.mesh_count);
+    _asteroid_model.meshlets.assign(mesh.meshlets, mesh.meshlets + mesh.meshlet_count);
+    _asteroid_model.meshlet_bounds.assign(
+        mesh.meshlet_bounds, mesh.meshlet_bounds + mesh.meshlet_count * mesh.mesh_count);
+    // The simplified levels follow the shared levels in the index buffer
+    assert(mesh.lod_count == kNumSimplifiedLods);
+    size_t const simplified_count = size_t(mesh.lod_count) * mesh.mesh_count;
+    _asteroid_model.simplified_index_offsets.assign(
+        mesh.lod_index_offsets, mesh.lod_index_offsets + simplified_count + 1);
+    _asteroid_model.simplified_errors.assign(mesh.lod_errors, mesh.lod_errors + simplified_count);
+    _asteroid_model.vertex_buffer = _graphics->create_vertex_buffer(
+        static_cast<uint32_t>(mesh.vertex_count * sizeof(PackedVertex)), mesh.vertices);
+    static_assert(sizeof(IndexType) == sizeof(uint16_t), "index buffer format must match");
+    _asteroid_model.index_buffer = _graphics->create_index_buffer(
+        static_cast<uint32_t>(mesh.index_count * sizeof(IndexType)), mesh.indices,
+        ak::IndexFormat::kUInt16);
 
     // Render state
     std::vector<uint8_t> vs_bytecode;
@@ -360,15 +209,30 @@ Application::Application(void* native_window, void* native_instance)
         case ak::Graphics::kMetal:
             // TODO: Load shaders (from DefaultLibrary or as file like Vk/D3D?)
             break;
+        case ak::Graphics::kSoftware: {
+            auto const* const vs = reinterpret_cast<uint8_t const*>(&kSimpleVertexShader);
+            auto const* const ps = reinterpret_cast<uint8_t const*>(&kSimplePixelShader);
+            vs_bytecode.assign(vs, vs + sizeof(kSimpleVertexShader));
+            ps_bytecode.assign(ps, ps + sizeof(kSimplePixelShader));
+            break;
+        }
         default:
             break;
     }
+    // PackedVertex: snorm position and octahedral normal, decoded in the vertex
+    // shader; and per instance, PerInstanceData
     ak::InputLayout const input_layout[] = {
         {
-            "POSITION", 0, 3,
+            "POSITION", 0, ak::VertexFormat::kSnorm16x4, ak::InputRate::kPerVertex,
+        },
+        {
+            "COLOR", 1, ak::VertexFormat::kSnorm16x2, ak::InputRate::kPerVertex,
         },
         {
-            "COLOR", 1, 3,
+            "ORIENTATION", 2, ak::VertexFormat::kFloat4, ak::InputRate::kPerInstance,
+        },
+        {
+            "POSITION_SCALE", 3, ak::VertexFormat::kFloat4, ak::InputRate::kPerInstance,
         },
         ak::kEndLayout,
     };
@@ -384,7 +248,6 @@ Application::Application(void* native_window, void* native_instance)
     };
 
     // initialize asteroids
-    std::random_device rd;
     std::mt19937 gen(rd());
 
     std::normal_distribution<float> scale_dist(1.3f, 0.7f);
@@ -395,24 +258,32 @@ Application::Application(void* native_window, void* native_instance)
     std::uniform_real_distribution<float> angle_dist(-kPi, kPi);
     std::normal_distribution<float> spin_axis_dist;
 
-    for (auto& asteroid : _asteroids) {
+    // An empty field if it does not fit in memory
+    bool const allocated = _asteroids.allocate(config.num_asteroids, config.large_pages);
+    assert(allocated && "Could not allocate the asteroid field");
+    (void)allocated;
+    for (size_t ii = 0; ii < _asteroids.size(); ++ii) {
         auto const scale = std::max(scale_dist(gen), kMinScale);
         auto const orbit_radius = orbit_dist(gen);
         auto const position_angle = angle_dist(gen);
         auto const height = kSimDiscRadius * height_dist(gen);
 
-        asteroid.spin_axis =
+        auto const spin_axis =
             mathfu::float3(spin_axis_dist(gen), spin_axis_dist(gen), spin_axis_dist(gen))
                 .Normalized();
-        asteroid.spin_velocity = spin_velocity_dist(gen) / scale;
-        asteroid.scale = scale;
-        asteroid.orbit_velocity = -radial_velocity_dist(gen) / (scale * orbit_radius);
-        assert(asteroid.orbit_velocity < 0.0f);
-
-        asteroid.world =
-            mathfu::float4x4::FromRotationMatrix(mathfu::float4x4::RotationY(position_angle)) *
-            mathfu::float4x4::FromTranslationVector({orbit_radius, height, 0.0f}) *
-            mathfu::float4x4::FromScaleVector({scale, scale, scale});
+        _asteroids.spin_axis[0][ii] = spin_axis.x;
+        _asteroids.spin_axis[1][ii] = spin_axis.y;
+        _asteroids.spin_axis[2][ii] = spin_axis.z;
+        _asteroids.spin_velocity[ii] = spin_velocity_dist(gen) / scale;
+        _asteroids.scale[ii] = scale;
+        _asteroids.orbit_velocity[ii] = -radial_velocity_dist(gen) / (scale * orbit_radius);
+        assert(_asteroids.orbit_velocity[ii] < 0.0f);
+
+        // RotationY(angle) * Translation(radius, height, 0) * Scale(scale)
+        auto const orbit_rotation =
+            mathfu::Quaternion<float>::FromAngleAxis(position_angle, {0.0f, 1.0f, 0.0f});
+        _asteroids.set_transform(ii, orbit_rotation * mathfu::float3(orbit_radius, height, 0.0f),
+                                 orbit_rotation, scale);
     }
 }
 
@@ -461,62 +332,333 @@ void Application::on_frame(float const delta_time)
     recalculate_camera();
     _cursor_delta = {0, 0};
 
+    auto const isa = simd::best_instruction_set();
+    auto const count = _asteroids.size();
+    auto const chunk_size = _jobs.chunk_size(count, sizeof(float));
+
     // update
     if (_simulate) {
-        for (auto& asteroid : _asteroids) {
-            auto const orbit = mathfu::float4x4::FromRotationMatrix(
-                mathfu::float4x4::RotationY(asteroid.orbit_velocity * delta_time));
-            auto const spin =
-                mathfu::Quaternion<float>::FromAngleAxis(asteroid.spin_velocity * delta_time,
-                                                         asteroid.spin_axis)
-                    .ToMatrix4();
-            asteroid.world = orbit * asteroid.world * spin;
+        auto const start = std::chrono::high_resolution_clock::now();
+
+        if (_closed_form) {
+            _simulation_clock += delta_time;
+            // Restart the clock before it loses precision. The new initial
+            // state is evaluated from the old one, so it does not matter that
+            // most orientations are not current.
+            if (_simulation_clock > kSimRebaseInterval) {
+                float const interval = _simulation_clock;
+                _jobs.parallel_for(count, chunk_size, [&](size_t const begin, size_t const end) {
+                    _asteroids.rebase(interval, isa, begin, end);
+                });
+                _simulation_clock = 0.0f;
+            }
+            // Culling only needs the positions; record_instances evaluates
+            // the orientations of the asteroids it draws
+            float const clock = _simulation_clock;
+            _jobs.parallel_for(count, chunk_size, [&](size_t const begin, size_t const end) {
+                _asteroids.evaluate_positions(clock, isa, begin, end);
+            });
+        } else {
+            _jobs.parallel_for(count, chunk_size, [&](size_t const begin, size_t const end) {
+                _asteroids.update(delta_time, isa, begin, end);
+            });
         }
+
+        auto const end = std::chrono::high_resolution_clock::now();
+        _frame_timings.simulate = std::chrono::duration<float>(end - start).count();
+        _frame_timings.simulation_bytes =
+            count * (_closed_form ? AsteroidField::kEvaluatePositionsBytesPerAsteroid
+                                  : AsteroidField::kUpdateBytesPerAsteroid);
+    } else {
+        _frame_timings.simulate = 0.0f;
+        _frame_timings.simulation_bytes = 0;
     }
 
-    // render
-    auto const ps_const_buffer = _graphics->get_upload_data<PSConstantBuffer>();
-    if (ps_const_buffer) {
-        ps_const_buffer->color = {1, 1, 1, 1};
+    // cull, and pick each visible asteroid's level of detail. The asteroids
+    // are grouped by mesh and level, so each group is one instanced draw.
+    // Group `mesh * kLevelsPerMesh + level` is simplified level `level` of
+    // `mesh`, or its full detail for level kNumSimplifiedLods.
+    auto const cull_start = std::chrono::high_resolution_clock::now();
+    // projected error in pixels = error * scale * pixels_per_unit / distance
+    float const pixels_per_unit =
+        std::abs(_constant_buffer.projection(1, 1)) * 0.5f * static_cast<float>(_height);
+    auto const& simplified_errors = _asteroid_model.simplified_errors;
+    _visible.resize(count);
+    _instance_groups.resize(count);
+    // parallel_for may run everything as a single range, so chunks it does not
+    // visit must read as empty
+    _visible_counts.assign((count + chunk_size - 1) / chunk_size, 0);
+    _jobs.parallel_for(count, chunk_size, [&](size_t const begin, size_t const end) {
+        uint32_t* const visible = _visible.data() + begin;
+        size_t const visible_count =
+            _asteroids.cull(_constant_buffer.viewproj, _asteroid_model.bounding_radius, isa, begin,
+                            end, visible);
+        for (size_t ii = 0; ii < visible_count; ++ii) {
+            auto const index = visible[ii];
+            auto const mesh = index % kNumAsteroidMeshes;
+            float const dx = _asteroids.position[0][index] - _cam_position.x;
+            float const dy = _asteroids.position[1][index] - _cam_position.y;
+            float const dz = _asteroids.position[2][index] - _cam_position.z;
+            float const pixels = _asteroids.scale[index] * pixels_per_unit / kMaxLodPixelError;
+            // squared pixels per mesh unit, relative to the largest error allowed
+            float const error_scale_sq = pixels * pixels / (dx * dx + dy * dy + dz * dz);
+
+            // The coarsest simplified level that is accurate enough; the
+            // errors never grow from coarse to fine
+            unsigned int const first_lod = mesh * kNumSimplifiedLods;
+            unsigned int level = 0;
+            for (; level < kNumSimplifiedLods; ++level) {
+                float const error = simplified_errors[first_lod + level];
+                if (error * error * error_scale_sq <= 1.0f) {
+                    break;
+                }
+            }
+            _instance_groups[begin + ii] = mesh * kLevelsPerMesh + level;
+        }
+        _visible_counts[begin / chunk_size] = visible_count;
+    });
+    size_t visible_count = 0;
+    for (auto const chunk_count : _visible_counts) {
+        visible_count += chunk_count;
     }
+    _frame_timings.visible = visible_count;
+
+    // render
+    auto const record_start = std::chrono::high_resolution_clock::now();
+    _frame_timings.cull = std::chrono::duration<float>(record_start - cull_start).count();
 
     auto* const command_buffer = _graphics->command_buffer();
     if (command_buffer != nullptr) {
-        command_buffer->begin_render_pass();
-        command_buffer->set_render_state(_render_state.get());
-        command_buffer->set_vertex_buffer(_cube_model.vertex_buffer.get());
-        command_buffer->set_index_buffer(_cube_model.index_buffer.get());
-        command_buffer->set_pixel_constant_data(ps_const_buffer, sizeof(*ps_const_buffer));
+        auto* const ps_const_buffer = _graphics->get_upload_data<PSConstantBuffer>();
+        if (ps_const_buffer != nullptr) {
+            ps_const_buffer->color = {1, 1, 1, 1};
+        }
 
         // set per-frame constants
         auto* const vs_const_buffer = _graphics->get_upload_data<PerFrameConstants>();
         if (vs_const_buffer != nullptr) {
             *vs_const_buffer = _constant_buffer;
         }
-        command_buffer->set_vertex_constant_data(0, vs_const_buffer, sizeof(*vs_const_buffer));
 
-        for (auto& asteroid : _asteroids) {
-            auto* const model_buffer = _graphics->get_upload_data<PerModelConstants>();
-            if (model_buffer != nullptr) {
-                model_buffer->world = asteroid.world;
+        _group_offsets.assign(kNumAsteroidMeshes * kLevelsPerMesh + 1, 0);
+        for (size_t chunk = 0; chunk < _visible_counts.size(); ++chunk) {
+            uint32_t const* const groups = _instance_groups.data() + chunk * chunk_size;
+            for (size_t ii = 0; ii < _visible_counts[chunk]; ++ii) {
+                ++_group_offsets[groups[ii] + 1];
             }
+        }
+        for (size_t group = 1; group < _group_offsets.size(); ++group) {
+            _group_offsets[group] += _group_offsets[group - 1];
+        }
 
-            command_buffer->set_vertex_constant_data(1, model_buffer, sizeof(*model_buffer));
-            command_buffer->draw_indexed(_cube_model.index_count);
+        // Give each asteroid its place in its group's run of instances
+        _instance_asteroids.resize(visible_count);
+        _group_ends.assign(_group_offsets.begin(), _group_offsets.end() - 1);
+        for (size_t chunk = 0; chunk < _visible_counts.size(); ++chunk) {
+            size_t const first = chunk * chunk_size;
+            for (size_t ii = first; ii < first + _visible_counts[chunk]; ++ii) {
+                _instance_asteroids[_group_ends[_instance_groups[ii]]++] = _visible[ii];
+            }
         }
 
-        command_buffer->end_render_pass();
+        // Record the instances in runs, each into its own render pass command
+        // buffer on whichever thread picks it up, and run the buffers in order.
+        // With fewer buffers free than runs the runs are made longer, and with
+        // none free this buffer records all of them itself.
+        size_t record_chunk_size =
+            std::max(_jobs.chunk_size(visible_count, sizeof(PerInstanceData)),
+                     (visible_count + kMaxRecordChunks - 1) / kMaxRecordChunks);
+        _pass_command_buffers.clear();
+        while (_pass_command_buffers.size() * record_chunk_size < visible_count) {
+            auto* const pass_command_buffer = _graphics->render_pass_command_buffer();
+            if (pass_command_buffer == nullptr) {
+                break;
+            }
+            _pass_command_buffers.push_back(pass_command_buffer);
+        }
+        MeshletCuller const meshlet_culler(_constant_buffer.viewproj, _cam_position);
+        if (_pass_command_buffers.empty() && visible_count > 0) {
+            _record_chunks.resize(1);
+            _record_chunks[0].command_buffer = command_buffer;
+            if (command_buffer->begin_render_pass()) {
+                record_instances(0, visible_count, meshlet_culler, ps_const_buffer,
+                                 vs_const_buffer, &_record_chunks[0]);
+                command_buffer->end_render_pass();
+            }
+        } else {
+            if (_pass_command_buffers.size() * record_chunk_size < visible_count) {
+                record_chunk_size = (visible_count + _pass_command_buffers.size() - 1) /
+                                    _pass_command_buffers.size();
+            }
+            // Buffers past the last run are run empty
+            _record_chunks.resize((visible_count + record_chunk_size - 1) / record_chunk_size);
+            for (size_t chunk = 0; chunk < _record_chunks.size(); ++chunk) {
+                _record_chunks[chunk].command_buffer = _pass_command_buffers[chunk];
+            }
+            _jobs.parallel_for(
+                visible_count, record_chunk_size, [&](size_t const begin, size_t const end) {
+                    // parallel_for may run several chunks as a single range
+                    for (size_t first = begin; first < end; first += record_chunk_size) {
+                        record_instances(first, std::min(end, first + record_chunk_size),
+                                         meshlet_culler, ps_const_buffer, vs_const_buffer,
+                                         &_record_chunks[first / record_chunk_size]);
+                    }
+                });
+            command_buffer->execute_render_pass(_pass_command_buffers.data(),
+                                                _pass_command_buffers.size());
+        }
+
+        size_t triangles = 0;
+        size_t draws = 0;
+        for (auto const& chunk : _record_chunks) {
+            triangles += chunk.triangles;
+            draws += chunk.draw_arguments.size();
+        }
+        _frame_timings.draws = draws;
+        _frame_timings.triangles = triangles;
+        _frame_timings.command_buffers = _pass_command_buffers.size();
+    }
+
+    auto const submit_start = std::chrono::high_resolution_clock::now();
+    if (command_buffer != nullptr) {
         auto const result = _graphics->execute(command_buffer);
         assert(result);
     }
 
     _graphics->present();
+    auto const submit_end = std::chrono::high_resolution_clock::now();
+    _frame_timings.record = std::chrono::duration<float>(submit_start - record_start).count();
+    _frame_timings.submit = std::chrono::duration<float>(submit_end - submit_start).count();
+}
+
+void Application::record_instances(size_t const begin, size_t const end,
+                                   MeshletCuller const& meshlet_culler,
+                                   PSConstantBuffer const* const ps_constants,
+                                   PerFrameConstants const* const vs_constants,
+                                   RecordChunk* const chunk)
+{
+    chunk->draw_arguments.clear();
+    chunk->triangles = 0;
+    auto* const command_buffer = chunk->command_buffer;
+    command_buffer->set_render_state(_render_state.get());
+    command_buffer->set_vertex_buffer(_asteroid_model.vertex_buffer.get());
+    command_buffer->set_index_buffer(_asteroid_model.index_buffer.get());
+    command_buffer->set_pixel_constant_data(ps_constants, sizeof(*ps_constants));
+    command_buffer->set_vertex_constant_data(0, vs_constants, sizeof(*vs_constants));
+    if (_closed_form) {
+        _asteroids.evaluate_orientations(_simulation_clock, _instance_asteroids.data() + begin,
+                                         end - begin);
+    }
+
+    // Write the instance data front to back: the upload memory is cold, and
+    // scattered writes to it would each wait for a cache miss. The transforms
+    // are copied as they are, not expanded to matrices, to halve the data
+    // written.
+    size_t const instances_size = (end - begin) * sizeof(PerInstanceData);
+    auto* const instances =
+        static_cast<PerInstanceData*>(command_buffer->get_upload_data(instances_size));
+    if (instances == nullptr) {
+        return;
+    }
+    for (size_t slot = begin; slot < end; ++slot) {
+        auto const index = _instance_asteroids[slot];
+        auto& data = instances[slot - begin];
+        data.orientation = {
+            _asteroids.orientation[0][index], _asteroids.orientation[1][index],
+            _asteroids.orientation[2][index], _asteroids.orientation[3][index],
+        };
+        data.position_scale = {
+            _asteroids.position[0][index], _asteroids.position[1][index],
+            _asteroids.position[2][index],
+            _asteroids.scale[index] * _asteroid_model.position_scales[index % kNumAsteroidMeshes],
+        };
+    }
+    command_buffer->set_instance_data(instances, instances_size);
+
+    // Gather the arguments of every draw of the run's part of each group,
+    // then make them all with one indirect call. Instances are numbered from
+    // the start of the run.
+    auto const& lod_offsets = _asteroid_model.lod_index_offsets;
+    auto const& simplified_offsets = _asteroid_model.simplified_index_offsets;
+    auto const& meshlets = _asteroid_model.meshlets;
+    chunk->meshlet_ranges.resize(meshlets.size());
+    auto const first_group = std::upper_bound(_group_offsets.begin(), _group_offsets.end(),
+                                              static_cast<uint32_t>(begin)) -
+                             _group_offsets.begin() - 1;
+    for (auto group = static_cast<unsigned int>(first_group);
+         group + 1 < _group_offsets.size() && _group_offsets[group] < end; ++group) {
+        auto const group_begin = std::max<size_t>(_group_offsets[group], begin);
+        auto const group_end = std::min<size_t>(_group_offsets[group + 1], end);
+        if (group_begin >= group_end) {
+            continue;
+        }
+        auto const first_instance = static_cast<uint32_t>(group_begin - begin);
+        auto const instance_count = static_cast<uint32_t>(group_end - group_begin);
+        auto const mesh = group / kLevelsPerMesh;
+        auto const level = group % kLevelsPerMesh;
+        auto const base_vertex = static_cast<int32_t>(mesh * _asteroid_model.vertices_per_mesh);
+        if (level < kNumSimplifiedLods) {
+            auto const lod = mesh * kNumSimplifiedLods + level;
+            auto const lod_offset = simplified_offsets[lod];
+            auto const lod_index_count = simplified_offsets[lod + 1] - lod_offset;
+            chunk->draw_arguments.push_back(
+                {lod_index_count, instance_count, lod_offset, base_vertex, first_instance});
+            chunk->triangles += lod_index_count / 3 * instance_count;
+            continue;
+        }
+        auto const full_offset = lod_offsets[kNumSubdivLevels - 1];
+        auto const full_index_count = lod_offsets[kNumSubdivLevels] - full_offset;
+        if (meshlets.empty()) {
+            chunk->draw_arguments.push_back(
+                {full_index_count, instance_count, full_offset, base_vertex, first_instance});
+            chunk->triangles += full_index_count / 3 * instance_count;
+            continue;
+        }
+
+        // Close enough to be drawn in full detail: skip the meshlets facing
+        // away or outside the frustum, which differ per asteroid. Their
+        // bounds are in full precision units, so without the position scale.
+        for (auto slot = group_begin; slot < group_end; ++slot) {
+            auto const index = _instance_asteroids[slot];
+            auto const range_count = meshlet_culler.cull(
+                _asteroids.world(index), _asteroids.scale[index], meshlets.data(),
+                _asteroid_model.meshlet_bounds.data() + mesh * meshlets.size(), meshlets.size(),
+                chunk->meshlet_ranges.data());
+            for (size_t rr = 0; rr < range_count; ++rr) {
+                auto const& range = chunk->meshlet_ranges[rr];
+                chunk->draw_arguments.push_back({range.index_count, 1, range.first_index,
+                                                 base_vertex,
+                                                 static_cast<uint32_t>(slot - begin)});
+                chunk->triangles += range.index_count / 3;
+            }
+        }
+    }
+    if (chunk->draw_arguments.empty()) {
+        return;
+    }
+    auto const arguments_size = chunk->draw_arguments.size() * sizeof(ak::DrawIndexedArguments);
+    auto* const arguments = command_buffer->get_upload_data(arguments_size);
+    if (arguments != nullptr) {
+        memcpy(arguments, chunk->draw_arguments.data(), arguments_size);
+        command_buffer->draw_indexed_indirect(arguments,
+                                              static_cast<uint32_t>(chunk->draw_arguments.size()),
+                                              sizeof(ak::DrawIndexedArguments));
+    }
 }
 
 void Application::on_keyup(int const glfw_key)
 {
     if (glfw_key == GLFW_KEY_SPACE) {
         _simulate = !_simulate;
+    } else if (glfw_key == GLFW_KEY_M) {
+        // the current transforms become the starting point of the new mode.
+        // Closed form only keeps the orientations of drawn asteroids current.
+        if (_closed_form) {
+            _asteroids.evaluate(_simulation_clock);
+        }
+        _closed_form = !_closed_form;
+        _asteroids.rebase();
+        _simulation_clock = 0.0f;
     }
 }
 
@@ -540,12 +682,12 @@ void Application::on_scroll(float scroll)
 void Application::recalculate_camera()
 {
     mathfu::float3 const center(0.0f, -0.4f * kSimDiscRadius, 0.0f);
-    mathfu::float3 const position(_cam_radius * std::sin(_cam_lat_angle) *
-                                      std::cos(_cam_long_angle),
-                                  _cam_radius * std::cos(_cam_lat_angle),
-                                  _cam_radius * std::sin(_cam_lat_angle) *
-                                      std::sin(_cam_long_angle));
-    _constant_buffer.view = mathfu::float4x4::LookAt(center, position, {0, 1, 0}, -1);
+    _cam_position = {
+        _cam_radius * std::sin(_cam_lat_angle) * std::cos(_cam_long_angle),
+        _cam_radius * std::cos(_cam_lat_angle),
+        _cam_radius * std::sin(_cam_lat_angle) * std::sin(_cam_long_angle),
+    };
+    _constant_buffer.view = mathfu::float4x4::LookAt(center, _cam_position, {0, 1, 0}, -1);
 
     _constant_buffer.viewproj = _constant_buffer.projection * _constant_buffer.view;
 }
@@ -1,5 +1,10 @@
 #pragma once
+#include <vector>
 #include "graphics/graphics.h"
+#include "asteroid-field.h"
+#include "job-system.h"
+#include "mesh.h"
+#include "meshlet-cull.h"
 
 #if defined(_MSC_VER)
 #pragma warning(push)
@@ -15,7 +20,36 @@ struct GLFWWindow;
 class Application
 {
    public:
-    Application(void* native_window, void* native_instance);
+#if defined(_DEBUG)
+    static constexpr size_t kDefaultNumAsteroids = 500;
+#else
+    static constexpr size_t kDefaultNumAsteroids = 50000;
+#endif
+
+    struct Config
+    {
+        ak::Graphics::API api = ak::Graphics::kDefault;
+        size_t num_asteroids = kDefaultNumAsteroids;
+        size_t num_threads = 0;    ///< 0 uses every hardware thread
+        bool large_pages = false;  ///< back the asteroid field with large pages if allowed
+        bool mesh_cache = true;    ///< load and save generated meshes next to the executable
+    };
+
+    /// Wall-clock time spent in each phase of the most recent frame, in seconds
+    struct FrameTimings
+    {
+        float simulate = 0.0f;        ///< asteroid update
+        float cull = 0.0f;            ///< frustum culling
+        float record = 0.0f;          ///< constant upload and draw recording
+        float submit = 0.0f;          ///< command buffer execution and present
+        size_t simulation_bytes = 0;  ///< asteroid state read and written by the update
+        size_t visible = 0;           ///< asteroids that passed culling and were drawn
+        size_t triangles = 0;         ///< triangles drawn after level of detail and meshlet culling
+        size_t draws = 0;             ///< draws made, by one indirect call per command buffer
+        size_t command_buffers = 0;   ///< render pass command buffers recorded in parallel
+    };
+
+    Application(void* native_window, void* native_instance, Config const& config);
     ~Application();
 
     void on_resize(int width, int height);
@@ -24,6 +58,11 @@ class Application
     void on_mouse_move(float delta_x, float delta_y);
     void on_scroll(float scroll);
 
+    FrameTimings const& frame_timings() const { return _frame_timings; }
+    size_t num_asteroids() const { return _asteroids.size(); }
+    size_t num_threads() const { return _jobs.num_threads(); }
+    AsteroidField const& asteroids() const { return _asteroids; }
+
    private:
     void recalculate_camera();
 
@@ -33,11 +72,9 @@ class Application
 
     static constexpr float kSimOrbitRadius = 450.0f;
     static constexpr float kSimDiscRadius = 120.0f;
-#if defined(_DEBUG)
-    static constexpr int kNumAsteroids = 500;
-#else
-    static constexpr int kNumAsteroids = 50000;
-#endif
+    /// Seconds of closed-form simulation before the initial state is reset.
+    /// Keeps the fastest spin angle well inside the accurate range of sincos.
+    static constexpr float kSimRebaseInterval = 256.0f;
 
     //
     // types
@@ -48,32 +85,56 @@ class Application
         mathfu::float4x4 view;
         mathfu::float4x4 viewproj;
     };
-    struct PerModelConstants
+    /// Per-instance vertex data: an asteroid's transform as AsteroidField
+    /// keeps it, expanded to `translation * rotation * scale` by the vertex shader
+    struct PerInstanceData
     {
-        mathfu::float4x4 world;
+        mathfu::float4 orientation;     ///< rotation quaternion (x, y, z, w)
+        mathfu::float4 position_scale;  ///< translation, and the scale times the mesh's
     };
     struct PSConstantBuffer
     {
         mathfu::float4 color;
     };
-
-    struct Asteroid
+    /// A run of instances recorded by one job into a render pass command
+    /// buffer, and the job's scratch memory
+    struct RecordChunk
     {
-        // TODO(kw): Split into static and dynamic data for better caching
-        mathfu::float4x4 world;
-        mathfu::float3 spin_axis;
-        float scale;
-        float spin_velocity;
-        float orbit_velocity;
+        ak::CommandBuffer* command_buffer = nullptr;  ///< the buffer the run is recorded into
+        std::vector<ak::DrawIndexedArguments> draw_arguments;
+        std::vector<IndexRange> meshlet_ranges;  ///< visible meshlets of one asteroid
+        size_t triangles = 0;
     };
 
     struct Model
     {
         std::unique_ptr<ak::Buffer> vertex_buffer;
         std::unique_ptr<ak::Buffer> index_buffer;
-        uint32_t index_count;
+        /// Geosphere level `ii`, shared by every unique mesh, is indices
+        /// [lod_index_offsets[ii], lod_index_offsets[ii + 1]). Only the most
+        /// detailed level is kept; see DropCoarseGeosphereLevels
+        std::vector<unsigned int> lod_index_offsets;
+        /// Simplified level `ii` of unique mesh `m` is indices
+        /// [simplified_index_offsets[m * count + ii], simplified_index_offsets[m * count + ii + 1])
+        /// for the `count` simplified levels, coarsest first; see SimplifyAsteroidLods
+        std::vector<unsigned int> simplified_index_offsets;
+        /// Error of each simplified level, in mesh units
+        std::vector<float> simplified_errors;
+        unsigned int vertices_per_mesh;  ///< every unique asteroid mesh has the same count
+        float bounding_radius;           ///< distance of the furthest vertex from the origin
+        /// scale to apply to each unique mesh's quantized positions; see PackedMesh
+        std::vector<float> position_scales;
+        /// The most detailed level's meshlets, and their bounds for each unique mesh
+        std::vector<Meshlet> meshlets;
+        std::vector<MeshletBounds> meshlet_bounds;
     };
 
+    /// @brief Records the draws of instances [begin, end) of the frame's groups
+    ///     into the chunk's command buffer, which is already in the render pass
+    void record_instances(size_t begin, size_t end, MeshletCuller const& meshlet_culler,
+                          PSConstantBuffer const* ps_constants,
+                          PerFrameConstants const* vs_constants, RecordChunk* chunk);
+
     //
     // data members
     //
@@ -82,18 +143,35 @@ class Application
     void* const _instance = nullptr;
     ak::ScopedGraphics const _graphics = nullptr;
 
+    JobSystem _jobs;
     bool _simulate = true;
+    // closed-form mode evaluates from absolute time instead of integrating
+    bool _closed_form = false;
+    float _simulation_clock = 0.0f;  ///< seconds since the last rebase
 
     int _width = 0;
     int _height = 0;
 
-    Model _cube_model = {};
+    Model _asteroid_model = {};
 
     std::unique_ptr<ak::RenderState> _render_state;
 
     PerFrameConstants _constant_buffer = {};
 
-    Asteroid _asteroids[kNumAsteroids] = {};
+    AsteroidField _asteroids;
+    // Culling output. Each job chunk of the field writes its visible indices
+    // to `_visible` starting at the chunk's first asteroid.
+    std::vector<uint32_t> _visible;
+    std::vector<size_t> _visible_counts;  ///< visible indices per chunk
+    // Instanced drawing. The visible asteroids are grouped by mesh and level of
+    // detail; group `g` is instances [_group_offsets[g], _group_offsets[g + 1]).
+    std::vector<uint32_t> _instance_groups;     ///< group of each visible asteroid, as `_visible`
+    std::vector<uint32_t> _group_offsets;       ///< first instance of each group, and the total
+    std::vector<uint32_t> _group_ends;          ///< end of each group's instances written so far
+    std::vector<uint32_t> _instance_asteroids;  ///< asteroid drawn by each instance
+    std::vector<RecordChunk> _record_chunks;    ///< in the order their buffers run
+    std::vector<ak::CommandBuffer*> _pass_command_buffers;
+    FrameTimings _frame_timings = {};
 
     // camera
     mathfu::float2 _cursor_delta = {0, 0};
@@ -102,4 +180,5 @@ class Application
     float _cam_radius = kSimDiscRadius + kSimOrbitRadius + 10.0f;
     float _cam_long_angle = 4.5f;
     float _cam_lat_angle = 1.45f;
+    mathfu::float3 _cam_position = {0, 0, 0};
 };
@@ -1,7 +1,13 @@
 #version 450
 
+// PackedVertex: snorm16 position relative to the mesh's scale, which the world
+// matrix applies, and an octahedral-encoded normal
 layout(location=0) in vec4 position;
-layout(location=1) in vec3 norm;
+layout(location=1) in vec2 norm_oct;
+// Per instance: the asteroid's rotation quaternion, and its translation and
+// uniform scale
+layout(location=2) in vec4 orientation;
+layout(location=3) in vec4 position_scale;
 
 layout(binding = 0) uniform PerFrameUniforms {
     mat4 projection;
@@ -9,17 +15,31 @@ layout(binding = 0) uniform PerFrameUniforms {
     mat4 viewproj;
 } frame_uniforms;
 
-layout(binding = 1) uniform PerModelUniforms {
-    mat4 world;
-} model_uniforms;
-
 layout(location=0) out vec3 out_norm;
 
+// Inverse of EncodeOctahedralNormal in mesh.cpp
+vec3 decode_octahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
+
+// Rotates `v` by the unit quaternion `q`
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
 void main()
 {
-    gl_Position = model_uniforms.world      *    position;
+    vec3 world = rotate(orientation, position.xyz * position_scale.w) + position_scale.xyz;
+    gl_Position = vec4(world, 1.0);
     gl_Position = frame_uniforms.view       * gl_Position;
     gl_Position = frame_uniforms.projection * gl_Position;
 
-    out_norm = (model_uniforms.world * vec4(norm,0)).xyz;
+    vec3 norm = decode_octahedral(norm_oct);
+    out_norm = rotate(orientation, norm);
 }
@@ -0,0 +1,302 @@
+#include "asteroid-field.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include "asteroid-kernel.h"
+#include "job-system.h"
+
+void update_asteroids_scalar(AsteroidKernelData const& data, size_t const begin, size_t const end,
+                             float const time)
+{
+    update_asteroids<simd::Scalar>(data, begin, end, time);
+}
+
+void update_asteroid_positions_scalar(AsteroidKernelData const& data, size_t const begin,
+                                      size_t const end, float const time)
+{
+    update_asteroid_positions<simd::Scalar>(data, begin, end, time);
+}
+
+size_t cull_asteroids_scalar(AsteroidCullData const& data, size_t const begin, size_t const end,
+                             uint32_t* const visible)
+{
+    return cull_asteroids<simd::Scalar>(data, begin, end, visible);
+}
+
+namespace {
+
+/// @brief Floats per array, padded so the next array starts on a new cache line
+size_t stream_stride(size_t const count)
+{
+    constexpr size_t kFloatsPerLine = kCacheLineSize / sizeof(float);
+    return (count + kFloatsPerLine - 1) / kFloatsPerLine * kFloatsPerLine;
+}
+
+AsteroidKernelData kernel_data(AsteroidField const& field, float* const (&orientation)[4],
+                               float* const (&position)[3],
+                               float* const (&source_orientation)[4],
+                               float* const (&source_position)[3])
+{
+    AsteroidKernelData data = {};
+    for (size_t ii = 0; ii < 4; ++ii) {
+        data.orientation[ii] = orientation[ii];
+        data.source_orientation[ii] = source_orientation[ii];
+    }
+    for (size_t ii = 0; ii < 3; ++ii) {
+        data.position[ii] = position[ii];
+        data.source_position[ii] = source_position[ii];
+        data.spin_axis[ii] = field.spin_axis[ii];
+    }
+    data.spin_velocity = field.spin_velocity;
+    data.orbit_velocity = field.orbit_velocity;
+    return data;
+}
+
+void run_kernel(AsteroidKernelData const& data, float const time, simd::InstructionSet const isa,
+                size_t const begin, size_t const end)
+{
+    switch (isa) {
+        case simd::InstructionSet::kAVX512:
+            update_asteroids_avx512(data, begin, end, time);
+            break;
+        case simd::InstructionSet::kAVX2:
+            update_asteroids_avx2(data, begin, end, time);
+            break;
+        case simd::InstructionSet::kSSE2:
+            update_asteroids_sse2(data, begin, end, time);
+            break;
+        case simd::InstructionSet::kScalar:
+        default:
+            update_asteroids_scalar(data, begin, end, time);
+            break;
+    }
+}
+
+void run_position_kernel(AsteroidKernelData const& data, float const time,
+                         simd::InstructionSet const isa, size_t const begin, size_t const end)
+{
+    switch (isa) {
+        case simd::InstructionSet::kAVX512:
+            update_asteroid_positions_avx512(data, begin, end, time);
+            break;
+        case simd::InstructionSet::kAVX2:
+            update_asteroid_positions_avx2(data, begin, end, time);
+            break;
+        case simd::InstructionSet::kSSE2:
+            update_asteroid_positions_sse2(data, begin, end, time);
+            break;
+        case simd::InstructionSet::kScalar:
+        default:
+            update_asteroid_positions_scalar(data, begin, end, time);
+            break;
+    }
+}
+
+AsteroidCullData cull_data(AsteroidField const& field, mathfu::float4x4 const& viewproj,
+                           float const bounding_radius)
+{
+    AsteroidCullData data = {};
+    for (size_t ii = 0; ii < 3; ++ii) {
+        data.position[ii] = field.position[ii];
+    }
+    data.scale = field.scale;
+    data.bounding_radius = bounding_radius;
+    frustum_side_planes(viewproj, data.planes);
+    return data;
+}
+
+}  // anonymous namespace
+
+void frustum_side_planes(mathfu::float4x4 const& viewproj, float (&planes)[4][4])
+{
+    // The w row of the view-projection plus or minus the x and y rows
+    for (int ii = 0; ii < 4; ++ii) {
+        int const row = ii / 2;
+        float const sign = ii % 2 == 0 ? 1.0f : -1.0f;
+        auto& plane = planes[ii];
+        for (int col = 0; col < 4; ++col) {
+            plane[col] = viewproj(3, col) + sign * viewproj(row, col);
+        }
+        float const inv_length =
+            1.0f / std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for (auto& component : plane) {
+            component *= inv_length;
+        }
+    }
+}
+
+AsteroidField::AsteroidField(AsteroidField&& other)
+    : _count(other._count)
+    , _memory(std::move(other._memory))
+{
+    other._count = 0;
+    other.bind_streams();
+    bind_streams();
+}
+
+AsteroidField& AsteroidField::operator=(AsteroidField&& other)
+{
+    if (this != &other) {
+        _count = other._count;
+        _memory = std::move(other._memory);
+        other._count = 0;
+        other.bind_streams();
+        bind_streams();
+    }
+    return *this;
+}
+
+bool AsteroidField::allocate(size_t const count, bool const large_pages)
+{
+    _count = 0;
+    _memory = PageAllocation();
+    constexpr size_t kMaxCount =
+        std::numeric_limits<size_t>::max() / (kNumStreams * sizeof(float)) - kCacheLineSize;
+    if (count <= kMaxCount) {
+        size_t const stream_floats = stream_stride(count);
+        _memory = PageAllocation(kNumStreams * stream_floats * sizeof(float), large_pages);
+    }
+    if (_memory.data() != nullptr) {
+        _count = count;
+    }
+    bind_streams();
+    return _count == count;
+}
+
+void AsteroidField::bind_streams()
+{
+    float* next = static_cast<float*>(_memory.data());
+    size_t const stride = next != nullptr ? stream_stride(_count) : 0;
+    auto const bind = [&next, stride](float*& stream) {
+        stream = next;
+        next += stride;
+    };
+    for (auto& component : orientation) {
+        bind(component);
+    }
+    for (auto& component : position) {
+        bind(component);
+    }
+    for (auto& component : initial_orientation) {
+        bind(component);
+    }
+    for (auto& component : initial_position) {
+        bind(component);
+    }
+    for (auto& component : spin_axis) {
+        bind(component);
+    }
+    bind(spin_velocity);
+    bind(orbit_velocity);
+    bind(scale);
+    assert(stride == 0 || next == static_cast<float*>(_memory.data()) + kNumStreams * stride);
+}
+
+void AsteroidField::set_transform(size_t const index, mathfu::float3 const& translation,
+                                  mathfu::Quaternion<float> const& rotation,
+                                  float const uniform_scale)
+{
+    assert(index < size());
+    for (int ii = 0; ii < 3; ++ii) {
+        position[ii][index] = initial_position[ii][index] = translation[ii];
+        orientation[ii][index] = initial_orientation[ii][index] = rotation.vector()[ii];
+    }
+    orientation[3][index] = initial_orientation[3][index] = rotation.scalar();
+    scale[index] = uniform_scale;
+}
+
+mathfu::float4x4 AsteroidField::world(size_t const index, float const mesh_scale) const
+{
+    assert(index < size());
+    float const x = orientation[0][index];
+    float const y = orientation[1][index];
+    float const z = orientation[2][index];
+    float const w = orientation[3][index];
+    float const s = scale[index] * mesh_scale;
+
+    // mathfu matrices are constructed column by column
+    return mathfu::float4x4(s * (1.0f - 2.0f * (y * y + z * z)), s * 2.0f * (x * y + w * z),
+                            s * 2.0f * (x * z - w * y), 0.0f,
+                            s * 2.0f * (x * y - w * z), s * (1.0f - 2.0f * (x * x + z * z)),
+                            s * 2.0f * (y * z + w * x), 0.0f,
+                            s * 2.0f * (x * z + w * y), s * 2.0f * (y * z - w * x),
+                            s * (1.0f - 2.0f * (x * x + y * y)), 0.0f,
+                            position[0][index], position[1][index], position[2][index], 1.0f);
+}
+
+void AsteroidField::update(float const delta_time, simd::InstructionSet const isa,
+                           size_t const begin, size_t const end)
+{
+    assert(begin <= end && end <= size());
+    run_kernel(kernel_data(*this, orientation, position, orientation, position), delta_time, isa,
+               begin, end);
+}
+
+void AsteroidField::evaluate(float const time, simd::InstructionSet const isa, size_t const begin,
+                             size_t const end)
+{
+    assert(begin <= end && end <= size());
+    run_kernel(kernel_data(*this, orientation, position, initial_orientation, initial_position),
+               time, isa, begin, end);
+}
+
+void AsteroidField::evaluate_positions(float const time, simd::InstructionSet const isa,
+                                       size_t const begin, size_t const end)
+{
+    assert(begin <= end && end <= size());
+    run_position_kernel(
+        kernel_data(*this, orientation, position, initial_orientation, initial_position), time,
+        isa, begin, end);
+}
+
+void AsteroidField::evaluate_orientations(float const time, uint32_t const* const indices,
+                                          size_t const count)
+{
+    auto const data =
+        kernel_data(*this, orientation, position, initial_orientation, initial_position);
+    simd::Scalar const scalar_time = simd::Scalar::broadcast(time);
+    for (size_t ii = 0; ii < count; ++ii) {
+        assert(indices[ii] < size());
+        update_orientation_block<simd::Scalar>(data, indices[ii], scalar_time);
+    }
+}
+
+size_t AsteroidField::cull(mathfu::float4x4 const& viewproj, float const bounding_radius,
+                           simd::InstructionSet const isa, size_t const begin, size_t const end,
+                           uint32_t* const visible) const
+{
+    assert(begin <= end && end <= size());
+    auto const data = cull_data(*this, viewproj, bounding_radius);
+    switch (isa) {
+        case simd::InstructionSet::kAVX512:
+            return cull_asteroids_avx512(data, begin, end, visible);
+        case simd::InstructionSet::kAVX2:
+            return cull_asteroids_avx2(data, begin, end, visible);
+        case simd::InstructionSet::kSSE2:
+            return cull_asteroids_sse2(data, begin, end, visible);
+        case simd::InstructionSet::kScalar:
+        default:
+            return cull_asteroids_scalar(data, begin, end, visible);
+    }
+}
+
+void AsteroidField::rebase()
+{
+    for (size_t ii = 0; ii < 4; ++ii) {
+        memcpy(initial_orientation[ii], orientation[ii], _count * sizeof(float));
+    }
+    for (size_t ii = 0; ii < 3; ++ii) {
+        memcpy(initial_position[ii], position[ii], _count * sizeof(float));
+    }
+}
+
+void AsteroidField::rebase(float const time, simd::InstructionSet const isa, size_t const begin,
+                           size_t const end)
+{
+    assert(begin <= end && end <= size());
+    run_kernel(kernel_data(*this, initial_orientation, initial_position, initial_orientation,
+                           initial_position),
+               time, isa, begin, end);
+}
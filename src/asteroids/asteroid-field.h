@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include "page-allocation.h"
+#include "simd.h"
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4201)  // nameless struct/union
+#endif
+#include <mathfu/hlsl_mappings.h>
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+/// @brief Extracts the left, right, bottom and top planes of the view frustum
+/// @details Each plane is (a, b, c, d) with a unit normal pointing into the
+///     frustum. Near and far are not extracted: the side planes already
+///     reject everything behind the camera, the far plane is well beyond the
+///     field, and it keeps the planes independent of each API's depth range.
+void frustum_side_planes(mathfu::float4x4 const& viewproj, float (&planes)[4][4]);
+
+/// Structure-of-arrays asteroid storage. Each scalar component lives in its
+/// own array so the update can load a full SIMD register of asteroids at once
+/// and only streams the attributes it actually uses. The world transform is
+/// kept as position, orientation and uniform scale (32 bytes) and only
+/// expanded to a matrix when it is needed for rendering.
+///
+/// The motion can be advanced two ways. `update` integrates the current
+/// transform by a time step. `evaluate` computes the transform directly from
+/// the initial state and an absolute time, so any subset of asteroids can be
+/// evaluated in any order, from any thread, without accumulating error.
+///
+/// All of the arrays live in a single page allocation sized at runtime. Each
+/// array is padded to a whole number of cache lines so every one of them
+/// starts on a cache line boundary.
+class AsteroidField
+{
+   public:
+    /// Bytes read and written per asteroid by `update`
+    /// (orientation and position x/z are read and written, spin and orbit are only read)
+    static constexpr size_t kUpdateBytesPerAsteroid = sizeof(float) * (2 * (4 + 2) + 3 + 2);
+    /// Bytes read and written per asteroid by `evaluate`
+    static constexpr size_t kEvaluateBytesPerAsteroid = sizeof(float) * (2 * (4 + 3) + 3 + 2);
+    /// Bytes read and written per asteroid by `evaluate_positions`
+    /// (position x/z are read and written, orbit is only read)
+    static constexpr size_t kEvaluatePositionsBytesPerAsteroid = sizeof(float) * (2 * 2 + 1);
+
+    AsteroidField() = default;
+    AsteroidField(AsteroidField&& other);
+    AsteroidField& operator=(AsteroidField&& other);
+    AsteroidField(AsteroidField const&) = delete;
+    AsteroidField& operator=(AsteroidField const&) = delete;
+
+    /// @brief Replaces the field with `count` zeroed asteroids, optionally
+    ///     backed by large pages. Previous contents are discarded.
+    /// @return False, leaving the field empty, if the storage could not be allocated
+    bool allocate(size_t count, bool large_pages = false);
+    size_t size() const { return _count; }
+    /// @brief Whether the storage ended up backed by large pages
+    bool large_pages() const { return _memory.large_pages(); }
+    /// @brief Total bytes of storage, including padding
+    size_t allocated_bytes() const { return _memory.size(); }
+
+    /// @brief Sets both the initial and the current world transform of an asteroid
+    void set_transform(size_t index, mathfu::float3 const& translation,
+                       mathfu::Quaternion<float> const& rotation, float uniform_scale);
+    /// @brief Expands the transform to `translation * rotation * scale`
+    /// @param mesh_scale Extra uniform scale applied to the mesh first, e.g. to
+    ///     expand quantized vertex positions
+    mathfu::float4x4 world(size_t index, float mesh_scale = 1.0f) const;
+
+    /// @brief Advances asteroids [begin, end) by `delta_time` using `isa`
+    void update(float delta_time, simd::InstructionSet isa, size_t begin, size_t end);
+    void update(float delta_time, simd::InstructionSet isa) { update(delta_time, isa, 0, size()); }
+    void update(float delta_time) { update(delta_time, simd::best_instruction_set()); }
+
+    /// @brief Sets asteroids [begin, end) to their transform `time` seconds
+    ///     after the initial state
+    /// @note Precision drops as `time` grows; `rebase` periodically.
+    void evaluate(float time, simd::InstructionSet isa, size_t begin, size_t end);
+    void evaluate(float time, simd::InstructionSet isa) { evaluate(time, isa, 0, size()); }
+    void evaluate(float time) { evaluate(time, simd::best_instruction_set()); }
+    /// @brief As `evaluate`, but only the positions, e.g. for culling
+    void evaluate_positions(float time, simd::InstructionSet isa, size_t begin, size_t end);
+    /// @brief As `evaluate`, but only the orientations, and only of the
+    ///     `count` asteroids in `indices`
+    void evaluate_orientations(float time, uint32_t const* indices, size_t count);
+
+    /// @brief Writes the index of every asteroid in [begin, end) whose bounding
+    ///     sphere intersects the view frustum of `viewproj` to `visible`
+    /// @param bounding_radius Bounding sphere radius of the mesh at scale 1
+    /// @param visible Room for at least `end - begin` indices
+    /// @return The number of visible asteroids
+    size_t cull(mathfu::float4x4 const& viewproj, float bounding_radius,
+                simd::InstructionSet isa, size_t begin, size_t end, uint32_t* visible) const;
+
+    /// @brief Makes the current transforms the initial state, so `evaluate`
+    ///     times are relative to now. Every asteroid must be current.
+    void rebase();
+    /// @brief Moves the initial state of asteroids [begin, end) forward by
+    ///     `time`, so `evaluate` times are relative to it. Only the initial
+    ///     state is read, so the current transforms need not be up to date.
+    void rebase(float time, simd::InstructionSet isa, size_t begin, size_t end);
+    void rebase(float time, simd::InstructionSet isa) { rebase(time, isa, 0, size()); }
+    void rebase(float time) { rebase(time, simd::best_instruction_set()); }
+
+    // dynamic data, read and written every frame
+    float* orientation[4] = {};  ///< unit quaternion, (x, y, z, w)
+    float* position[3] = {};
+
+    // static data, read-only after initialization
+    float* initial_orientation[4] = {};
+    float* initial_position[3] = {};
+    float* scale = nullptr;
+    float* spin_axis[3] = {};
+    float* spin_velocity = nullptr;
+    float* orbit_velocity = nullptr;
+
+   private:
+    /// Number of arrays above
+    static constexpr size_t kNumStreams = 4 + 3 + 4 + 3 + 1 + 3 + 1 + 1;
+
+    /// @brief Points every array at its slice of `_memory`
+    void bind_streams();
+
+    size_t _count = 0;
+    PageAllocation _memory;
+};
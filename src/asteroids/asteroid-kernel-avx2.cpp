@@ -0,0 +1,48 @@
+#include "asteroid-kernel.h"
+#include "noise-kernel.h"
+
+#if defined(AK_SIMD_AVX2)
+bool const simd::kCompiledAVX2 = true;
+#else
+bool const simd::kCompiledAVX2 = false;
+#endif
+
+void update_asteroids_avx2(AsteroidKernelData const& data, size_t const begin, size_t const end,
+                           float const time)
+{
+#if defined(AK_SIMD_AVX2)
+    update_asteroids<simd::AVX2>(data, begin, end, time);
+#else
+    // Built without AVX2 code generation; best_instruction_set() never returns it
+    update_asteroids<simd::Scalar>(data, begin, end, time);
+#endif
+}
+
+void update_asteroid_positions_avx2(AsteroidKernelData const& data, size_t const begin,
+                                    size_t const end, float const time)
+{
+#if defined(AK_SIMD_AVX2)
+    update_asteroid_positions<simd::AVX2>(data, begin, end, time);
+#else
+    update_asteroid_positions<simd::Scalar>(data, begin, end, time);
+#endif
+}
+
+size_t cull_asteroids_avx2(AsteroidCullData const& data, size_t const begin, size_t const end,
+                           uint32_t* const visible)
+{
+#if defined(AK_SIMD_AVX2)
+    return cull_asteroids<simd::AVX2>(data, begin, end, visible);
+#else
+    return cull_asteroids<simd::Scalar>(data, begin, end, visible);
+#endif
+}
+
+void simplex_noise_avx2(SimplexNoiseData const& data, size_t const begin, size_t const end)
+{
+#if defined(AK_SIMD_AVX2)
+    simplex_noise<simd::AVX2>(data, begin, end);
+#else
+    simplex_noise<simd::Scalar>(data, begin, end);
+#endif
+}
@@ -0,0 +1,239 @@
+#pragma once
+// Batched asteroid update and culling. The kernels are templates over one of
+// the `simd` lane types and are instantiated once per instruction set, each in
+// its own translation unit so it can be compiled with the matching code
+// generation. The templates sit in the same per-target namespace as the lane
+// types (see simd.h), so each file links against its own build of them.
+#include <cstddef>
+#include <cstdint>
+#include "simd.h"
+
+/// Raw pointers into the structure-of-arrays asteroid storage. The kernel
+/// rotates the source transform by the orbit and spin for the given time and
+/// writes the destination. For an incremental update source and destination
+/// are the same arrays and time is the frame's delta; for closed-form
+/// evaluation source is the initial state and time is absolute.
+struct AsteroidKernelData
+{
+    float* orientation[4];  ///< Unit quaternion, (x, y, z, w)
+    float* position[3];
+    float const* source_orientation[4];
+    float const* source_position[3];
+    float const* spin_axis[3];
+    float const* spin_velocity;
+    float const* orbit_velocity;
+};
+
+/// Input to the culling kernel. Each plane is (a, b, c, d) with a unit
+/// normal pointing into the frustum, so a sphere is outside when
+/// `a*x + b*y + c*z + d < -radius` for any plane.
+struct AsteroidCullData
+{
+    static constexpr size_t kNumPlanes = 4;
+
+    float const* position[3];
+    float const* scale;
+    float planes[kNumPlanes][4];
+    float bounding_radius;  ///< Bounding sphere radius of the mesh at scale 1
+};
+
+void update_asteroids_scalar(AsteroidKernelData const& data, size_t begin, size_t end,
+                             float time);
+void update_asteroids_sse2(AsteroidKernelData const& data, size_t begin, size_t end, float time);
+void update_asteroids_avx2(AsteroidKernelData const& data, size_t begin, size_t end, float time);
+void update_asteroids_avx512(AsteroidKernelData const& data, size_t begin, size_t end,
+                             float time);
+
+void update_asteroid_positions_scalar(AsteroidKernelData const& data, size_t begin, size_t end,
+                                      float time);
+void update_asteroid_positions_sse2(AsteroidKernelData const& data, size_t begin, size_t end,
+                                    float time);
+void update_asteroid_positions_avx2(AsteroidKernelData const& data, size_t begin, size_t end,
+                                    float time);
+void update_asteroid_positions_avx512(AsteroidKernelData const& data, size_t begin, size_t end,
+                                      float time);
+
+size_t cull_asteroids_scalar(AsteroidCullData const& data, size_t begin, size_t end,
+                             uint32_t* visible);
+size_t cull_asteroids_sse2(AsteroidCullData const& data, size_t begin, size_t end,
+                           uint32_t* visible);
+size_t cull_asteroids_avx2(AsteroidCullData const& data, size_t begin, size_t end,
+                           uint32_t* visible);
+size_t cull_asteroids_avx512(AsteroidCullData const& data, size_t begin, size_t end,
+                             uint32_t* visible);
+
+inline namespace AK_SIMD_TARGET {
+
+/// @brief Sets the orientations of `F::kWidth` asteroids starting at `index`
+///     to `orbit * source * spin`, see update_asteroid_block
+template<typename F>
+void update_orientation_block(AsteroidKernelData const& data, size_t const index, F const time)
+{
+    using simd::splat;
+    F const half = splat<F>(0.5f);
+
+    F half_orbit_sin;
+    F half_orbit_cos;
+    simd::sincos(F::load(data.orbit_velocity + index) * time * half, &half_orbit_sin,
+                 &half_orbit_cos);
+
+    F half_spin_sin;
+    F half_spin_cos;
+    simd::sincos(F::load(data.spin_velocity + index) * time * half, &half_spin_sin,
+                 &half_spin_cos);
+
+    // spin quaternion
+    F const sw = half_spin_cos;
+    F const sx = F::load(data.spin_axis[0] + index) * half_spin_sin;
+    F const sy = F::load(data.spin_axis[1] + index) * half_spin_sin;
+    F const sz = F::load(data.spin_axis[2] + index) * half_spin_sin;
+
+    // orbit * orientation. The orbit quaternion is (0, sin, 0, cos).
+    F const qx = F::load(data.source_orientation[0] + index);
+    F const qy = F::load(data.source_orientation[1] + index);
+    F const qz = F::load(data.source_orientation[2] + index);
+    F const qw = F::load(data.source_orientation[3] + index);
+    F const ox = half_orbit_cos * qx + half_orbit_sin * qz;
+    F const oy = half_orbit_cos * qy + half_orbit_sin * qw;
+    F const oz = half_orbit_cos * qz - half_orbit_sin * qx;
+    F const ow = half_orbit_cos * qw - half_orbit_sin * qy;
+
+    // (orbit * orientation) * spin
+    F rx = ow * sx + ox * sw + oy * sz - oz * sy;
+    F ry = ow * sy - ox * sz + oy * sw + oz * sx;
+    F rz = ow * sz + ox * sy - oy * sx + oz * sw;
+    F rw = ow * sw - ox * sx - oy * sy - oz * sz;
+
+    // One Newton step towards unit length keeps rounding error from accumulating
+    F const length_sq = rx * rx + ry * ry + rz * rz + rw * rw;
+    F const renormalize = splat<F>(1.5f) - half * length_sq;
+    rx = rx * renormalize;
+    ry = ry * renormalize;
+    rz = rz * renormalize;
+    rw = rw * renormalize;
+
+    rx.store(data.orientation[0] + index);
+    ry.store(data.orientation[1] + index);
+    rz.store(data.orientation[2] + index);
+    rw.store(data.orientation[3] + index);
+}
+
+/// @brief Sets the positions of `F::kWidth` asteroids starting at `index` to
+///     the source rotated by the orbit. Rotating about Y leaves the height
+///     unchanged, so only x and z are written.
+template<typename F>
+void update_position_block(AsteroidKernelData const& data, size_t const index, F const time)
+{
+    F orbit_sin;
+    F orbit_cos;
+    simd::sincos(F::load(data.orbit_velocity + index) * time, &orbit_sin, &orbit_cos);
+
+    F const px = F::load(data.source_position[0] + index);
+    F const pz = F::load(data.source_position[2] + index);
+    (orbit_cos * px + orbit_sin * pz).store(data.position[0] + index);
+    (orbit_cos * pz - orbit_sin * px).store(data.position[2] + index);
+}
+
+/// @brief Updates `F::kWidth` asteroids starting at `index`
+/// @details Computes `world = orbit * source * spin`, where orbit is a rotation
+///     about Y and spin is a rotation about the asteroid's own spin axis, both
+///     by their velocity times `time`. With world = translation * rotation *
+///     uniform scale this reduces to rotating the position by the orbit and
+///     `orientation = orbit * orientation * spin`.
+template<typename F>
+void update_asteroid_block(AsteroidKernelData const& data, size_t const index, F const time)
+{
+    update_orientation_block<F>(data, index, time);
+    if (data.source_position[1] != data.position[1]) {
+        F::load(data.source_position[1] + index).store(data.position[1] + index);
+    }
+    update_position_block<F>(data, index, time);
+}
+
+/// @brief Updates asteroids [begin, end) in blocks of `F::kWidth`
+template<typename F>
+void update_asteroids(AsteroidKernelData const& data, size_t const begin, size_t const end,
+                      float const time)
+{
+    size_t index = begin;
+    F const wide_time = F::broadcast(time);
+    for (; index + F::kWidth <= end; index += F::kWidth) {
+        update_asteroid_block<F>(data, index, wide_time);
+    }
+    simd::Scalar const scalar_time = simd::Scalar::broadcast(time);
+    for (; index < end; ++index) {
+        update_asteroid_block<simd::Scalar>(data, index, scalar_time);
+    }
+}
+
+/// @brief Updates only the x and z positions of asteroids [begin, end), in
+///     blocks of `F::kWidth`
+template<typename F>
+void update_asteroid_positions(AsteroidKernelData const& data, size_t const begin,
+                               size_t const end, float const time)
+{
+    size_t index = begin;
+    F const wide_time = F::broadcast(time);
+    for (; index + F::kWidth <= end; index += F::kWidth) {
+        update_position_block<F>(data, index, wide_time);
+    }
+    simd::Scalar const scalar_time = simd::Scalar::broadcast(time);
+    for (; index < end; ++index) {
+        update_position_block<simd::Scalar>(data, index, scalar_time);
+    }
+}
+
+/// @brief Appends the index of each of the `F::kWidth` asteroids starting at
+///     `index` that intersect the frustum to `visible`
+/// @return The number of indices written
+template<typename F>
+size_t cull_asteroid_block(AsteroidCullData const& data, size_t const index,
+                           uint32_t* const visible)
+{
+    using simd::splat;
+    F const x = F::load(data.position[0] + index);
+    F const y = F::load(data.position[1] + index);
+    F const z = F::load(data.position[2] + index);
+    F const radius = F::load(data.scale + index) * splat<F>(data.bounding_radius);
+
+    // signed distance to the nearest plane, negative outside
+    F distance = splat<F>(data.planes[0][0]) * x + splat<F>(data.planes[0][1]) * y +
+                 splat<F>(data.planes[0][2]) * z + splat<F>(data.planes[0][3]);
+    for (size_t ii = 1; ii < AsteroidCullData::kNumPlanes; ++ii) {
+        auto const& plane = data.planes[ii];
+        distance = min(distance, splat<F>(plane[0]) * x + splat<F>(plane[1]) * y +
+                                     splat<F>(plane[2]) * z + splat<F>(plane[3]));
+    }
+    distance = distance + radius;
+
+    // Branch-free compaction: every lane writes its index, but the output
+    // only advances past the visible ones
+    float lanes[F::kWidth];
+    distance.store(lanes);
+    size_t count = 0;
+    for (size_t lane = 0; lane < F::kWidth; ++lane) {
+        visible[count] = static_cast<uint32_t>(index + lane);
+        count += lanes[lane] >= 0.0f ? 1 : 0;
+    }
+    return count;
+}
+
+/// @brief Writes the index of every asteroid in [begin, end) that intersects
+///     the frustum to `visible`, which must have room for `end - begin` indices
+/// @return The number of indices written
+template<typename F>
+size_t cull_asteroids(AsteroidCullData const& data, size_t const begin, size_t const end,
+                      uint32_t* const visible)
+{
+    size_t count = 0;
+    size_t index = begin;
+    for (; index + F::kWidth <= end; index += F::kWidth) {
+        count += cull_asteroid_block<F>(data, index, visible + count);
+    }
+    for (; index < end; ++index) {
+        count += cull_asteroid_block<simd::Scalar>(data, index, visible + count);
+    }
+    return count;
+}
+
+}  // namespace AK_SIMD_TARGET
@@ -0,0 +1,66 @@
+#include "half-edge.h"
+#include <cassert>
+
+template<typename Index>
+void build_half_edges(Index const* const indices, size_t const index_count,
+                      size_t const vertex_count, HalfEdges* const half_edges)
+{
+    assert(index_count % 3 == 0);  // trilist
+    assert(index_count < kNoHalfEdge);
+
+    // Half-edges grouped by the vertex they leave, by counting sort
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (size_t ii = 0; ii < index_count; ++ii) {
+        assert(indices[ii] < vertex_count);
+        ++offsets[indices[ii] + 1];
+    }
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        offsets[vertex + 1] += offsets[vertex];
+    }
+    std::vector<uint32_t> outgoing(index_count);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t ii = 0; ii < index_count; ++ii) {
+        outgoing[fill[indices[ii]]++] = static_cast<uint32_t>(ii);
+    }
+
+    // The twin of a -> b is the half-edge b -> a, among those leaving b
+    auto& twin = half_edges->twin;
+    twin.assign(index_count, kNoHalfEdge);
+    for (uint32_t half_edge = 0; half_edge < index_count; ++half_edge) {
+        Index const from = indices[half_edge];
+        Index const to = indices[next_half_edge(half_edge)];
+        for (uint32_t ii = offsets[to]; ii < offsets[to + 1]; ++ii) {
+            if (indices[next_half_edge(outgoing[ii])] == from) {
+                twin[half_edge] = outgoing[ii];
+                break;
+            }
+        }
+    }
+
+    auto& vertex_half_edge = half_edges->vertex_half_edge;
+    vertex_half_edge.assign(vertex_count, kNoHalfEdge);
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        for (uint32_t ii = offsets[vertex]; ii < offsets[vertex + 1]; ++ii) {
+            if (vertex_half_edge[vertex] == kNoHalfEdge || twin[outgoing[ii]] == kNoHalfEdge) {
+                vertex_half_edge[vertex] = outgoing[ii];
+            }
+        }
+    }
+
+    // An edge is numbered by whichever of its half-edges comes first
+    auto& edge = half_edges->edge;
+    auto& edge_half_edge = half_edges->edge_half_edge;
+    edge.resize(index_count);
+    edge_half_edge.clear();
+    for (uint32_t half_edge = 0; half_edge < index_count; ++half_edge) {
+        if (twin[half_edge] < half_edge) {
+            edge[half_edge] = edge[twin[half_edge]];
+        } else {
+            edge[half_edge] = static_cast<uint32_t>(edge_half_edge.size());
+            edge_half_edge.push_back(half_edge);
+        }
+    }
+}
+
+template void build_half_edges(uint16_t const*, size_t, size_t, HalfEdges*);
+template void build_half_edges(uint32_t const*, size_t, size_t, HalfEdges*);
@@ -0,0 +1,58 @@
+#pragma once
+// Index-based half-edge adjacency for indexed triangle lists. Half-edge `h`
+// is corner `h` of the index list and runs from indices[h] to the next corner
+// of its triangle, so its triangle and the next and previous half-edges follow
+// from `h` alone; only the links between triangles are stored. Built once in
+// linear time, it lets mesh passes gather from their neighbours instead of
+// scattering into them or looking edges up in a map.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Stands in for a half-edge that does not exist: the twin of a half-edge on
+/// an open border, or the outgoing half-edge of an unused vertex
+constexpr uint32_t kNoHalfEdge = ~0u;
+
+struct HalfEdges
+{
+    /// The opposite half-edge of each half-edge, or kNoHalfEdge on a border
+    std::vector<uint32_t> twin;
+    /// The undirected edge each half-edge belongs to. Edges are numbered in
+    /// the order their first half-edge appears in the index list.
+    std::vector<uint32_t> edge;
+    /// The first half-edge of each edge
+    std::vector<uint32_t> edge_half_edge;
+    /// A half-edge leaving each vertex; on a border, the one without a twin,
+    /// so that walking the fan from it (see next_in_fan) visits every triangle
+    /// around the vertex
+    std::vector<uint32_t> vertex_half_edge;
+};
+
+/// @brief The half-edge after `half_edge` in its triangle
+inline uint32_t next_half_edge(uint32_t const half_edge)
+{
+    return half_edge % 3 == 2 ? half_edge - 2 : half_edge + 1;
+}
+
+/// @brief The half-edge before `half_edge` in its triangle
+inline uint32_t prev_half_edge(uint32_t const half_edge)
+{
+    return half_edge % 3 == 0 ? half_edge + 2 : half_edge - 1;
+}
+
+/// @brief The half-edge leaving the same vertex as `half_edge` in the next
+///     triangle around it, or kNoHalfEdge at a border
+inline uint32_t next_in_fan(HalfEdges const& half_edges, uint32_t const half_edge)
+{
+    return half_edges.twin[prev_half_edge(half_edge)];
+}
+
+/// @brief Links the half-edges of a triangle list
+/// @details Every index must be below `vertex_count`. Time is linear in the
+///     index count for meshes of bounded valence. The mesh should be a
+///     consistently wound manifold; otherwise an edge shared by more than two
+///     triangles is paired arbitrarily and fans around non-manifold vertices
+///     are only partly reachable.
+template<typename Index>
+void build_half_edges(Index const* indices, size_t index_count, size_t vertex_count,
+                      HalfEdges* half_edges);
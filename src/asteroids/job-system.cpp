@@ -0,0 +1,135 @@
+#include "job-system.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+/// Chunks queued per thread by `chunk_size`. More chunks balance load better
+/// at the cost of more queue traffic.
+constexpr size_t kChunksPerThread = 4;
+
+}  // anonymous namespace
+
+JobSystem::JobSystem(size_t num_threads)
+{
+    if (num_threads == 0) {
+        num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    for (size_t ii = 0; ii < num_threads; ++ii) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t ii = 1; ii < num_threads; ++ii) {
+        _threads.emplace_back(&JobSystem::worker_main, this, ii);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> const lock(_wake_mutex);
+        _shutdown = true;
+    }
+    _wake.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+size_t JobSystem::chunk_size(size_t const count, size_t const element_size) const
+{
+    size_t const alignment = std::max<size_t>(kCacheLineSize / element_size, 1);
+    size_t const num_chunks = num_threads() * kChunksPerThread;
+    size_t const size = (count + num_chunks - 1) / num_chunks;
+    return std::max(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void JobSystem::parallel_for(size_t const count, size_t const chunk_size,
+                             RangeFunction const& func)
+{
+    assert(chunk_size > 0);
+    if (count == 0) {
+        return;
+    }
+    size_t const num_jobs = (count + chunk_size - 1) / chunk_size;
+    if (num_jobs == 1 || _workers.size() == 1) {
+        func(0, count);
+        return;
+    }
+
+    std::atomic<size_t> pending(num_jobs);
+    {
+        std::lock_guard<std::mutex> const lock(_wake_mutex);
+        _queued_jobs += num_jobs;
+    }
+    // Deal contiguous runs of chunks to each thread so neighbouring chunks
+    // usually stay on the same core
+    size_t const jobs_per_worker = (num_jobs + _workers.size() - 1) / _workers.size();
+    for (size_t ii = 0; ii < num_jobs; ++ii) {
+        Job const job = {&func, ii * chunk_size, std::min(count, (ii + 1) * chunk_size),
+                         &pending};
+        auto& worker = *_workers[ii / jobs_per_worker];
+        std::lock_guard<std::mutex> const lock(worker.mutex);
+        worker.jobs.push_front(job);
+    }
+    _wake.notify_all();
+
+    // help out until every chunk is done
+    while (pending.load(std::memory_order_acquire) > 0) {
+        Job job = {};
+        if (pop(0, &job) || steal(0, &job)) {
+            run(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::pop(size_t const worker_index, Job* const job)
+{
+    auto& worker = *_workers[worker_index];
+    std::lock_guard<std::mutex> const lock(worker.mutex);
+    if (worker.jobs.empty()) {
+        return false;
+    }
+    *job = worker.jobs.back();
+    worker.jobs.pop_back();
+    --_queued_jobs;
+    return true;
+}
+
+bool JobSystem::steal(size_t const thief_index, Job* const job)
+{
+    for (size_t ii = 1; ii < _workers.size(); ++ii) {
+        auto& victim = *_workers[(thief_index + ii) % _workers.size()];
+        std::lock_guard<std::mutex> const lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            *job = victim.jobs.front();
+            victim.jobs.pop_front();
+            --_queued_jobs;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::run(Job const& job)
+{
+    (*job.func)(job.begin, job.end);
+    job.pending->fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::worker_main(size_t const worker_index)
+{
+    for (;;) {
+        Job job = {};
+        if (pop(worker_index, &job) || steal(worker_index, &job)) {
+            run(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_wake_mutex);
+        _wake.wait(lock, [this] { return _shutdown || _queued_jobs.load() > 0; });
+        if (_shutdown) {
+            return;
+        }
+    }
+}
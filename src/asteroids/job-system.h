@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Size of a cache line on every platform we target
+constexpr size_t kCacheLineSize = 64;
+
+/// Work-stealing job system. Every thread owns a deque of jobs; a thread pops
+/// from the back of its own deque and, when that runs dry, steals from the
+/// front of another thread's deque.
+class JobSystem
+{
+   public:
+    using RangeFunction = std::function<void(size_t begin, size_t end)>;
+
+    /// @brief Creates a job system using `num_threads` threads in total,
+    ///     including the calling thread. 0 uses every hardware thread.
+    explicit JobSystem(size_t num_threads = 0);
+    ~JobSystem();
+
+    JobSystem(JobSystem const&) = delete;
+    JobSystem& operator=(JobSystem const&) = delete;
+
+    /// @brief Number of threads work is split across, including the caller
+    size_t num_threads() const { return _workers.size(); }
+
+    /// @brief Splits [0, count) into chunks of `chunk_size` and calls `func`
+    ///     for each chunk across all threads. Returns once every chunk is done.
+    /// @note Only the thread that created the job system may call this, and
+    ///     not from inside a job.
+    void parallel_for(size_t count, size_t chunk_size, RangeFunction const& func);
+
+    /// @brief Returns a chunk size that gives every thread several chunks to
+    ///     balance load, rounded up so that chunks of `element_size` elements
+    ///     start on separate cache lines
+    size_t chunk_size(size_t count, size_t element_size) const;
+
+   private:
+    struct Job
+    {
+        RangeFunction const* func;
+        size_t begin;
+        size_t end;
+        std::atomic<size_t>* pending;
+    };
+    /// Allocated individually so queues of different threads rarely share a cache line
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    bool pop(size_t worker_index, Job* job);
+    bool steal(size_t thief_index, Job* job);
+    void run(Job const& job);
+    void worker_main(size_t worker_index);
+
+    //
+    // data members
+    //
+
+    // worker 0 is the thread that owns the job system
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::thread> _threads;
+
+    std::mutex _wake_mutex;
+    std::condition_variable _wake;
+    std::atomic<size_t> _queued_jobs{0};
+    bool _shutdown = false;
+};
@@ -5,7 +5,11 @@
 #endif
 
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <string>
 #include <vector>
 
 #if defined(_WIN32)
@@ -24,6 +28,8 @@ namespace {
 
 constexpr int kInitialWidth = 1920;
 constexpr int kInitialHeight = 1080;
+constexpr int kDefaultHeadlessFrames = 1000;
+constexpr float kHeadlessDeltaTime = 1.0f / 60.0f;
 
 bool s_cursor_disabled = false;  // TODO(kw): remove global
 mathfu::float2 s_prev_cursor_pos = {};
@@ -122,13 +128,200 @@ void glfw_mouse_scroll_callback(GLFWwindow* window, double /*xoffset*/, double y
     get_window_application(window)->on_scroll(static_cast<float>(yoffset));
 }
 
+////
+// Command line
+////
+struct Options
+{
+    Application::Config config;
+    bool headless = false;
+    int num_frames = kDefaultHeadlessFrames;
+};
+
+void print_usage(char const* const executable)
+{
+    std::cerr << "Usage: " << executable << " [options]\n"
+              << "  --headless        Run without a window and print frame timings as JSON\n"
+              << "  --software        Render on the CPU; headless runs draw nothing otherwise\n"
+              << "  --asteroids <n>   Number of asteroids to simulate\n"
+              << "  --threads <n>     Number of simulation threads (0: all hardware threads)\n"
+              << "  --large-pages     Back the asteroid field with large pages if the OS allows\n"
+              << "  --no-mesh-cache   Always generate the asteroid meshes, ignoring the cache\n"
+              << "  --frames <n>      Number of frames to run in headless mode\n";
+}
+
+bool parse_count(char const* const text, size_t* const value)
+{
+    char* end = nullptr;
+    auto const parsed = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0') {
+        return false;
+    }
+    *value = static_cast<size_t>(parsed);
+    return true;
+}
+
+bool parse_options(int const argc, char const* const argv[], Options* const options)
+{
+    for (int ii = 1; ii < argc; ++ii) {
+        char const* const arg = argv[ii];
+        char const* const value = ii + 1 < argc ? argv[ii + 1] : nullptr;
+        size_t count = 0;
+        if (strcmp(arg, "--headless") == 0) {
+            options->headless = true;
+            continue;
+        }
+        if (strcmp(arg, "--software") == 0) {
+            options->config.api = ak::Graphics::kSoftware;
+            continue;
+        }
+        if (strcmp(arg, "--large-pages") == 0) {
+            options->config.large_pages = true;
+            continue;
+        }
+        if (strcmp(arg, "--no-mesh-cache") == 0) {
+            options->config.mesh_cache = false;
+            continue;
+        }
+        if (value == nullptr || !parse_count(value, &count)) {
+            return false;
+        }
+        ++ii;
+        if (strcmp(arg, "--asteroids") == 0) {
+            options->config.num_asteroids = count;
+        } else if (strcmp(arg, "--threads") == 0) {
+            options->config.num_threads = count;
+        } else if (strcmp(arg, "--frames") == 0 && count > 0) {
+            options->num_frames = static_cast<int>(count);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+////
+// Headless benchmark
+////
+using Clock = std::chrono::high_resolution_clock;
+
+/// @brief Prints `"name": {"mean_ms": ..., ...}` for a set of samples in seconds
+void print_phase(char const* const name, std::vector<float> samples, bool const last)
+{
+    std::sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (auto const sample : samples) {
+        total += sample;
+    }
+    auto const percentile = [&samples](double const p) {
+        auto const index = static_cast<size_t>(p * static_cast<double>(samples.size() - 1));
+        return samples[index] * 1000.0;
+    };
+    std::cout << "    \"" << name << "\": {"
+              << "\"mean_ms\": " << total * 1000.0 / static_cast<double>(samples.size())
+              << ", \"min_ms\": " << percentile(0.0) << ", \"median_ms\": " << percentile(0.5)
+              << ", \"p95_ms\": " << percentile(0.95) << ", \"max_ms\": " << percentile(1.0)
+              << "}" << (last ? "\n" : ",\n");
+}
+
+/// @brief Runs the application without a window and prints per-phase timings
+///     as JSON. Uses the null graphics device unless another that needs no
+///     window was asked for.
+int run_headless(Options options)
+{
+    if (options.config.api == ak::Graphics::kDefault) {
+        options.config.api = ak::Graphics::kNull;
+    }
+
+    auto const init_start = Clock::now();
+    auto app = std::make_unique<Application>(nullptr, nullptr, options.config);
+    app->on_resize(kInitialWidth, kInitialHeight);
+    auto const init_time = std::chrono::duration<float>(Clock::now() - init_start).count();
+
+    size_t const num_frames = static_cast<size_t>(options.num_frames);
+    std::vector<float> frame(num_frames);
+    std::vector<float> simulate(num_frames);
+    std::vector<float> cull(num_frames);
+    std::vector<float> record(num_frames);
+    std::vector<float> submit(num_frames);
+    double simulation_bytes = 0.0;
+    double simulation_time = 0.0;
+    double visible = 0.0;
+    double triangles = 0.0;
+    double draws = 0.0;
+    double command_buffers = 0.0;
+    double submit_time = 0.0;
+    for (size_t ii = 0; ii < num_frames; ++ii) {
+        auto const frame_start = Clock::now();
+        app->on_frame(kHeadlessDeltaTime);
+        frame[ii] = std::chrono::duration<float>(Clock::now() - frame_start).count();
+
+        auto const& timings = app->frame_timings();
+        simulate[ii] = timings.simulate;
+        cull[ii] = timings.cull;
+        record[ii] = timings.record;
+        submit[ii] = timings.submit;
+        simulation_bytes += static_cast<double>(timings.simulation_bytes);
+        simulation_time += timings.simulate;
+        visible += static_cast<double>(timings.visible);
+        triangles += static_cast<double>(timings.triangles);
+        draws += static_cast<double>(timings.draws);
+        command_buffers += static_cast<double>(timings.command_buffers);
+        submit_time += timings.submit;
+    }
+
+    bool const software = options.config.api == ak::Graphics::kSoftware;
+    std::cout << "{\n"
+              << "  \"api\": \"" << (software ? "software" : "null") << "\",\n"
+              << "  \"asteroids\": " << app->num_asteroids() << ",\n"
+              << "  \"threads\": " << app->num_threads() << ",\n"
+              << "  \"frames\": " << num_frames << ",\n"
+              << "  \"instruction_set\": \""
+              << simd::instruction_set_name(simd::best_instruction_set()) << "\",\n"
+              << "  \"init_ms\": " << init_time * 1000.0f << ",\n"
+              << "  \"field_bytes\": " << app->asteroids().allocated_bytes() << ",\n"
+              << "  \"large_pages\": " << (app->asteroids().large_pages() ? "true" : "false")
+              << ",\n"
+              << "  \"simulation_gb_per_s\": "
+              << (simulation_time > 0.0 ? simulation_bytes / simulation_time / 1.0e9 : 0.0)
+              << ",\n"
+              << "  \"mean_visible\": " << visible / static_cast<double>(num_frames) << ",\n"
+              << "  \"mean_triangles\": " << triangles / static_cast<double>(num_frames) << ",\n"
+              << "  \"mean_draws\": " << draws / static_cast<double>(num_frames) << ",\n"
+              << "  \"mean_command_buffers\": "
+              << command_buffers / static_cast<double>(num_frames) << ",\n";
+    if (software) {
+        // Submitting runs the rasterizer, so this is its throughput
+        std::cout << "  \"triangles_per_s\": "
+                  << (submit_time > 0.0 ? triangles / submit_time : 0.0) << ",\n";
+    }
+    std::cout << "  \"phases\": {\n";
+    print_phase("frame", frame, false);
+    print_phase("simulate", simulate, false);
+    print_phase("cull", cull, false);
+    print_phase("record", record, false);
+    print_phase("submit", submit, true);
+    std::cout << "  }\n"
+              << "}" << std::endl;
+    return 0;
+}
+
 }  // namespace
 
-int main(int const /*argc*/, char const* const /*argv*/[])
+int main(int const argc, char const* const argv[])
 {
 #if defined(_MSC_VER)
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif  // _MSC_VER
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (options.headless) {
+        return run_headless(options);
+    }
+
     // Initialize GLFW
     glfwSetErrorCallback(glfw_error_callback);
     if (glfwInit() != GLFW_TRUE) {
@@ -148,7 +341,8 @@ int main(int const /*argc*/, char const* const /*argv*/[])
     //
     // Initialize
     //
-    auto app = std::make_unique<Application>(native_window(window), native_instance());
+    auto app = std::make_unique<Application>(native_window(window), native_instance(),
+                                             options.config);
     glfwSetWindowUserPointer(window, app.get());
 
     // The framebuffer is set here after graphics initialization to trigger the
@@ -169,7 +363,14 @@ int main(int const /*argc*/, char const* const /*argv*/[])
         auto const delta_time = static_cast<float>(curr_time - prev_time) / glfwGetTimerFrequency();
         prev_time = curr_time;
         if (fps_elapsed_time > 0.5f) {
-            std::cout << "FPS: " << frame_count * 2 << "\n";
+            auto const& timings = app->frame_timings();
+            auto const sim_ms = timings.simulate * 1000.0f;
+            auto const sim_bytes = static_cast<float>(timings.simulation_bytes);
+            auto const sim_gbps =
+                timings.simulate > 0.0f ? sim_bytes / timings.simulate / 1.0e9f : 0.0f;
+            std::cout << "FPS: " << frame_count * 2 << "  Simulation: " << sim_ms << "ms ("
+                      << sim_gbps << " GB/s)  Visible: " << timings.visible << " ("
+                      << timings.cull * 1000.0f << "ms)\n";
             frame_count = 0;
             fps_elapsed_time -= 0.5f;
         }
@@ -0,0 +1,84 @@
+#include "mapped-file.h"
+#include <utility>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+MappedFile::MappedFile(char const* const path)
+{
+#if defined(_WIN32)
+    HANDLE const file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    LARGE_INTEGER size = {};
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        // the view keeps the mapping, and the mapping the file, alive
+        HANDLE const mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            _data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            _size = _data != nullptr ? static_cast<size_t>(size.QuadPart) : 0;
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int const fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info = {};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        auto const size = static_cast<size_t>(info.st_size);
+        void* const data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            _data = data;
+            _size = size;
+        }
+    }
+    close(fd);
+#endif  // _WIN32
+}
+
+MappedFile::~MappedFile()
+{
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+    : _data(other._data)
+    , _size(other._size)
+{
+    other._data = nullptr;
+    other._size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+    if (this != &other) {
+        release();
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+    }
+    return *this;
+}
+
+void MappedFile::release()
+{
+    if (_data != nullptr) {
+#if defined(_WIN32)
+        UnmapViewOfFile(_data);
+#else
+        munmap(const_cast<void*>(_data), _size);
+#endif  // _WIN32
+    }
+    _data = nullptr;
+    _size = 0;
+}
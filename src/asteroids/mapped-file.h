@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+
+/// A whole file mapped read-only into memory. Pages are loaded on first
+/// touch, so opening is cheap regardless of the file's size, and data can be
+/// handed straight to APIs that copy from a pointer.
+class MappedFile
+{
+   public:
+    MappedFile() = default;
+    /// @brief Maps the file at `path`; `data()` is null if it cannot be opened
+    explicit MappedFile(char const* path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other);
+    MappedFile& operator=(MappedFile&& other);
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    void const* data() const { return _data; }
+    size_t size() const { return _size; }
+
+   private:
+    void release();
+
+    void const* _data = nullptr;
+    size_t _size = 0;
+};
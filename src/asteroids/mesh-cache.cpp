@@ -0,0 +1,234 @@
+#include "mesh-cache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace {
+
+/// Bump when the file layout changes
+constexpr uint32_t kFormatVersion = 5;
+/// Bump when CreateAsteroidsFromGeospheres produces different output for the
+/// same parameters, so stale caches are regenerated
+constexpr uint32_t kGeneratorVersion = 4;
+constexpr uint32_t kMagic = 0x434d4b41;  // "AKMC"
+constexpr size_t kArrayAlignment = 64;
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t vertex_size;
+    uint32_t index_size;
+    uint32_t vertices_per_mesh;
+    float bounding_radius;
+    uint64_t vertex_offset;
+    uint64_t vertex_count;
+    uint64_t index_offset;
+    uint64_t index_count;
+    uint64_t subdiv_offset_offset;
+    uint64_t subdiv_offset_count;
+    uint64_t position_scale_offset;
+    uint64_t position_scale_count;
+    uint64_t meshlet_offset;
+    uint64_t meshlet_count;
+    uint64_t meshlet_bounds_offset;  ///< meshlet_count * position_scale_count of them
+    uint64_t lod_offset_offset;  ///< lod_count * position_scale_count + 1 of them
+    uint64_t lod_error_offset;   ///< lod_count * position_scale_count of them
+    uint64_t lod_count;
+};
+
+size_t align(size_t const offset)
+{
+    return (offset + kArrayAlignment - 1) / kArrayAlignment * kArrayAlignment;
+}
+
+/// 64-bit FNV-1a
+class Hash
+{
+   public:
+    template<typename T>
+    void add(T const& value)
+    {
+        unsigned char bytes[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        for (auto const byte : bytes) {
+            _state = (_state ^ byte) * 0x100000001b3ull;
+        }
+    }
+    uint64_t value() const { return _state; }
+
+   private:
+    uint64_t _state = 0xcbf29ce484222325ull;
+};
+
+/// @brief Whether `count` elements of `size` bytes at `offset` lie inside the file
+bool in_file(uint64_t const offset, uint64_t const count, size_t const size,
+             size_t const file_size)
+{
+    return offset % kArrayAlignment == 0 && offset <= file_size &&
+           count <= (file_size - offset) / size;
+}
+
+}  // anonymous namespace
+
+uint64_t asteroid_mesh_cache_key(unsigned int const subdiv_level_count,
+                                 unsigned int const mesh_count, unsigned int const seed,
+                                 AsteroidNoiseParams const& noise_params,
+                                 float const* const lod_triangle_ratios,
+                                 unsigned int const lod_count)
+{
+    Hash hash;
+    hash.add(kFormatVersion);
+    hash.add(kGeneratorVersion);
+    hash.add(static_cast<uint32_t>(sizeof(PackedVertex)));
+    hash.add(static_cast<uint32_t>(sizeof(IndexType)));
+    hash.add(subdiv_level_count);
+    hash.add(mesh_count);
+    hash.add(seed);
+    hash.add(noise_params.noiseScale);
+    hash.add(noise_params.radiusScale);
+    hash.add(noise_params.radiusBias);
+    hash.add(noise_params.persistenceMean);
+    hash.add(noise_params.persistenceStdDev);
+    hash.add(noise_params.maxNoiseOffset);
+    hash.add(lod_count);
+    for (unsigned int ii = 0; ii < lod_count; ++ii) {
+        hash.add(lod_triangle_ratios[ii]);
+    }
+    return hash.value();
+}
+
+MeshCache::MeshCache(char const* const path, uint64_t const key)
+    : _file(path)
+{
+    auto const bytes = static_cast<unsigned char const*>(_file.data());
+    size_t const size = _file.size();
+    Header header = {};
+    if (bytes == nullptr || size < sizeof(header)) {
+        _file = MappedFile();
+        return;
+    }
+    memcpy(&header, bytes, sizeof(header));
+    bool const valid =
+        header.magic == kMagic && header.version == kFormatVersion && header.key == key &&
+        header.vertex_size == sizeof(PackedVertex) && header.index_size == sizeof(IndexType) &&
+        in_file(header.vertex_offset, header.vertex_count, sizeof(PackedVertex), size) &&
+        in_file(header.index_offset, header.index_count, sizeof(IndexType), size) &&
+        in_file(header.subdiv_offset_offset, header.subdiv_offset_count, sizeof(unsigned int),
+                size) &&
+        in_file(header.position_scale_offset, header.position_scale_count, sizeof(float), size) &&
+        in_file(header.meshlet_offset, header.meshlet_count, sizeof(Meshlet), size) &&
+        (header.position_scale_count == 0 ||
+         header.meshlet_count <= size / sizeof(MeshletBounds) / header.position_scale_count) &&
+        in_file(header.meshlet_bounds_offset, header.meshlet_count * header.position_scale_count,
+                sizeof(MeshletBounds), size) &&
+        (header.position_scale_count == 0 ||
+         header.lod_count < size / sizeof(float) / header.position_scale_count) &&
+        in_file(header.lod_offset_offset, header.lod_count * header.position_scale_count + 1,
+                sizeof(unsigned int), size) &&
+        in_file(header.lod_error_offset, header.lod_count * header.position_scale_count,
+                sizeof(float), size);
+    if (!valid) {
+        _file = MappedFile();
+        return;
+    }
+
+    _mesh.vertices = reinterpret_cast<PackedVertex const*>(bytes + header.vertex_offset);
+    _mesh.vertex_count = static_cast<size_t>(header.vertex_count);
+    _mesh.indices = reinterpret_cast<IndexType const*>(bytes + header.index_offset);
+    _mesh.index_count = static_cast<size_t>(header.index_count);
+    _mesh.subdiv_index_offsets =
+        reinterpret_cast<unsigned int const*>(bytes + header.subdiv_offset_offset);
+    _mesh.subdiv_offset_count = static_cast<size_t>(header.subdiv_offset_count);
+    _mesh.position_scales = reinterpret_cast<float const*>(bytes + header.position_scale_offset);
+    _mesh.mesh_count = static_cast<size_t>(header.position_scale_count);
+    _mesh.meshlets = reinterpret_cast<Meshlet const*>(bytes + header.meshlet_offset);
+    _mesh.meshlet_count = static_cast<size_t>(header.meshlet_count);
+    _mesh.meshlet_bounds =
+        reinterpret_cast<MeshletBounds const*>(bytes + header.meshlet_bounds_offset);
+    _mesh.lod_index_offsets =
+        reinterpret_cast<unsigned int const*>(bytes + header.lod_offset_offset);
+    _mesh.lod_errors = reinterpret_cast<float const*>(bytes + header.lod_error_offset);
+    _mesh.lod_count = static_cast<unsigned int>(header.lod_count);
+    _mesh.vertices_per_mesh = header.vertices_per_mesh;
+    _mesh.bounding_radius = header.bounding_radius;
+}
+
+bool MeshCache::write(char const* const path, uint64_t const key, MeshCacheView const& mesh)
+{
+    Header header = {};
+    header.magic = kMagic;
+    header.version = kFormatVersion;
+    header.key = key;
+    header.vertex_size = sizeof(PackedVertex);
+    header.index_size = sizeof(IndexType);
+    header.vertices_per_mesh = mesh.vertices_per_mesh;
+    header.bounding_radius = mesh.bounding_radius;
+    header.vertex_offset = align(sizeof(header));
+    header.vertex_count = mesh.vertex_count;
+    header.index_offset = align(header.vertex_offset + mesh.vertex_count * sizeof(PackedVertex));
+    header.index_count = mesh.index_count;
+    header.subdiv_offset_offset = align(header.index_offset + mesh.index_count * sizeof(IndexType));
+    header.subdiv_offset_count = mesh.subdiv_offset_count;
+    header.position_scale_offset =
+        align(header.subdiv_offset_offset + mesh.subdiv_offset_count * sizeof(unsigned int));
+    header.position_scale_count = mesh.mesh_count;
+    header.meshlet_offset =
+        align(header.position_scale_offset + mesh.mesh_count * sizeof(float));
+    header.meshlet_count = mesh.meshlet_count;
+    header.meshlet_bounds_offset =
+        align(header.meshlet_offset + mesh.meshlet_count * sizeof(Meshlet));
+    size_t const meshlet_bounds_count = mesh.meshlet_count * mesh.mesh_count;
+    header.lod_offset_offset =
+        align(header.meshlet_bounds_offset + meshlet_bounds_count * sizeof(MeshletBounds));
+    header.lod_count = mesh.lod_count;
+    size_t const lod_error_count = size_t(mesh.lod_count) * mesh.mesh_count;
+    header.lod_error_offset =
+        align(header.lod_offset_offset + (lod_error_count + 1) * sizeof(unsigned int));
+
+    struct Section
+    {
+        uint64_t offset;
+        void const* data;
+        size_t size;
+    };
+    Section const sections[] = {
+        {0, &header, sizeof(header)},
+        {header.vertex_offset, mesh.vertices, mesh.vertex_count * sizeof(PackedVertex)},
+        {header.index_offset, mesh.indices, mesh.index_count * sizeof(IndexType)},
+        {header.subdiv_offset_offset, mesh.subdiv_index_offsets,
+         mesh.subdiv_offset_count * sizeof(unsigned int)},
+        {header.position_scale_offset, mesh.position_scales, mesh.mesh_count * sizeof(float)},
+        {header.meshlet_offset, mesh.meshlets, mesh.meshlet_count * sizeof(Meshlet)},
+        {header.meshlet_bounds_offset, mesh.meshlet_bounds,
+         meshlet_bounds_count * sizeof(MeshletBounds)},
+        {header.lod_offset_offset, mesh.lod_index_offsets,
+         (lod_error_count + 1) * sizeof(unsigned int)},
+        {header.lod_error_offset, mesh.lod_errors, lod_error_count * sizeof(float)},
+    };
+
+    // Write next to the destination and move it into place once complete, so
+    // an interrupted write never leaves a file that looks valid
+    std::string const temp_path = std::string(path) + ".tmp";
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    uint64_t position = 0;
+    char const padding[kArrayAlignment] = {};
+    for (auto const& section : sections) {
+        file.write(padding, static_cast<std::streamsize>(section.offset - position));
+        file.write(static_cast<char const*>(section.data),
+                   static_cast<std::streamsize>(section.size));
+        position = section.offset + section.size;
+    }
+    file.close();
+    bool const written = !file.fail();
+
+    // rename does not replace an existing file on Windows
+    std::remove(path);
+    if (!written || std::rename(temp_path.c_str(), path) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
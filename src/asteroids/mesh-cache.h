@@ -0,0 +1,65 @@
+#pragma once
+// Versioned binary cache for generated asteroid meshes. The file is a fixed
+// header followed by the vertex, index, level-of-detail offset, position
+// scale, meshlet, meshlet bounds and simplified level-of-detail arrays, each
+// aligned so it can be used in place once the file is memory-mapped. The
+// simplified levels' indices follow the geosphere levels' in the one index
+// array, so it can be uploaded straight from the mapping.
+#include <cstddef>
+#include <cstdint>
+#include "mapped-file.h"
+#include "mesh.h"
+
+/// Arrays making up a generated, quantized asteroid mesh set; see
+/// CreateAsteroidsFromGeospheres
+struct MeshCacheView
+{
+    PackedVertex const* vertices;
+    size_t vertex_count;
+    IndexType const* indices;  ///< Geosphere levels, then the simplified levels
+    size_t index_count;
+    unsigned int const* subdiv_index_offsets;
+    size_t subdiv_offset_count;
+    float const* position_scales;  ///< One per mesh; see PackedMesh
+    size_t mesh_count;
+    Meshlet const* meshlets;  ///< Of the most detailed level, shared by every mesh
+    size_t meshlet_count;
+    /// `meshlet_count` per mesh, mesh by mesh; see PackedMesh
+    MeshletBounds const* meshlet_bounds;
+    /// Where each simplified level of each mesh starts in `indices`,
+    /// `mesh_count * lod_count + 1` of them; see SimplifyAsteroidLods
+    unsigned int const* lod_index_offsets;
+    float const* lod_errors;                ///< `mesh_count * lod_count` of them
+    unsigned int lod_count;                 ///< Simplified levels per mesh
+    unsigned int vertices_per_mesh;
+    float bounding_radius;  ///< Distance of the furthest vertex from the origin
+};
+
+/// @brief Hashes everything that determines the output of
+///     CreateAsteroidsFromGeospheres and SimplifyAsteroidLods, along with the
+///     cache format and the vertex and index layouts
+uint64_t asteroid_mesh_cache_key(unsigned int subdiv_level_count, unsigned int mesh_count,
+                                 unsigned int seed, AsteroidNoiseParams const& noise_params,
+                                 float const* lod_triangle_ratios, unsigned int lod_count);
+
+/// A mesh cache file mapped into memory. Opening only validates the header;
+/// the arrays are used straight from the mapping.
+class MeshCache
+{
+   public:
+    MeshCache() = default;
+    /// @brief Maps the file at `path` if it holds a mesh generated for `key`.
+    ///     Otherwise, including when the file is missing, `valid()` is false.
+    MeshCache(char const* path, uint64_t key);
+
+    bool valid() const { return _file.data() != nullptr; }
+    MeshCacheView const& mesh() const { return _mesh; }
+
+    /// @brief Writes `mesh` to `path` under `key`, replacing any previous file
+    /// @return False if the file could not be written
+    static bool write(char const* path, uint64_t key, MeshCacheView const& mesh);
+
+   private:
+    MappedFile _file;
+    MeshCacheView _mesh = {};
+};
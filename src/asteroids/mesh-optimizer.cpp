@@ -0,0 +1,446 @@
+#include "mesh-optimizer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr uint32_t kUnassigned = UINT32_MAX;
+
+/// Triangles using each vertex, in compressed rows: the triangles of vertex
+/// `v` are `triangles[offsets[v]]` up to `triangles[offsets[v + 1]]`
+struct VertexTriangles
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+};
+
+template<typename Index>
+VertexTriangles build_vertex_triangles(Index const* const indices, size_t const index_count,
+                                       size_t const vertex_count)
+{
+    VertexTriangles adjacency;
+    adjacency.offsets.assign(vertex_count + 1, 0);
+    for (size_t ii = 0; ii < index_count; ++ii) {
+        assert(indices[ii] < vertex_count);
+        ++adjacency.offsets[indices[ii] + 1];
+    }
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        adjacency.offsets[vertex + 1] += adjacency.offsets[vertex];
+    }
+    adjacency.triangles.resize(index_count);
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (size_t ii = 0; ii < index_count; ++ii) {
+        adjacency.triangles[fill[indices[ii]]++] = static_cast<uint32_t>(ii / 3);
+    }
+    return adjacency;
+}
+
+/// Symmetric 4x4 matrix summing the squared distance to a set of planes,
+/// each weighted by its triangle's area, with the total weight
+struct Quadric
+{
+    double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+    double weight;
+
+    void add_plane(double const nx, double const ny, double const nz, double const d,
+                   double const w)
+    {
+        a00 += w * nx * nx;
+        a01 += w * nx * ny;
+        a02 += w * nx * nz;
+        a03 += w * nx * d;
+        a11 += w * ny * ny;
+        a12 += w * ny * nz;
+        a13 += w * ny * d;
+        a22 += w * nz * nz;
+        a23 += w * nz * d;
+        a33 += w * d * d;
+        weight += w;
+    }
+
+    Quadric& operator+=(Quadric const& other)
+    {
+        a00 += other.a00;
+        a01 += other.a01;
+        a02 += other.a02;
+        a03 += other.a03;
+        a11 += other.a11;
+        a12 += other.a12;
+        a13 += other.a13;
+        a22 += other.a22;
+        a23 += other.a23;
+        a33 += other.a33;
+        weight += other.weight;
+        return *this;
+    }
+
+    /// @brief Mean squared distance of `p` from the planes
+    double error(float const* const p) const
+    {
+        double const x = p[0];
+        double const y = p[1];
+        double const z = p[2];
+        double const sum = a00 * x * x + a11 * y * y + a22 * z * z + a33 +
+                           2.0 * (a01 * x * y + a02 * x * z + a12 * y * z + a03 * x +
+                                  a13 * y + a23 * z);
+        return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+    }
+};
+
+void cross(float const* const a, float const* const b, float const* const c, float (&n)[3])
+{
+    float const e1[] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float const e2[] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+}  // anonymous namespace
+
+template<typename Index>
+VertexCacheStats analyze_vertex_cache(Index const* const indices, size_t const index_count,
+                                      size_t const vertex_count, unsigned int const cache_size)
+{
+    // A vertex is cached while fewer than `cache_size` misses have happened
+    // since its own; 0 means never transformed
+    std::vector<size_t> miss_time(vertex_count, 0);
+    size_t misses = 0;
+    size_t referenced = 0;
+    for (size_t ii = 0; ii < index_count; ++ii) {
+        size_t& time = miss_time[indices[ii]];
+        if (time == 0) {
+            ++referenced;
+        }
+        if (time == 0 || misses - time >= cache_size) {
+            time = ++misses;
+        }
+    }
+
+    VertexCacheStats stats = {};
+    if (index_count > 0) {
+        stats.acmr = static_cast<double>(misses) / static_cast<double>(index_count / 3);
+        stats.atvr = static_cast<double>(misses) / static_cast<double>(referenced);
+    }
+    return stats;
+}
+
+template<typename Index>
+void optimize_vertex_cache(Index* const indices, size_t const index_count,
+                           size_t const vertex_count, unsigned int const cache_size)
+{
+    assert(index_count % 3 == 0);  // trilist
+    if (index_count == 0) {
+        return;
+    }
+    VertexTriangles const adjacency = build_vertex_triangles(indices, index_count, vertex_count);
+
+    // Triangles not yet emitted that use each vertex
+    std::vector<uint32_t> live(vertex_count);
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        live[vertex] = adjacency.offsets[vertex + 1] - adjacency.offsets[vertex];
+    }
+    // Time each vertex last entered the cache, counted in cache misses
+    std::vector<size_t> cache_time(vertex_count, 0);
+    size_t time = cache_size + 1;
+    std::vector<bool> emitted(index_count / 3, false);
+    // Recently emitted vertices to restart from when the fan runs dry
+    std::vector<Index> dead_end;
+    dead_end.reserve(index_count);
+    std::vector<Index> candidates;
+    size_t cursor = 0;
+
+    std::vector<Index> output;
+    output.reserve(index_count);
+
+    // Start where the original order did, then repeatedly emit every live
+    // triangle around the fanning vertex and move on to its best neighbour
+    int64_t fanning = indices[0];
+    while (fanning >= 0) {
+        candidates.clear();
+        size_t const fan = static_cast<size_t>(fanning);
+        for (uint32_t tt = adjacency.offsets[fan]; tt < adjacency.offsets[fan + 1]; ++tt) {
+            uint32_t const triangle = adjacency.triangles[tt];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (size_t corner = 0; corner < 3; ++corner) {
+                Index const vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                dead_end.push_back(vertex);
+                candidates.push_back(vertex);
+                --live[vertex];
+                if (time - cache_time[vertex] > cache_size) {
+                    cache_time[vertex] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Prefer the candidate that entered the cache earliest among those
+        // whose remaining triangles would still hit in it
+        fanning = -1;
+        int64_t best_priority = -1;
+        for (auto const vertex : candidates) {
+            if (live[vertex] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            size_t const age = time - cache_time[vertex];
+            if (age + 2 * live[vertex] <= cache_size) {
+                priority = static_cast<int64_t>(age);
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                fanning = vertex;
+            }
+        }
+        // Dead end: restart from a recent vertex, or else the next vertex in
+        // index order, that still has triangles left
+        while (fanning < 0 && !dead_end.empty()) {
+            Index const vertex = dead_end.back();
+            dead_end.pop_back();
+            if (live[vertex] > 0) {
+                fanning = vertex;
+            }
+        }
+        for (; fanning < 0 && cursor < vertex_count; ++cursor) {
+            if (live[cursor] > 0) {
+                fanning = static_cast<int64_t>(cursor);
+            }
+        }
+    }
+
+    assert(output.size() == index_count);
+    std::copy(output.begin(), output.end(), indices);
+}
+
+template<typename Index>
+std::vector<uint32_t> optimize_vertex_fetch(Index* const indices, size_t const index_count,
+                                            size_t const vertex_count)
+{
+    std::vector<uint32_t> remap(vertex_count, kUnassigned);
+    uint32_t next = 0;
+    for (size_t ii = 0; ii < index_count; ++ii) {
+        uint32_t& index = remap[indices[ii]];
+        if (index == kUnassigned) {
+            index = next++;
+        }
+        indices[ii] = static_cast<Index>(index);
+    }
+    for (auto& index : remap) {
+        if (index == kUnassigned) {
+            index = next++;
+        }
+    }
+    return remap;
+}
+
+template<typename Index>
+size_t simplify_mesh(Index* const destination, Index const* const indices,
+                     size_t const index_count, float const* const positions,
+                     size_t const vertex_count, size_t const vertex_stride,
+                     size_t const target_index_count, float const max_error,
+                     float* const out_error)
+{
+    assert(index_count % 3 == 0);  // trilist
+    assert(vertex_stride % sizeof(float) == 0);
+    size_t const stride = vertex_stride / sizeof(float);
+    auto const position = [&](size_t const vertex) { return positions + vertex * stride; };
+
+    std::vector<Index> current(indices, indices + index_count);
+    std::vector<Quadric> quadrics(vertex_count, Quadric{});
+    for (size_t ii = 0; ii < index_count; ii += 3) {
+        float n[3];
+        cross(position(indices[ii]), position(indices[ii + 1]), position(indices[ii + 2]), n);
+        double const length = std::sqrt(double(n[0]) * n[0] + double(n[1]) * n[1] +
+                                        double(n[2]) * n[2]);
+        if (length == 0.0) {
+            continue;
+        }
+        double const nx = n[0] / length;
+        double const ny = n[1] / length;
+        double const nz = n[2] / length;
+        float const* const p = position(indices[ii]);
+        double const d = -(nx * p[0] + ny * p[1] + nz * p[2]);
+        for (size_t corner = 0; corner < 3; ++corner) {
+            quadrics[indices[ii + corner]].add_plane(nx, ny, nz, d, 0.5 * length);
+        }
+    }
+
+    /// The vertex after `vertex` in `triangle`, or kUnassigned if it is not in it
+    auto const next = [&](uint32_t const triangle, uint32_t const vertex) -> uint32_t {
+        Index const* const corners = current.data() + triangle * 3;
+        for (size_t corner = 0; corner < 3; ++corner) {
+            if (corners[corner] == vertex) {
+                return corners[(corner + 1) % 3];
+            }
+        }
+        return kUnassigned;
+    };
+
+    // An edge without its reverse is on an open border; its ends stay put
+    VertexTriangles adjacency = build_vertex_triangles(current.data(), index_count, vertex_count);
+    std::vector<bool> locked(vertex_count, false);
+    for (size_t ii = 0; ii < index_count; ++ii) {
+        uint32_t const from = current[ii];
+        uint32_t const to = current[ii - ii % 3 + (ii + 1) % 3];
+        bool paired = false;
+        for (uint32_t tt = adjacency.offsets[to]; tt < adjacency.offsets[to + 1]; ++tt) {
+            paired = paired || next(adjacency.triangles[tt], to) == from;
+        }
+        if (!paired) {
+            locked[from] = true;
+            locked[to] = true;
+        }
+    }
+
+    struct Collapse
+    {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        bool operator<(Collapse const& other) const
+        {
+            return cost < other.cost ||
+                   (cost == other.cost && (from < other.from ||
+                                           (from == other.from && to < other.to)));
+        }
+    };
+    double const max_cost = double(max_error) * max_error;
+    // The cheapest collapse of each vertex, recomputed only when its
+    // neighbourhood changes; an infinite cost means there is none
+    std::vector<Collapse> cheapest(vertex_count);
+    std::vector<bool> dirty(vertex_count, true);
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertex_count);
+    std::vector<bool> touched(vertex_count);
+    double result_cost = 0.0;
+
+    // Each pass collapses the cheapest edges whose neighbourhoods do not
+    // overlap, so every flip test sees the mesh as it will be
+    size_t count = index_count;
+    while (count > target_index_count) {
+        collapses.clear();
+        for (uint32_t vertex = 0; vertex < vertex_count; ++vertex) {
+            Collapse& collapse = cheapest[vertex];
+            if (dirty[vertex]) {
+                dirty[vertex] = false;
+                collapse = {std::numeric_limits<double>::infinity(), vertex, vertex};
+                uint32_t const last = locked[vertex] ? 0 : adjacency.offsets[vertex + 1];
+                for (uint32_t tt = adjacency.offsets[vertex]; tt < last; ++tt) {
+                    uint32_t const to = next(adjacency.triangles[tt], vertex);
+                    Collapse const candidate = {quadrics[vertex].error(position(to)), vertex, to};
+                    if (candidate < collapse) {
+                        collapse = candidate;
+                    }
+                }
+            }
+            if (collapse.cost <= max_cost) {
+                collapses.push_back(collapse);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end());
+
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+            remap[vertex] = static_cast<uint32_t>(vertex);
+        }
+        std::fill(touched.begin(), touched.end(), false);
+        size_t triangles = count / 3;
+        size_t applied = 0;
+        for (auto const& collapse : collapses) {
+            if (triangles * 3 <= target_index_count) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+            uint32_t const first = adjacency.offsets[collapse.from];
+            uint32_t const last = adjacency.offsets[collapse.from + 1];
+            // Reject the collapse if any remaining triangle around `from`
+            // would turn by more than about 75 degrees
+            bool flips = false;
+            size_t removed = 0;
+            for (uint32_t tt = first; tt < last && !flips; ++tt) {
+                Index const* const triangle = current.data() + adjacency.triangles[tt] * 3;
+                float const* corners[3];
+                float const* moved[3];
+                bool degenerate = false;
+                for (size_t corner = 0; corner < 3; ++corner) {
+                    corners[corner] = position(triangle[corner]);
+                    moved[corner] =
+                        triangle[corner] == collapse.from ? position(collapse.to) : corners[corner];
+                    degenerate = degenerate || triangle[corner] == collapse.to;
+                }
+                if (degenerate) {
+                    ++removed;
+                    continue;
+                }
+                float before[3];
+                float after[3];
+                cross(corners[0], corners[1], corners[2], before);
+                cross(moved[0], moved[1], moved[2], after);
+                float const dot =
+                    before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                float const lengths =
+                    std::sqrt((before[0] * before[0] + before[1] * before[1] +
+                               before[2] * before[2]) *
+                              (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+                flips = dot < 0.25f * lengths;
+            }
+            if (flips) {
+                continue;
+            }
+
+            for (uint32_t tt = first; tt < last; ++tt) {
+                for (size_t corner = 0; corner < 3; ++corner) {
+                    touched[current[adjacency.triangles[tt] * 3 + corner]] = true;
+                }
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            result_cost = std::max(result_cost, collapse.cost);
+            triangles -= std::min(triangles, removed);
+            ++applied;
+        }
+        if (applied == 0) {
+            break;
+        }
+
+        size_t written = 0;
+        for (size_t ii = 0; ii < count; ii += 3) {
+            Index const a = static_cast<Index>(remap[current[ii]]);
+            Index const b = static_cast<Index>(remap[current[ii + 1]]);
+            Index const c = static_cast<Index>(remap[current[ii + 2]]);
+            if (a != b && b != c && c != a) {
+                current[written++] = a;
+                current[written++] = b;
+                current[written++] = c;
+            }
+        }
+        count = written;
+        // Only the neighbourhoods of the collapsed vertices changed
+        dirty = touched;
+        adjacency = build_vertex_triangles(current.data(), count, vertex_count);
+    }
+
+    std::copy(current.begin(), current.begin() + static_cast<std::ptrdiff_t>(count), destination);
+    if (out_error != nullptr) {
+        *out_error = static_cast<float>(std::sqrt(result_cost));
+    }
+    return count;
+}
+
+#define INSTANTIATE_MESH_OPTIMIZER(Index)                                                       \
+    template VertexCacheStats analyze_vertex_cache(Index const*, size_t, size_t, unsigned int); \
+    template void optimize_vertex_cache(Index*, size_t, size_t, unsigned int);                  \
+    template std::vector<uint32_t> optimize_vertex_fetch(Index*, size_t, size_t);               \
+    template size_t simplify_mesh(Index*, Index const*, size_t, float const*, size_t, size_t,   \
+                                  size_t, float, float*);
+
+INSTANTIATE_MESH_OPTIMIZER(uint16_t)
+INSTANTIATE_MESH_OPTIMIZER(uint32_t)
+
+#undef INSTANTIATE_MESH_OPTIMIZER
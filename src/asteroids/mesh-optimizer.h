@@ -0,0 +1,78 @@
+#pragma once
+// Reordering and simplification of indexed triangle lists for the GPU's
+// vertex pipeline. Triangles are ordered for the post-transform vertex cache
+// with Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+// Locality and Reduced Overdraw", 2007), then vertices are ordered by first use
+// so vertex fetch walks memory mostly forwards. Simplification collapses edges
+// by quadric error (Garland and Heckbert, "Surface Simplification Using Quadric
+// Error Metrics", 1997).
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Entries in the simulated post-transform cache. Tipsify targets this size,
+/// and analysis uses a FIFO of the same size, as on most current GPUs.
+constexpr unsigned int kVertexCacheSize = 16;
+
+/// Efficiency of a triangle list with a FIFO post-transform cache
+struct VertexCacheStats
+{
+    /// Average cache miss ratio: vertices transformed per triangle, between
+    /// about 0.5 for a perfectly ordered closed mesh and 3
+    double acmr;
+    /// Average transform to vertex ratio: vertices transformed per vertex
+    /// referenced, 1 when every vertex is only transformed once
+    double atvr;
+};
+
+/// @brief Simulates `cache_size` FIFO entries over the triangle list
+template<typename Index>
+VertexCacheStats analyze_vertex_cache(Index const* indices, size_t index_count,
+                                      size_t vertex_count,
+                                      unsigned int cache_size = kVertexCacheSize);
+
+/// @brief Reorders the triangles in place for vertex cache locality
+/// @details Runs in time linear in the triangle count. Every index must be
+///     below `vertex_count`; the winding of each triangle is preserved.
+template<typename Index>
+void optimize_vertex_cache(Index* indices, size_t index_count, size_t vertex_count,
+                           unsigned int cache_size = kVertexCacheSize);
+
+/// @brief Renumbers vertices in the order the triangles first use them,
+///     rewriting the indices in place
+/// @return `remap[old_index]` is the new index of each vertex; vertices no
+///     triangle uses are moved after all the others
+template<typename Index>
+std::vector<uint32_t> optimize_vertex_fetch(Index* indices, size_t index_count,
+                                            size_t vertex_count);
+
+/// @brief Simplifies a triangle list by collapsing edges in order of quadric
+///     error, writing the simplified list to `destination`
+/// @details Every collapse moves one vertex onto a neighbour, so the result
+///     indexes a subset of the same vertices and needs no new vertex data.
+///     Vertices on open borders are never moved, and collapses that would
+///     flip a triangle are skipped. Winding is preserved.
+/// @param positions x, y and z of vertex `i` at `positions + i * vertex_stride / sizeof(float)`
+/// @param target_index_count Stops once no more than this many indices remain
+/// @param max_error Largest error allowed, in position units
+/// @param out_error If set, receives the error of the result: the largest
+///     root mean square distance of a remaining vertex from the planes of
+///     the original triangles it replaced
+/// @return The number of indices written; `destination` needs room for
+///     `index_count`, and may be `indices`
+template<typename Index>
+size_t simplify_mesh(Index* destination, Index const* indices, size_t index_count,
+                     float const* positions, size_t vertex_count, size_t vertex_stride,
+                     size_t target_index_count, float max_error, float* out_error = nullptr);
+
+/// @brief Moves each vertex to the position given by `remap`, as returned by
+///     optimize_vertex_fetch
+template<typename Vertex>
+void remap_vertices(std::vector<Vertex>* const vertices, std::vector<uint32_t> const& remap)
+{
+    std::vector<Vertex> remapped(vertices->size());
+    for (size_t ii = 0; ii < remap.size(); ++ii) {
+        remapped[remap[ii]] = (*vertices)[ii];
+    }
+    vertices->swap(remapped);
+}
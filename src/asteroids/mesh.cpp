@@ -15,8 +15,16 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "mesh.h"
+#include "half-edge.h"
+#include "job-system.h"
+#include "mesh-optimizer.h"
 #include "noise.h"
-#include <map>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
 
 #if _MSC_VER
 #pragma warning(push)
@@ -31,7 +39,8 @@
 #pragma warning(pop)
 #endif  // _MSC_VER
 
-void CreateIcosahedron(Mesh *outMesh)
+template <typename Index>
+void CreateIcosahedron(BasicMesh<Index> *outMesh)
 {
     static const float a = std::sqrt(2.0f / (5.0f - std::sqrt(5.0f)));
     static const float b = std::sqrt(2.0f / (5.0f + std::sqrt(5.0f)));
@@ -44,7 +53,7 @@ void CreateIcosahedron(Mesh *outMesh)
         };
 
     static const size_t num_triangles = 20;
-    static const IndexType indices[num_triangles * 3] = {
+    static const Index indices[num_triangles * 3] = {
         0,  5,  11, 0,  1,  5, 0, 7, 1, 0,  10, 7, 0,  11, 10, 1, 9, 5, 5, 4,
         11, 11, 2,  10, 10, 6, 7, 7, 8, 1,  3,  4, 9,  3,  2,  4, 3, 6, 2, 3,
         8,  6,  3,  9,  8,  4, 5, 9, 2, 11, 4,  6, 10, 2,  8,  7, 6, 9, 1, 8,
@@ -55,71 +64,54 @@ void CreateIcosahedron(Mesh *outMesh)
     outMesh->indices.insert(outMesh->indices.end(), indices, indices + num_triangles * 3);
 }
 
-// Maps edge (lower index first!) to
-struct Edge
+template <typename Index>
+void SubdivideInPlace(BasicMesh<Index> *outMesh)
 {
-    Edge(IndexType i0, IndexType i1)
-        : v0(i0)
-        , v1(i1)
-    {
-        if (v0 > v1) std::swap(v0, v1);
-    }
-    IndexType v0;
-    IndexType v1;
-
-    bool operator<(const Edge &c) const { return v0 < c.v0 || (v0 == c.v0 && v1 < c.v1); }
-};
-
-typedef std::map<Edge, IndexType> MidpointMap;
-
-inline IndexType EdgeMidpoint(Mesh *mesh, MidpointMap *midpoints, Edge e)
-{
-    auto index = midpoints->find(e);
-    if (index == midpoints->end()) {
-        auto a = mesh->vertices[e.v0];
-        auto b = mesh->vertices[e.v1];
+    assert(outMesh->indices.size() % 3 == 0);  // trilist
+    size_t vertexCount = outMesh->vertices.size();
+    HalfEdges halfEdges;
+    build_half_edges(outMesh->indices.data(), outMesh->indices.size(), vertexCount, &halfEdges);
+
+    // One new vertex per edge, at its midpoint, numbered like the edge
+    size_t edgeCount = halfEdges.edge_half_edge.size();
+    // The new vertices have to be addressable with Index
+    assert(vertexCount + edgeCount - 1 <= size_t(std::numeric_limits<Index>::max()));
+    outMesh->vertices.resize(vertexCount + edgeCount);
+    for (size_t e = 0; e < edgeCount; ++e) {
+        uint32_t h = halfEdges.edge_half_edge[e];
+        auto a = outMesh->vertices[outMesh->indices[h]];
+        auto b = outMesh->vertices[outMesh->indices[next_half_edge(h)]];
 
         Vertex m;
         m.x = (a.x + b.x) * 0.5f;
         m.y = (a.y + b.y) * 0.5f;
         m.z = (a.z + b.z) * 0.5f;
-
-        index = midpoints->insert(std::make_pair(e, static_cast<IndexType>(mesh->vertices.size())))
-                    .first;
-        mesh->vertices.push_back(m);
+        outMesh->vertices[vertexCount + e] = m;
     }
-    return index->second;
-}
 
-void SubdivideInPlace(Mesh *outMesh)
-{
-    MidpointMap midpoints;
-
-    std::vector<IndexType> newIndices;
-    newIndices.reserve(outMesh->indices.size() * 4);
-    outMesh->vertices.reserve(outMesh->vertices.size() * 2);
-
-    assert(outMesh->indices.size() % 3 == 0);  // trilist
+    // Each triangle only reads its own corners and edges
     size_t triangles = outMesh->indices.size() / 3;
+    std::vector<Index> newIndices(outMesh->indices.size() * 4);
     for (size_t t = 0; t < triangles; ++t) {
         auto t0 = outMesh->indices[t * 3 + 0];
         auto t1 = outMesh->indices[t * 3 + 1];
         auto t2 = outMesh->indices[t * 3 + 2];
 
-        auto m0 = EdgeMidpoint(outMesh, &midpoints, Edge(t0, t1));
-        auto m1 = EdgeMidpoint(outMesh, &midpoints, Edge(t1, t2));
-        auto m2 = EdgeMidpoint(outMesh, &midpoints, Edge(t2, t0));
+        auto m0 = static_cast<Index>(vertexCount + halfEdges.edge[t * 3 + 0]);
+        auto m1 = static_cast<Index>(vertexCount + halfEdges.edge[t * 3 + 1]);
+        auto m2 = static_cast<Index>(vertexCount + halfEdges.edge[t * 3 + 2]);
 
-        IndexType indices[] = {
+        Index indices[] = {
             t0, m0, m2, m0, t1, m1, m0, m1, m2, m2, m1, t2,
         };
-        newIndices.insert(newIndices.end(), indices, indices + 4 * 3);
+        std::copy(indices, indices + 4 * 3, newIndices.begin() + t * 4 * 3);
     }
 
     std::swap(outMesh->indices, newIndices);  // Constant time
 }
 
-void SpherifyInPlace(Mesh *outMesh, float radius)
+template <typename Index>
+void SpherifyInPlace(BasicMesh<Index> *outMesh, float radius)
 {
     for (auto &v : outMesh->vertices) {
         float n = radius / std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
@@ -129,16 +121,12 @@ void SpherifyInPlace(Mesh *outMesh, float radius)
     }
 }
 
-void ComputeAvgNormalsInPlace(Mesh *outMesh)
+template <typename Index>
+void ComputeAvgNormalsInPlace(BasicMesh<Index> *outMesh)
 {
-    for (auto &v : outMesh->vertices) {
-        v.nx = 0.0f;
-        v.ny = 0.0f;
-        v.nz = 0.0f;
-    }
-
     assert(outMesh->indices.size() % 3 == 0);  // trilist
     size_t triangles = outMesh->indices.size() / 3;
+    std::vector<float> faceNormals(triangles * 3);
     for (size_t t = 0; t < triangles; ++t) {
         auto v1 = &outMesh->vertices[outMesh->indices[t * 3 + 0]];
         auto v2 = &outMesh->vertices[outMesh->indices[t * 3 + 1]];
@@ -153,39 +141,49 @@ void ComputeAvgNormalsInPlace(Mesh *outMesh)
         auto vz = v3->z - v1->z;
 
         // cross(u,v)
-        float nx = uy * vz - uz * vy;
-        float ny = uz * vx - ux * vz;
-        float nz = ux * vy - uy * vx;
-
         // Do not normalize... weight average by contributing face area
-        v1->nx += nx;
-        v1->ny += ny;
-        v1->nz += nz;
-        v2->nx += nx;
-        v2->ny += ny;
-        v2->nz += nz;
-        v3->nx += nx;
-        v3->ny += ny;
-        v3->nz += nz;
+        faceNormals[t * 3 + 0] = uy * vz - uz * vy;
+        faceNormals[t * 3 + 1] = uz * vx - ux * vz;
+        faceNormals[t * 3 + 2] = ux * vy - uy * vx;
     }
 
-    // Normalize
-    for (auto &v : outMesh->vertices) {
-        float n = 1.0f / std::sqrt(v.nx * v.nx + v.ny * v.ny + v.nz * v.nz);
-        v.nx *= n;
-        v.ny *= n;
-        v.nz *= n;
+    // Each vertex gathers the faces around it, so no two vertices write to
+    // the same place
+    HalfEdges halfEdges;
+    build_half_edges(outMesh->indices.data(), outMesh->indices.size(), outMesh->vertices.size(),
+                     &halfEdges);
+    for (size_t i = 0; i < outMesh->vertices.size(); ++i) {
+        auto &v = outMesh->vertices[i];
+        float nx = 0.0f;
+        float ny = 0.0f;
+        float nz = 0.0f;
+        uint32_t first = halfEdges.vertex_half_edge[i];
+        for (uint32_t h = first; h != kNoHalfEdge;) {
+            const float *n = &faceNormals[h - h % 3];
+            nx += n[0];
+            ny += n[1];
+            nz += n[2];
+            h = next_in_fan(halfEdges, h);
+            if (h == first) break;
+        }
+
+        // Normalize
+        float n = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+        v.nx = nx * n;
+        v.ny = ny * n;
+        v.nz = nz * n;
     }
 }
 
-void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount,
+template <typename Index>
+void CreateGeospheres(BasicMesh<Index> *outMesh, unsigned int subdivLevelCount,
                       unsigned int *outSubdivIndexOffsets)
 {
     CreateIcosahedron(outMesh);
     outSubdivIndexOffsets[0] = 0;
 
     std::vector<Vertex> vertices(outMesh->vertices);
-    std::vector<IndexType> indices(outMesh->indices);
+    std::vector<Index> indices(outMesh->indices);
 
     for (unsigned int i = 0; i < subdivLevelCount; ++i) {
         outSubdivIndexOffsets[i + 1] = (unsigned int)indices.size();
@@ -193,70 +191,548 @@ void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount,
 
         // Ensure we add the proper offset to the indices from this subdiv level for the combined
         // mesh This avoids also needing to track a base vertex index for each subdiv level
-        IndexType vertexOffset = (IndexType)vertices.size();
+        assert(vertices.size() + outMesh->vertices.size() - 1 <=
+               size_t(std::numeric_limits<Index>::max()));
+        Index vertexOffset = (Index)vertices.size();
         vertices.insert(vertices.end(), outMesh->vertices.begin(), outMesh->vertices.end());
 
         for (auto newIndex : outMesh->indices) {
-            indices.push_back(newIndex + vertexOffset);
+            indices.push_back(static_cast<Index>(newIndex + vertexOffset));
         }
     }
     outSubdivIndexOffsets[subdivLevelCount + 1] = (unsigned int)indices.size();
 
-    SpherifyInPlace(outMesh);
-
     // Put the union of vertices/indices back into the mesh object
     std::swap(outMesh->indices, indices);
     std::swap(outMesh->vertices, vertices);
+
+    // Every level, not just the last, has to lie on the sphere
+    SpherifyInPlace(outMesh);
 }
 
-void CreateAsteroidsFromGeospheres(Mesh *outMesh, unsigned int subdivLevelCount,
-                                   unsigned int meshInstanceCount, unsigned int rngSeed,
-                                   unsigned int *outSubdivIndexOffsets,
-                                   unsigned int *vertexCountPerMesh)
+template <typename Index>
+void OptimizeGeospheres(BasicMesh<Index> *mesh, unsigned int subdivLevelCount,
+                        const unsigned int *subdivIndexOffsets)
 {
-    assert(subdivLevelCount <= meshInstanceCount);
+    size_t vertexCount = mesh->vertices.size();
+    for (unsigned int i = 0; i <= subdivLevelCount; ++i) {
+        optimize_vertex_cache(mesh->indices.data() + subdivIndexOffsets[i],
+                              subdivIndexOffsets[i + 1] - subdivIndexOffsets[i], vertexCount);
+    }
+
+    // Each level only uses its own vertices, so the levels stay in order
+    // and contiguous
+    std::vector<uint32_t> remap =
+        optimize_vertex_fetch(mesh->indices.data(), mesh->indices.size(), vertexCount);
+    remap_vertices(&mesh->vertices, remap);
+}
+
+// Vertices in CreateGeospheres' output: the icosahedron's 12 plus those of
+// every subdivided level, each of which has 10 * 4^level + 2
+static size_t GeosphereVertexCount(unsigned int subdivLevelCount)
+{
+    size_t count = 12;
+    for (unsigned int level = 1; level <= subdivLevelCount; ++level) {
+        count += (size_t(10) << (2 * level)) + 2;
+    }
+    return count;
+}
+
+// Rounds v in [-1, 1] to the nearest 16-bit snorm value
+static short ToSnorm16(float v)
+{
+    v = std::min(std::max(v, -1.0f), 1.0f) * 32767.0f;
+    return (short)(v < 0.0f ? v - 0.5f : v + 0.5f);
+}
+
+static float FromSnorm16(short v) { return std::max((float)v / 32767.0f, -1.0f); }
+
+void EncodeOctahedralNormal(float nx, float ny, float nz, short *outX, short *outY)
+{
+    float l1 = std::abs(nx) + std::abs(ny) + std::abs(nz);
+    float x = nx / l1;
+    float y = ny / l1;
+    if (nz < 0.0f) {
+        float foldX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldX;
+        y = foldY;
+    }
+    *outX = ToSnorm16(x);
+    *outY = ToSnorm16(y);
+}
+
+// Matches the decode in the vertex shaders
+void DecodeOctahedralNormal(short x, short y, float *outNx, float *outNy, float *outNz)
+{
+    float nx = FromSnorm16(x);
+    float ny = FromSnorm16(y);
+    float nz = 1.0f - std::abs(nx) - std::abs(ny);
+    float fold = std::max(-nz, 0.0f);
+    nx += nx >= 0.0f ? -fold : fold;
+    ny += ny >= 0.0f ? -fold : fold;
+    float n = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+    *outNx = nx * n;
+    *outNy = ny * n;
+    *outNz = nz * n;
+}
+
+float ComputePositionScale(const Vertex *vertices, size_t count)
+{
+    float scale = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        scale = std::max(scale, std::abs(vertices[i].x));
+        scale = std::max(scale, std::abs(vertices[i].y));
+        scale = std::max(scale, std::abs(vertices[i].z));
+    }
+    return scale > 0.0f ? scale : 1.0f;
+}
+
+void PackVertices(const Vertex *vertices, size_t count, float positionScale,
+                  PackedVertex *outVertices)
+{
+    float invScale = 1.0f / positionScale;
+    for (size_t i = 0; i < count; ++i) {
+        const Vertex &v = vertices[i];
+        PackedVertex &p = outVertices[i];
+        p.x = ToSnorm16(v.x * invScale);
+        p.y = ToSnorm16(v.y * invScale);
+        p.z = ToSnorm16(v.z * invScale);
+        p.w = 32767;
+        EncodeOctahedralNormal(v.nx, v.ny, v.nz, &p.octX, &p.octY);
+    }
+}
+
+template <typename Index>
+void BuildMeshlets(const Index *indices, unsigned int indexOffset, unsigned int indexCount,
+                   size_t vertexCount, std::vector<Meshlet> *outMeshlets)
+{
+    assert(indexCount % 3 == 0);
+    outMeshlets->clear();
+
+    // Meshlet number + 1 that last used each vertex
+    std::vector<unsigned int> stamp(vertexCount, 0);
+    Meshlet current = {indexOffset, 0};
+    unsigned int currentVertices = 0;
+    for (unsigned int i = indexOffset; i < indexOffset + indexCount; i += 3) {
+        unsigned int id = (unsigned int)outMeshlets->size() + 1;
+        unsigned int newVertices = 0;
+        for (unsigned int c = 0; c < 3; ++c) {
+            assert(indices[i + c] < vertexCount);
+            newVertices += stamp[indices[i + c]] != id ? 1 : 0;
+        }
+        if (current.indexCount == 3 * kMeshletMaxTriangles ||
+            currentVertices + newVertices > kMeshletMaxVertices) {
+            outMeshlets->push_back(current);
+            current.indexOffset = i;
+            current.indexCount = 0;
+            currentVertices = 0;
+            ++id;
+        }
+        for (unsigned int c = 0; c < 3; ++c) {
+            if (stamp[indices[i + c]] != id) {
+                stamp[indices[i + c]] = id;
+                ++currentVertices;
+            }
+        }
+        current.indexCount += 3;
+    }
+    if (current.indexCount > 0) {
+        outMeshlets->push_back(current);
+    }
+}
+
+template <typename Index>
+void ComputeMeshletBounds(const Index *indices, const Meshlet *meshlets, size_t meshletCount,
+                          const Vertex *vertices, MeshletBounds *outBounds)
+{
+    using namespace mathfu;
+
+    std::vector<float3> normals;
+    for (size_t m = 0; m < meshletCount; ++m) {
+        const Index *first = indices + meshlets[m].indexOffset;
+        const Index *last = first + meshlets[m].indexCount;
+
+        // Sphere around the centre of the bounding box
+        float3 lo(std::numeric_limits<float>::max());
+        float3 hi(-std::numeric_limits<float>::max());
+        for (const Index *i = first; i != last; ++i) {
+            float3 p(vertices[*i].x, vertices[*i].y, vertices[*i].z);
+            lo = float3::Min(lo, p);
+            hi = float3::Max(hi, p);
+        }
+        float3 center = (lo + hi) * 0.5f;
+        float radius = 0.0f;
+        for (const Index *i = first; i != last; ++i) {
+            float3 p(vertices[*i].x, vertices[*i].y, vertices[*i].z);
+            radius = std::max(radius, (p - center).Length());
+        }
 
-    std::mt19937 rng(rngSeed);
+        // Cone around the average outward face normal. The apex is left out:
+        // the sphere radius is added to the distance test instead, which is
+        // conservative for any apex inside the sphere.
+        float3 axis(0.0f);
+        normals.clear();
+        for (const Index *i = first; i != last; i += 3) {
+            const Vertex &a = vertices[i[0]];
+            const Vertex &b = vertices[i[1]];
+            const Vertex &c = vertices[i[2]];
+            float3 n = float3::CrossProduct(float3(c.x - a.x, c.y - a.y, c.z - a.z),
+                                            float3(b.x - a.x, b.y - a.y, b.z - a.z));
+            float length = n.Length();
+            if (length > 0.0f) {
+                normals.push_back(n / length);
+                axis += normals.back();
+            }
+        }
+        float axisLength = axis.Length();
+        float minDot = 1.0f;
+        if (axisLength > 0.0f) {
+            axis /= axisLength;
+            for (const float3 &n : normals) {
+                minDot = std::min(minDot, float3::DotProduct(axis, n));
+            }
+        } else {
+            axis = float3(0.0f, 0.0f, 1.0f);
+            minDot = -1.0f;
+        }
 
-    Mesh baseMesh;
+        MeshletBounds &bounds = outBounds[m];
+        bounds.center[0] = center.x;
+        bounds.center[1] = center.y;
+        bounds.center[2] = center.z;
+        bounds.radius = radius;
+        bounds.coneAxis[0] = axis.x;
+        bounds.coneAxis[1] = axis.y;
+        bounds.coneAxis[2] = axis.z;
+        // The view direction has to be within 90 degrees minus the cone's
+        // half angle of the axis; wide cones would hardly ever cull anything
+        bounds.coneCutoff = minDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+// SplitMix64 finalizer. Gives every mesh instance an independent seed that
+// depends only on the caller's seed and the instance, not on which thread or
+// in what order the instances are generated.
+static unsigned int InstanceSeed(unsigned int rngSeed, unsigned int instance)
+{
+    uint64_t z = ((uint64_t)rngSeed << 32 | instance) + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return (unsigned int)(z ^ (z >> 31));
+}
+
+// Displaces a copy of the base vertices into outVertices with
+// instance-specific noise. The base vertices lie on the unit sphere, so each
+// displaced vertex is p = r(u) * u and its normal follows from the analytic
+// noise gradient alone: n ~ r * u - (grad r - (grad r . u) * u). It is
+// negated to keep the orientation ComputeAvgNormalsInPlace gives for this
+// winding. noiseCoords holds the base vertices in noise space as x, y and z
+// arrays; scratch has room for six floats per vertex.
+static void CreateAsteroidInstance(const std::vector<Vertex> &baseVertices,
+                                   const float *noiseCoords, const AsteroidNoiseParams &params,
+                                   unsigned int seed, simd::InstructionSet isa, float *scratch,
+                                   Vertex *outVertices)
+{
+    std::mt19937 rng(seed);
+
+    auto randomNoise = std::uniform_real_distribution<float>(0.0f, params.maxNoiseOffset);
+    auto randomPersistence =
+        std::normal_distribution<float>(params.persistenceMean, params.persistenceStdDev);
+    float radiusScale = params.radiusScale;
+    float radiusBias = params.radiusBias;
+
+    NoiseOctaves<4> textureNoise(randomPersistence(rng));
+    float noise = randomNoise(rng);
+
+    size_t vertexCount = baseVertices.size();
+    float *noiseW = scratch;
+    float *radii = scratch + vertexCount;
+    float *gradient[4] = {scratch + 2 * vertexCount, scratch + 3 * vertexCount,
+                          scratch + 4 * vertexCount, scratch + 5 * vertexCount};
+    std::fill(noiseW, noiseW + vertexCount, noise);
+    textureNoise(noiseCoords, noiseCoords + vertexCount, noiseCoords + 2 * vertexCount, noiseW,
+                 vertexCount, radii, gradient, isa);
+
+    // d radius / d position, through the noise-space scale
+    float gradientScale = radiusScale * params.noiseScale;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        auto v = baseVertices[i];
+        float radius = radii[i] * radiusScale + radiusBias;
+        float gx = gradient[0][i] * gradientScale;
+        float gy = gradient[1][i] * gradientScale;
+        float gz = gradient[2][i] * gradientScale;
+        float radial = gx * v.x + gy * v.y + gz * v.z;
+        float nx = (gx - radial * v.x) - radius * v.x;
+        float ny = (gy - radial * v.y) - radius * v.y;
+        float nz = (gz - radial * v.z) - radius * v.z;
+        float n = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+        v.nx = nx * n;
+        v.ny = ny * n;
+        v.nz = nz * n;
+        v.x *= radius;
+        v.y *= radius;
+        v.z *= radius;
+        outVertices[i] = v;
+    }
+}
+
+// Generates the geospheres and the displaced vertices of every mesh instance.
+// Each instance is written to outVertices + m * vertexCount when outVertices is
+// set, otherwise to per-thread scratch; either way finishInstance(m, vertices)
+// is called once it is complete. prepareInstances(indices) is called with the
+// optimized geosphere indices before any instance is generated; they stay
+// valid until this returns them as the combined indices.
+template <typename Index, typename PrepareInstances, typename FinishInstance>
+static std::vector<Index> CreateAsteroidInstances(
+    unsigned int subdivLevelCount, unsigned int meshInstanceCount, unsigned int rngSeed,
+    unsigned int *outSubdivIndexOffsets, unsigned int *vertexCountPerMesh, JobSystem *jobs,
+    const AsteroidNoiseParams &noiseParams, Vertex *outVertices,
+    PrepareInstances prepareInstances, FinishInstance finishInstance)
+{
+    assert(subdivLevelCount <= meshInstanceCount);
+
+    BasicMesh<Index> baseMesh;
     CreateGeospheres(&baseMesh, subdivLevelCount, outSubdivIndexOffsets);
+    OptimizeGeospheres(&baseMesh, subdivLevelCount, outSubdivIndexOffsets);
+    prepareInstances(baseMesh.indices);
 
     // Per unique mesh
-    *vertexCountPerMesh = (unsigned int)baseMesh.vertices.size();
-    std::vector<Vertex> vertices;
-    vertices.reserve(meshInstanceCount * baseMesh.vertices.size());
-    // Reuse indices for the different unique meshes
-
-    auto randomNoise = std::uniform_real_distribution<float>(0.0f, 10000.0f);
-    auto randomPersistence = std::normal_distribution<float>(0.95f, 0.04f);
-    float noiseScale = 0.5f;
-    float radiusScale = 0.9f;
-    float radiusBias = 0.3f;
+    size_t vertexCount = baseMesh.vertices.size();
+    *vertexCountPerMesh = (unsigned int)vertexCount;
+
+    // Every instance samples the noise at the same base positions, so
+    // transpose them to noise-space arrays once up front
+    float noiseScale = noiseParams.noiseScale;
+    std::vector<float> noiseCoords(3 * vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        noiseCoords[i] = baseMesh.vertices[i].x * noiseScale;
+        noiseCoords[vertexCount + i] = baseMesh.vertices[i].y * noiseScale;
+        noiseCoords[2 * vertexCount + i] = baseMesh.vertices[i].z * noiseScale;
+    }
+    simd::InstructionSet isa = simd::best_instruction_set();
 
     // Create and randomize unique vertices for each mesh instance
-    for (unsigned int m = 0; m < meshInstanceCount; ++m) {
-        Mesh newMesh(baseMesh);
-        NoiseOctaves<4> textureNoise(randomPersistence(rng));
-        float noise = randomNoise(rng);
-
-        for (auto &v : newMesh.vertices) {
-            float radius =
-                textureNoise(v.x * noiseScale, v.y * noiseScale, v.z * noiseScale, noise);
-            radius = radius * radiusScale + radiusBias;
-            v.x *= radius;
-            v.y *= radius;
-            v.z *= radius;
+    auto createInstances = [&](size_t begin, size_t end) {
+        std::vector<float> scratch(6 * vertexCount);
+        std::vector<Vertex> instanceScratch(outVertices ? 0 : vertexCount);
+        for (size_t m = begin; m < end; ++m) {
+            Vertex *vertices = outVertices ? outVertices + m * vertexCount : instanceScratch.data();
+            CreateAsteroidInstance(baseMesh.vertices, noiseCoords.data(), noiseParams,
+                                   InstanceSeed(rngSeed, (unsigned int)m), isa, scratch.data(),
+                                   vertices);
+            finishInstance(m, vertices);
         }
-        ComputeAvgNormalsInPlace(&newMesh);
-
-        vertices.insert(vertices.end(), newMesh.vertices.begin(), newMesh.vertices.end());
+    };
+    if (jobs) {
+        jobs->parallel_for(meshInstanceCount,
+                           jobs->chunk_size(meshInstanceCount, vertexCount * sizeof(Vertex)),
+                           createInstances);
+    } else {
+        createInstances(0, meshInstanceCount);
     }
 
+    return std::move(baseMesh.indices);
+}
+
+template <typename Index>
+void CreateAsteroidsFromGeospheres(BasicMesh<Index> *outMesh, unsigned int subdivLevelCount,
+                                   unsigned int meshInstanceCount, unsigned int rngSeed,
+                                   unsigned int *outSubdivIndexOffsets,
+                                   unsigned int *vertexCountPerMesh, JobSystem *jobs,
+                                   const AsteroidNoiseParams &noiseParams)
+{
+    // Reuse indices for the different unique meshes, and generate each
+    // instance straight into its slice of the combined vertex array
+    std::vector<Vertex> vertices(meshInstanceCount * GeosphereVertexCount(subdivLevelCount));
+    std::vector<Index> indices = CreateAsteroidInstances<Index>(
+        subdivLevelCount, meshInstanceCount, rngSeed, outSubdivIndexOffsets, vertexCountPerMesh,
+        jobs, noiseParams, vertices.data(), [](const std::vector<Index> &) {},
+        [](size_t, const Vertex *) {});
+    assert(vertices.size() == meshInstanceCount * (size_t)*vertexCountPerMesh);
+
     // Copy to output
-    std::swap(outMesh->indices, baseMesh.indices);
+    std::swap(outMesh->indices, indices);
     std::swap(outMesh->vertices, vertices);
 }
 
+template <typename Index>
+void CreateAsteroidsFromGeospheres(BasicPackedMesh<Index> *outMesh, unsigned int subdivLevelCount,
+                                   unsigned int meshInstanceCount, unsigned int rngSeed,
+                                   unsigned int *outSubdivIndexOffsets,
+                                   unsigned int *vertexCountPerMesh, JobSystem *jobs,
+                                   const AsteroidNoiseParams &noiseParams)
+{
+    size_t vertexCount = GeosphereVertexCount(subdivLevelCount);
+    std::vector<PackedVertex> vertices(meshInstanceCount * vertexCount);
+    std::vector<float> positionScales(meshInstanceCount);
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> meshletBounds;
+    const Index *baseIndices = nullptr;
+    std::vector<Index> indices = CreateAsteroidInstances<Index>(
+        subdivLevelCount, meshInstanceCount, rngSeed, outSubdivIndexOffsets, vertexCountPerMesh,
+        jobs, noiseParams, nullptr,
+        [&](const std::vector<Index> &geosphereIndices) {
+            // The most detailed level, once its triangles are in their final order
+            baseIndices = geosphereIndices.data();
+            unsigned int offset = outSubdivIndexOffsets[subdivLevelCount];
+            BuildMeshlets(baseIndices, offset,
+                          outSubdivIndexOffsets[subdivLevelCount + 1] - offset, vertexCount,
+                          &meshlets);
+            meshletBounds.resize(meshInstanceCount * meshlets.size());
+        },
+        [&](size_t m, const Vertex *instance) {
+            float scale = ComputePositionScale(instance, vertexCount);
+            positionScales[m] = scale;
+            PackVertices(instance, vertexCount, scale, vertices.data() + m * vertexCount);
+            ComputeMeshletBounds(baseIndices, meshlets.data(), meshlets.size(), instance,
+                                 meshletBounds.data() + m * meshlets.size());
+        });
+    assert(vertexCount == *vertexCountPerMesh);
+
+    std::swap(outMesh->indices, indices);
+    std::swap(outMesh->vertices, vertices);
+    std::swap(outMesh->positionScales, positionScales);
+    std::swap(outMesh->meshlets, meshlets);
+    std::swap(outMesh->meshletBounds, meshletBounds);
+}
+
+template <typename Index>
+void SimplifyAsteroidLods(BasicPackedMesh<Index> *mesh, unsigned int subdivLevelCount,
+                          const unsigned int *subdivIndexOffsets, unsigned int vertexCountPerMesh,
+                          const float *lodTriangleRatios, unsigned int lodCount, JobSystem *jobs)
+{
+    size_t meshInstanceCount = mesh->positionScales.size();
+    unsigned int fullOffset = subdivIndexOffsets[subdivLevelCount];
+    unsigned int fullCount = subdivIndexOffsets[subdivLevelCount + 1] - fullOffset;
+    const Index *fullIndices = mesh->indices.data() + fullOffset;
+
+    // Each instance's levels, coarsest first
+    std::vector<std::vector<Index>> instanceIndices(meshInstanceCount);
+    std::vector<unsigned int> counts(meshInstanceCount * lodCount);
+    std::vector<float> errors(meshInstanceCount * lodCount);
+    auto simplifyInstances = [&](size_t begin, size_t end) {
+        std::vector<float> positions(3 * (size_t)vertexCountPerMesh);
+        std::vector<std::vector<Index>> levels(lodCount);
+        for (size_t m = begin; m < end; ++m) {
+            const PackedVertex *vertices = mesh->vertices.data() + m * vertexCountPerMesh;
+            float scale = mesh->positionScales[m] / 32767.0f;
+            for (size_t i = 0; i < vertexCountPerMesh; ++i) {
+                positions[3 * i + 0] = vertices[i].x * scale;
+                positions[3 * i + 1] = vertices[i].y * scale;
+                positions[3 * i + 2] = vertices[i].z * scale;
+            }
+
+            const Index *source = fullIndices;
+            size_t sourceCount = fullCount;
+            float error = 0.0f;
+            for (unsigned int l = lodCount; l-- > 0;) {
+                size_t target = (size_t)((float)(fullCount / 3) * lodTriangleRatios[l]) * 3;
+                std::vector<Index> &level = levels[l];
+                level.resize(sourceCount);
+                float levelError = 0.0f;
+                level.resize(simplify_mesh(level.data(), source, sourceCount, positions.data(),
+                                           vertexCountPerMesh, 3 * sizeof(float), target,
+                                           std::numeric_limits<float>::max(), &levelError));
+                optimize_vertex_cache(level.data(), level.size(), vertexCountPerMesh);
+                error += levelError;
+                errors[m * lodCount + l] = error;
+                counts[m * lodCount + l] = (unsigned int)level.size();
+                source = level.data();
+                sourceCount = level.size();
+            }
+            for (unsigned int l = 0; l < lodCount; ++l) {
+                instanceIndices[m].insert(instanceIndices[m].end(), levels[l].begin(),
+                                          levels[l].end());
+            }
+        }
+    };
+    if (jobs) {
+        jobs->parallel_for(meshInstanceCount,
+                           jobs->chunk_size(meshInstanceCount, fullCount * sizeof(Index)),
+                           simplifyInstances);
+    } else {
+        simplifyInstances(0, meshInstanceCount);
+    }
+
+    mesh->lodIndexOffsets.assign(1, (unsigned int)mesh->indices.size());
+    for (size_t m = 0; m < meshInstanceCount; ++m) {
+        mesh->indices.insert(mesh->indices.end(), instanceIndices[m].begin(),
+                             instanceIndices[m].end());
+        for (unsigned int l = 0; l < lodCount; ++l) {
+            mesh->lodIndexOffsets.push_back(mesh->lodIndexOffsets.back() +
+                                            counts[m * lodCount + l]);
+        }
+    }
+    std::swap(mesh->lodErrors, errors);
+}
+
+template <typename Index>
+void DropCoarseGeosphereLevels(BasicPackedMesh<Index> *mesh, unsigned int subdivLevelCount,
+                               unsigned int *subdivIndexOffsets, unsigned int *vertexCountPerMesh)
+{
+    // Every level has vertices of its own, and the most detailed level's come
+    // last in each instance, so the rest go and its indices move down
+    assert(*vertexCountPerMesh == GeosphereVertexCount(subdivLevelCount));
+    unsigned int firstVertex =
+        subdivLevelCount > 0 ? (unsigned int)GeosphereVertexCount(subdivLevelCount - 1) : 0;
+    unsigned int vertexCount = *vertexCountPerMesh - firstVertex;
+    size_t meshInstanceCount = mesh->positionScales.size();
+    for (size_t m = 0; m < meshInstanceCount; ++m) {
+        auto first = mesh->vertices.begin() + m * *vertexCountPerMesh + firstVertex;
+        std::copy(first, first + vertexCount, mesh->vertices.begin() + m * vertexCount);
+    }
+    mesh->vertices.resize(meshInstanceCount * vertexCount);
+    *vertexCountPerMesh = vertexCount;
+
+    unsigned int removed = subdivIndexOffsets[subdivLevelCount];
+    mesh->indices.erase(mesh->indices.begin(), mesh->indices.begin() + removed);
+    for (auto &index : mesh->indices) {
+        assert(index >= firstVertex);
+        index = (Index)(index - firstVertex);
+    }
+    for (unsigned int i = 0; i <= subdivLevelCount; ++i) {
+        subdivIndexOffsets[i] = 0;
+    }
+    subdivIndexOffsets[subdivLevelCount + 1] -= removed;
+    for (auto &meshlet : mesh->meshlets) {
+        meshlet.indexOffset -= removed;
+    }
+    for (auto &offset : mesh->lodIndexOffsets) {
+        offset -= removed;
+    }
+}
+
+// The mesh functions are only instantiated for these index types
+#define INSTANTIATE_MESH_FUNCTIONS(Index)                                                         \
+    template void CreateIcosahedron(BasicMesh<Index> *);                                          \
+    template void SubdivideInPlace(BasicMesh<Index> *);                                           \
+    template void SpherifyInPlace(BasicMesh<Index> *, float);                                     \
+    template void ComputeAvgNormalsInPlace(BasicMesh<Index> *);                                   \
+    template void CreateGeospheres(BasicMesh<Index> *, unsigned int, unsigned int *);             \
+    template void OptimizeGeospheres(BasicMesh<Index> *, unsigned int, const unsigned int *);     \
+    template void BuildMeshlets(const Index *, unsigned int, unsigned int, size_t,                \
+                                std::vector<Meshlet> *);                                          \
+    template void ComputeMeshletBounds(const Index *, const Meshlet *, size_t, const Vertex *,    \
+                                       MeshletBounds *);                                          \
+    template void CreateAsteroidsFromGeospheres(BasicMesh<Index> *, unsigned int, unsigned int,   \
+                                                unsigned int, unsigned int *, unsigned int *,     \
+                                                JobSystem *, const AsteroidNoiseParams &);        \
+    template void CreateAsteroidsFromGeospheres(BasicPackedMesh<Index> *, unsigned int,           \
+                                                unsigned int, unsigned int, unsigned int *,       \
+                                                unsigned int *, JobSystem *,                      \
+                                                const AsteroidNoiseParams &);                     \
+    template void SimplifyAsteroidLods(BasicPackedMesh<Index> *, unsigned int,                    \
+                                       const unsigned int *, unsigned int, const float *,         \
+                                       unsigned int, JobSystem *);                                \
+    template void DropCoarseGeosphereLevels(BasicPackedMesh<Index> *, unsigned int,               \
+                                            unsigned int *, unsigned int *);
+
+INSTANTIATE_MESH_FUNCTIONS(unsigned short)
+INSTANTIATE_MESH_FUNCTIONS(unsigned int)
+
+#undef INSTANTIATE_MESH_FUNCTIONS
+
 void CreateSkyboxMesh(std::vector<SkyboxVertex> *outVertices)
 {
     // See http://msdn.microsoft.com/en-us/library/windows/desktop/bb204881(v=vs.85).aspx
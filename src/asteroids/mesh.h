@@ -16,11 +16,17 @@
 
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
+class JobSystem;
+
+// Index type of Mesh and PackedMesh. The mesh functions below are templates
+// over the index type and also work with 32-bit indices (Mesh32, PackedMesh32)
+// for meshes with more than 65535 vertices, e.g. geospheres past level 6.
 typedef unsigned short IndexType;
 
-// NOTE: This data could be compressed, but it's not really the bottleneck at the moment
+// Full precision vertex; see PackedVertex for the compact format used for rendering
 struct Vertex
 {
     float x;
@@ -31,7 +37,8 @@ struct Vertex
     float nz;
 };
 
-struct Mesh
+template <typename Index>
+struct BasicMesh
 {
     void clear()
     {
@@ -40,31 +47,196 @@ struct Mesh
     }
 
     std::vector<Vertex> vertices;
-    std::vector<IndexType> indices;
+    std::vector<Index> indices;
+};
+
+typedef BasicMesh<IndexType> Mesh;
+typedef BasicMesh<unsigned int> Mesh32;
+
+// Compact vertex for rendering, 12 bytes instead of 24. Positions are 16-bit
+// snorm fractions of a per-mesh scale, with w stored as 1 so they read back as
+// a homogeneous point; the normal is octahedral-encoded into two 16-bit snorms.
+struct PackedVertex
+{
+    short x;
+    short y;
+    short z;
+    short w;
+    short octX;
+    short octY;
+};
+
+// A cluster of nearby triangles, stored as a contiguous range of a mesh's
+// index list, with at most kMeshletMaxVertices distinct vertices and
+// kMeshletMaxTriangles triangles
+struct Meshlet
+{
+    unsigned int indexOffset;
+    unsigned int indexCount;
+};
+
+static const unsigned int kMeshletMaxVertices = 64;
+static const unsigned int kMeshletMaxTriangles = 124;
+
+// Culling data of one meshlet of one mesh instance, in mesh space. Every
+// triangle is back facing from any point p with
+// dot(center - p, coneAxis) >= coneCutoff * |center - p| + radius; a
+// coneCutoff of 1 or more means the triangles face too many ways to cull.
+struct MeshletBounds
+{
+    float center[3];
+    float radius;
+    float coneAxis[3];
+    float coneCutoff;
+};
+
+// Same layout as Mesh, but with PackedVertex. The vertices of mesh instance m
+// are quantized relative to positionScales[m], which has to be applied when
+// drawing it (e.g. folded into its world matrix). The most detailed level is
+// split into meshlets, which all instances share; meshletBounds has one entry
+// per meshlet per instance, instance by instance, from the full precision
+// vertices. SimplifyAsteroidLods optionally appends lodCount simplified
+// levels of detail per instance to indices, so every level is in one index
+// list: level l of instance m is indices
+// [lodIndexOffsets[m * lodCount + l], lodIndexOffsets[m * lodCount + l + 1]),
+// which index the instance's vertices the same way the geosphere levels do,
+// and lodErrors[m * lodCount + l] is its error in full precision position units.
+template <typename Index>
+struct BasicPackedMesh
+{
+    void clear()
+    {
+        vertices.clear();
+        indices.clear();
+        positionScales.clear();
+        meshlets.clear();
+        meshletBounds.clear();
+        lodIndexOffsets.clear();
+        lodErrors.clear();
+    }
+
+    std::vector<PackedVertex> vertices;
+    std::vector<Index> indices;
+    std::vector<float> positionScales;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> meshletBounds;
+    std::vector<unsigned int> lodIndexOffsets;
+    std::vector<float> lodErrors;
 };
 
-void CreateIcosahedron(Mesh *outMesh);
+typedef BasicPackedMesh<IndexType> PackedMesh;
+typedef BasicPackedMesh<unsigned int> PackedMesh32;
+
+// Octahedral normal encoding: projects the unit vector onto the octahedron
+// |x| + |y| + |z| = 1 and folds the lower half over the upper one, giving two
+// coordinates in [-1, 1]
+void EncodeOctahedralNormal(float nx, float ny, float nz, short *outX, short *outY);
+void DecodeOctahedralNormal(short x, short y, float *outNx, float *outNy, float *outNz);
+
+// Splits indices [indexOffset, indexOffset + indexCount) into meshlets,
+// greedily in index order, so the triangles should already be ordered for
+// locality (see OptimizeGeospheres)
+template <typename Index>
+void BuildMeshlets(const Index *indices, unsigned int indexOffset, unsigned int indexCount,
+                   size_t vertexCount, std::vector<Meshlet> *outMeshlets);
+
+// Bounding sphere and normal cone of each meshlet. Front faces are clockwise,
+// as for the geospheres and the renderer's pipeline state.
+template <typename Index>
+void ComputeMeshletBounds(const Index *indices, const Meshlet *meshlets, size_t meshletCount,
+                          const Vertex *vertices, MeshletBounds *outBounds);
+
+// Largest absolute coordinate among the vertices, or 1 if they are all at the origin
+float ComputePositionScale(const Vertex *vertices, size_t count);
+
+// Quantizes vertices whose coordinates lie in [-positionScale, positionScale]
+void PackVertices(const Vertex *vertices, size_t count, float positionScale,
+                  PackedVertex *outVertices);
+
+template <typename Index>
+void CreateIcosahedron(BasicMesh<Index> *outMesh);
 
 // 1 face -> 4 faces
-void SubdivideInPlace(Mesh *outMesh);
+template <typename Index>
+void SubdivideInPlace(BasicMesh<Index> *outMesh);
 
-void SpherifyInPlace(Mesh *outMesh, float radius = 1.0f);
+template <typename Index>
+void SpherifyInPlace(BasicMesh<Index> *outMesh, float radius = 1.0f);
 
-void ComputeAvgNormalsInPlace(Mesh *outMesh);
+template <typename Index>
+void ComputeAvgNormalsInPlace(BasicMesh<Index> *outMesh);
 
 // subdivIndexOffset array should be [subdivLevels+2] in size
-void CreateGeospheres(Mesh *outMesh, unsigned int subdivLevelCount,
+template <typename Index>
+void CreateGeospheres(BasicMesh<Index> *outMesh, unsigned int subdivLevelCount,
                       unsigned int *outSubdivIndexOffsets);
 
+// Reorders each level's triangles for the post-transform vertex cache, then
+// renumbers the vertices in order of first use. Takes the output of
+// CreateGeospheres; the index offsets are unchanged.
+template <typename Index>
+void OptimizeGeospheres(BasicMesh<Index> *mesh, unsigned int subdivLevelCount,
+                        const unsigned int *subdivIndexOffsets);
+
+// Shape of the asteroids from CreateAsteroidsFromGeospheres. Each vertex of
+// the unit geosphere is pushed out to radius noise * radiusScale + radiusBias.
+struct AsteroidNoiseParams
+{
+    float noiseScale = 0.5f;          // Frequency of the first noise octave
+    float radiusScale = 0.9f;
+    float radiusBias = 0.3f;
+    float persistenceMean = 0.95f;    // Per-instance octave persistence is drawn
+    float persistenceStdDev = 0.04f;  // from a normal distribution
+    float maxNoiseOffset = 10000.0f;  // Per-instance offset along the 4th noise axis
+};
+
 // Returns a combined "mesh" that includes:
 // - A set of indices for each subdiv level (outSubdivIndexOffsets for offsets/counts)
 // - A set of vertices for each mesh instance (base vertices per mesh computed from
 // vertexCountPerMesh) - Indices already have the vertex offsets for the correct subdiv level
 // "baked-in", so only need the mesh offset
-void CreateAsteroidsFromGeospheres(Mesh *outMesh, unsigned int subdivLevelCount,
+// The shared geospheres are optimized with OptimizeGeospheres before any
+// instance is displaced.
+// Each mesh instance is seeded from rngSeed and its own index, so the output is
+// identical whether or not it is generated in parallel on `jobs`
+template <typename Index>
+void CreateAsteroidsFromGeospheres(BasicMesh<Index> *outMesh, unsigned int subdivLevelCount,
                                    unsigned int meshInstanceCount, unsigned int rngSeed,
                                    unsigned int *outSubdivIndexOffsets,
-                                   unsigned int *vertexCountPerMesh);
+                                   unsigned int *vertexCountPerMesh, JobSystem *jobs = nullptr,
+                                   const AsteroidNoiseParams &noiseParams = AsteroidNoiseParams());
+
+// As above, but quantizes each mesh instance as it is generated, so the full
+// precision vertices for all instances never exist at once
+template <typename Index>
+void CreateAsteroidsFromGeospheres(BasicPackedMesh<Index> *outMesh, unsigned int subdivLevelCount,
+                                   unsigned int meshInstanceCount, unsigned int rngSeed,
+                                   unsigned int *outSubdivIndexOffsets,
+                                   unsigned int *vertexCountPerMesh, JobSystem *jobs = nullptr,
+                                   const AsteroidNoiseParams &noiseParams = AsteroidNoiseParams());
+
+// Simplifies the most detailed level of every mesh instance, after
+// displacement, into levels of detail that follow its actual silhouette.
+// Level l keeps about lodTriangleRatios[l] of the triangles; ratios go from
+// coarsest to finest. Each level is simplified from the next finer one and its
+// error adds up theirs, so it estimates the distance from the full detail
+// surface and never grows from coarse to fine. The instances are simplified in
+// parallel on `jobs`, and their indices are appended to the mesh's.
+template <typename Index>
+void SimplifyAsteroidLods(BasicPackedMesh<Index> *mesh, unsigned int subdivLevelCount,
+                          const unsigned int *subdivIndexOffsets, unsigned int vertexCountPerMesh,
+                          const float *lodTriangleRatios, unsigned int lodCount,
+                          JobSystem *jobs = nullptr);
+
+// Removes the geosphere levels coarser than the most detailed one, indices and
+// vertices, for renderers that draw the simplified levels of detail instead.
+// The most detailed level then starts at index 0: the coarser levels in
+// subdivIndexOffsets become empty, and the meshlets and simplified levels
+// move down to match. Each instance keeps only the most detailed level's
+// vertices, vertexCountPerMesh of them, and every index is rebased to match.
+template <typename Index>
+void DropCoarseGeosphereLevels(BasicPackedMesh<Index> *mesh, unsigned int subdivLevelCount,
+                               unsigned int *subdivIndexOffsets, unsigned int *vertexCountPerMesh);
 
 struct SkyboxVertex
 {
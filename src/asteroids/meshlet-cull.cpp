@@ -0,0 +1,55 @@
+#include "meshlet-cull.h"
+#include <cmath>
+#include "asteroid-field.h"
+#include "mesh.h"
+
+MeshletCuller::MeshletCuller(mathfu::float4x4 const& viewproj, mathfu::float3 const& camera)
+    : _camera(camera)
+{
+    frustum_side_planes(viewproj, _planes);
+}
+
+size_t MeshletCuller::cull(mathfu::float4x4 const& world, float const scale,
+                           Meshlet const* const meshlets, MeshletBounds const* const bounds,
+                           size_t const meshlet_count, IndexRange* const ranges) const
+{
+    float const inv_scale = 1.0f / scale;
+    size_t count = 0;
+    for (size_t ii = 0; ii < meshlet_count; ++ii) {
+        auto const& b = bounds[ii];
+        auto const center =
+            (world * mathfu::float4(b.center[0], b.center[1], b.center[2], 1.0f)).xyz();
+        float const radius = b.radius * scale;
+
+        bool visible = true;
+        for (auto const& plane : _planes) {
+            float const distance = plane[0] * center.x + plane[1] * center.y +
+                                   plane[2] * center.z + plane[3];
+            if (distance < -radius) {
+                visible = false;
+                break;
+            }
+        }
+        if (visible && b.coneCutoff < 1.0f) {
+            auto const axis =
+                (world * mathfu::float4(b.coneAxis[0], b.coneAxis[1], b.coneAxis[2], 0.0f))
+                    .xyz() *
+                inv_scale;
+            auto const view = center - _camera;
+            visible = mathfu::float3::DotProduct(view, axis) <
+                      b.coneCutoff * view.Length() + radius;
+        }
+        if (!visible) {
+            continue;
+        }
+
+        auto const& meshlet = meshlets[ii];
+        if (count > 0 &&
+            ranges[count - 1].first_index + ranges[count - 1].index_count == meshlet.indexOffset) {
+            ranges[count - 1].index_count += meshlet.indexCount;
+        } else {
+            ranges[count++] = {meshlet.indexOffset, meshlet.indexCount};
+        }
+    }
+    return count;
+}
@@ -0,0 +1,49 @@
+#pragma once
+// Per-meshlet culling of nearby asteroids on the CPU. Each meshlet (see
+// mesh.h) is dropped when its bounding sphere is outside the view frustum or
+// when its normal cone shows every triangle faces away from the camera; the
+// surviving meshlets are merged into as few index ranges as possible, so a
+// mesh drawn at full detail costs one draw per visible run of meshlets.
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4201)  // nameless struct/union
+#endif
+#include <mathfu/hlsl_mappings.h>
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+struct Meshlet;
+struct MeshletBounds;
+
+/// Indices [first_index, first_index + index_count) of a mesh's index list
+struct IndexRange
+{
+    uint32_t first_index;
+    uint32_t index_count;
+};
+
+class MeshletCuller
+{
+   public:
+    /// @param viewproj View-projection of the frustum to cull against
+    /// @param camera World space position of the camera, for the cone test
+    MeshletCuller(mathfu::float4x4 const& viewproj, mathfu::float3 const& camera);
+
+    /// @brief Writes the index ranges of the visible meshlets of one mesh
+    ///     instance to `ranges`, merging adjacent ones
+    /// @param world `translation * rotation * scale` of the instance, in the
+    ///     full precision mesh units `bounds` are in
+    /// @param scale The uniform scale in `world`
+    /// @param ranges Room for at least `meshlet_count` ranges
+    /// @return The number of ranges
+    size_t cull(mathfu::float4x4 const& world, float scale, Meshlet const* meshlets,
+                MeshletBounds const* bounds, size_t meshlet_count, IndexRange* ranges) const;
+
+   private:
+    float _planes[4][4];
+    mathfu::float3 _camera;
+};
@@ -0,0 +1,57 @@
+#include "noise-kernel.h"
+#include "simplexnoise1234.h"
+
+namespace {
+
+SimplexNoiseTables build_tables()
+{
+    SimplexNoiseTables tables = {};
+    unsigned char const* const perm = SimplexNoise1234::permutation();
+    for (size_t ii = 0; ii < SimplexNoiseTables::kSize; ++ii) {
+        tables.perm[ii] = perm[ii];
+
+        // Same selection as SimplexNoise1234::grad(hash, x, y, z, t): three of
+        // the four axes, each with a sign taken from the low bits
+        int const h = perm[ii] & 31;
+        int const u = h < 24 ? 0 : 1;
+        int const v = h < 16 ? 1 : 2;
+        int const w = h < 8 ? 2 : 3;
+        tables.gradient[u][ii] = (h & 1) ? -1.0f : 1.0f;
+        tables.gradient[v][ii] = (h & 2) ? -1.0f : 1.0f;
+        tables.gradient[w][ii] = (h & 4) ? -1.0f : 1.0f;
+    }
+    return tables;
+}
+
+}  // anonymous namespace
+
+SimplexNoiseTables const& simplex_noise_tables()
+{
+    static SimplexNoiseTables const s_tables = build_tables();
+    return s_tables;
+}
+
+void simplex_noise_scalar(SimplexNoiseData const& data, size_t const begin, size_t const end)
+{
+    simplex_noise<simd::Scalar>(data, begin, end);
+}
+
+void simplex_noise(SimplexNoiseData const& data, simd::InstructionSet const isa,
+                   size_t const begin, size_t const end)
+{
+    switch (isa) {
+        case simd::InstructionSet::kAVX512:
+            simplex_noise_avx512(data, begin, end);
+            break;
+        case simd::InstructionSet::kAVX2:
+            simplex_noise_avx2(data, begin, end);
+            break;
+        case simd::InstructionSet::kSSE2:
+            simplex_noise_sse2(data, begin, end);
+            break;
+        case simd::InstructionSet::kScalar:
+        default:
+            simplex_noise_scalar(data, begin, end);
+            break;
+    }
+}
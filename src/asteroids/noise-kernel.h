@@ -0,0 +1,189 @@
+#pragma once
+// Batched 4D simplex noise. Evaluates SimplexNoise1234::noise for `F::kWidth`
+// points at a time; like the asteroid kernels it is a template over one of the
+// `simd` lane types, instantiated once per instruction set, and lives in the
+// same per-target namespace.
+#include <cstddef>
+#include "simd.h"
+
+/// Lookup tables for the batched noise, built from SimplexNoise1234's
+/// permutation. Stored as floats so they can be gathered with the same index
+/// registers the kernel computes in.
+struct SimplexNoiseTables
+{
+    static constexpr size_t kSize = 512;
+
+    float perm[kSize];
+    /// Gradient of `SimplexNoise1234::grad(perm[i], ...)` as a 4D vector with
+    /// components in {-1, 0, 1}, so the last permutation lookup and the
+    /// gradient selection become a single gather per component.
+    float gradient[4][kSize];
+};
+
+/// @brief Returns the shared tables, building them on first use
+SimplexNoiseTables const& simplex_noise_tables();
+
+/// Input to the batched noise kernels, which accumulate
+/// `out[i] += weight * noise(scale * coords[0][i], ..., scale * coords[3][i])`
+/// and, when `gradient` is set, the derivative of that term with respect to
+/// each coordinate into `gradient[axis][i]`.
+struct SimplexNoiseData
+{
+    SimplexNoiseTables const* tables;
+    float const* coords[4];  ///< x, y, z and w
+    float scale;
+    float weight;
+    float* out;
+    float* gradient[4];  ///< All null, or all four derivative outputs
+};
+
+void simplex_noise_scalar(SimplexNoiseData const& data, size_t begin, size_t end);
+void simplex_noise_sse2(SimplexNoiseData const& data, size_t begin, size_t end);
+void simplex_noise_avx2(SimplexNoiseData const& data, size_t begin, size_t end);
+void simplex_noise_avx512(SimplexNoiseData const& data, size_t begin, size_t end);
+
+/// @brief Runs the kernel for the given instruction set over [begin, end)
+void simplex_noise(SimplexNoiseData const& data, simd::InstructionSet isa, size_t begin,
+                   size_t end);
+
+inline namespace AK_SIMD_TARGET {
+
+/// @brief 4D simplex noise in [-1, 1] for every lane, and optionally its
+///     partial derivatives
+/// @details Follows SimplexNoise1234::noise(x, y, z, w) operation for operation,
+///     so results match it to within rounding. Integer cell coordinates and
+///     permutation indices stay below 2^24 and are carried exactly in float
+///     lanes; the simplex traversal table is replaced by ranking the
+///     coordinates, which selects the same corners.
+/// @param out_gradient When not null, receives d noise / d (x, y, z, w)
+template<typename F>
+F simplex_noise4(SimplexNoiseTables const& tables, F const x, F const y, F const z, F const w,
+                 F* const out_gradient = nullptr)
+{
+    using simd::splat;
+    F const zero = splat<F>(0.0f);
+    F const one = splat<F>(1.0f);
+    F const f4 = splat<F>(0.309016994f);  // (sqrt(5) - 1) / 4
+    F const g4 = splat<F>(0.138196601f);  // (5 - sqrt(5)) / 20
+
+    // Skew to find the simplex cell, then unskew the cell origin
+    F const s = (x + y + z + w) * f4;
+    F const i = floor(x + s);
+    F const j = floor(y + s);
+    F const k = floor(z + s);
+    F const l = floor(w + s);
+    F const t = (i + j + k + l) * g4;
+    F const x0 = x - (i - t);
+    F const y0 = y - (j - t);
+    F const z0 = z - (k - t);
+    F const w0 = w - (l - t);
+
+    // Rank of each coordinate among the four (3 = largest). The n-th corner
+    // steps along every axis ranked at least 4 - n.
+    F const xy = greater(x0, y0);
+    F const xz = greater(x0, z0);
+    F const yz = greater(y0, z0);
+    F const xw = greater(x0, w0);
+    F const yw = greater(y0, w0);
+    F const zw = greater(z0, w0);
+    F const rank[4] = {
+        xy + xz + xw,
+        (one - xy) + yz + yw,
+        (one - xz) + (one - yz) + zw,
+        (one - xw) + (one - yw) + (one - zw),
+    };
+
+    // Wrap the cell to the permutation table; i & 255 without integer lanes
+    auto const wrap = [](F const c) {
+        return c - splat<F>(256.0f) * floor(c * splat<F>(1.0f / 256.0f));
+    };
+    F const cell[4] = {wrap(i), wrap(j), wrap(k), wrap(l)};
+    F const origin[4] = {x0, y0, z0, w0};
+
+    // Sum the contributions from the five corners
+    F n = zero;
+    F dn[4] = {zero, zero, zero, zero};
+    for (int corner = 0; corner < 5; ++corner) {
+        F const threshold = splat<F>(3.5f - static_cast<float>(corner));
+        F const unskew = splat<F>(static_cast<float>(corner) * 0.138196601f);
+        F step[4];
+        F d[4];
+        for (int axis = 0; axis < 4; ++axis) {
+            step[axis] = corner == 0 ? zero : corner == 4 ? one : greater(rank[axis], threshold);
+            d[axis] = origin[axis] - step[axis] + unskew;
+        }
+
+        F const hash =
+            cell[0] + step[0] +
+            F::gather(tables.perm,
+                      cell[1] + step[1] +
+                          F::gather(tables.perm,
+                                    cell[2] + step[2] + F::gather(tables.perm, cell[3] + step[3])));
+        F g[4];
+        for (int axis = 0; axis < 4; ++axis) {
+            g[axis] = F::gather(tables.gradient[axis], hash);
+        }
+        F const gradient = g[0] * d[0] + g[1] * d[1] + g[2] * d[2] + g[3] * d[3];
+
+        F const falloff =
+            max(splat<F>(0.6f) - d[0] * d[0] - d[1] * d[1] - d[2] * d[2] - d[3] * d[3], zero);
+        F const falloff2 = falloff * falloff;
+        F const falloff4 = falloff2 * falloff2;
+        n = n + falloff4 * gradient;
+
+        if (out_gradient != nullptr) {
+            // d/dd of falloff^4 * (g . d), where falloff = 0.6 - |d|^2
+            F const radial = splat<F>(8.0f) * falloff2 * falloff * gradient;
+            for (int axis = 0; axis < 4; ++axis) {
+                dn[axis] = dn[axis] + (falloff4 * g[axis] - radial * d[axis]);
+            }
+        }
+    }
+    if (out_gradient != nullptr) {
+        for (int axis = 0; axis < 4; ++axis) {
+            out_gradient[axis] = splat<F>(27.0f) * dn[axis];
+        }
+    }
+    return splat<F>(27.0f) * n;
+}
+
+template<typename F>
+void simplex_noise_block(SimplexNoiseData const& data, size_t const index)
+{
+    using simd::splat;
+    F const scale = splat<F>(data.scale);
+    F const weight = splat<F>(data.weight);
+    F const x = F::load(data.coords[0] + index) * scale;
+    F const y = F::load(data.coords[1] + index) * scale;
+    F const z = F::load(data.coords[2] + index) * scale;
+    F const w = F::load(data.coords[3] + index) * scale;
+    if (data.gradient[0] == nullptr) {
+        F const n = simplex_noise4(*data.tables, x, y, z, w);
+        (F::load(data.out + index) + weight * n).store(data.out + index);
+        return;
+    }
+
+    F dn[4];
+    F const n = simplex_noise4(*data.tables, x, y, z, w, dn);
+    (F::load(data.out + index) + weight * n).store(data.out + index);
+    // chain rule through the scaled coordinates
+    F const weight_scale = weight * scale;
+    for (int axis = 0; axis < 4; ++axis) {
+        float* const gradient = data.gradient[axis] + index;
+        (F::load(gradient) + weight_scale * dn[axis]).store(gradient);
+    }
+}
+
+template<typename F>
+void simplex_noise(SimplexNoiseData const& data, size_t const begin, size_t const end)
+{
+    size_t index = begin;
+    for (; index + F::kWidth <= end; index += F::kWidth) {
+        simplex_noise_block<F>(data, index);
+    }
+    for (; index < end; ++index) {
+        simplex_noise_block<simd::Scalar>(data, index);
+    }
+}
+
+}  // namespace AK_SIMD_TARGET
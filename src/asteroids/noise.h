@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include "noise-kernel.h"
 #include "simplexnoise1234.h"
 
 // Very simple multi-octave simplex noise helper
@@ -65,4 +68,74 @@ class NoiseOctaves
         }
         return r * mWeightNorm + 0.5f;
     }
+
+    // Returns [0, 1], and writes its derivatives with respect to x, y, z and w
+    // to gradient[0..3]
+    float operator()(float x, float y, float z, float w, float *gradient) const
+    {
+        float r = 0.0f;
+        float scale = 1.0f;
+        gradient[0] = gradient[1] = gradient[2] = gradient[3] = 0.0f;
+        for (size_t i = 0; i < N; ++i) {
+            float dnoise[4];
+            r += mWeights[i] * SimplexNoise1234::noise(x, y, z, w, dnoise);
+            for (size_t a = 0; a < 4; ++a) {
+                gradient[a] += mWeights[i] * scale * dnoise[a];
+            }
+            x *= 2.0f;
+            y *= 2.0f;
+            z *= 2.0f;
+            w *= 2.0f;
+            scale *= 2.0f;
+        }
+        for (size_t a = 0; a < 4; ++a) {
+            gradient[a] *= mWeightNorm;
+        }
+        return r * mWeightNorm + 0.5f;
+    }
+
+    // Batched version of the 4D operator for count points given as separate
+    // coordinate arrays, evaluated several points at a time with the given
+    // instruction set. Writes [0, 1] to out.
+    void operator()(const float *x, const float *y, const float *z, const float *w, size_t count,
+                    float *out, simd::InstructionSet isa) const
+    {
+        float *noGradient[4] = {};
+        (*this)(x, y, z, w, count, out, noGradient, isa);
+    }
+
+    // As above, and when gradient[0..3] are not null also writes the
+    // derivatives with respect to x, y, z and w to them
+    void operator()(const float *x, const float *y, const float *z, const float *w, size_t count,
+                    float *out, float *const *gradient, simd::InstructionSet isa) const
+    {
+        SimplexNoiseData data = {};
+        data.tables = &simplex_noise_tables();
+        data.coords[0] = x;
+        data.coords[1] = y;
+        data.coords[2] = z;
+        data.coords[3] = w;
+        data.scale = 1.0f;
+        data.out = out;
+        std::fill(out, out + count, 0.0f);
+        if (gradient[0]) {
+            for (size_t a = 0; a < 4; ++a) {
+                data.gradient[a] = gradient[a];
+                std::fill(gradient[a], gradient[a] + count, 0.0f);
+            }
+        }
+        for (size_t i = 0; i < N; ++i) {
+            data.weight = mWeights[i];
+            simplex_noise(data, isa, 0, count);
+            data.scale *= 2.0f;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = out[i] * mWeightNorm + 0.5f;
+        }
+        for (size_t a = 0; a < 4 && data.gradient[a]; ++a) {
+            for (size_t i = 0; i < count; ++i) {
+                data.gradient[a][i] *= mWeightNorm;
+            }
+        }
+    }
 };
@@ -0,0 +1,171 @@
+#include "page-allocation.h"
+#include <cassert>
+#include <utility>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#if defined(__APPLE__)
+#include <mach/vm_statistics.h>
+#endif  // __APPLE__
+#endif  // _WIN32
+
+namespace {
+
+size_t round_up(size_t const size, size_t const alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+#if defined(_WIN32)
+/// @brief Large pages require the "Lock pages in memory" privilege, which is
+///     granted by policy but must be enabled on the process token before use
+bool enable_lock_memory_privilege()
+{
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+        return false;
+    }
+    TOKEN_PRIVILEGES privileges = {};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool const enabled =
+        LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+        GetLastError() == ERROR_SUCCESS;
+    CloseHandle(token);
+    return enabled;
+}
+
+void* allocate_large_pages(size_t* const size)
+{
+    static bool const s_privilege_enabled = enable_lock_memory_privilege();
+    size_t const page_size = GetLargePageMinimum();
+    if (!s_privilege_enabled || page_size == 0) {
+        return nullptr;
+    }
+    size_t const large_size = round_up(*size, page_size);
+    void* const data = VirtualAlloc(nullptr, large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                    PAGE_READWRITE);
+    if (data != nullptr) {
+        *size = large_size;
+    }
+    return data;
+}
+
+void* allocate_pages(size_t const size)
+{
+    return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void free_pages(void* const data, size_t /*size*/)
+{
+    VirtualFree(data, 0, MEM_RELEASE);
+}
+#else
+constexpr size_t kLargePageSize = 2 * 1024 * 1024;
+
+void* map_pages(size_t const size, int const flags, int const fd)
+{
+    void* const data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | flags,
+                            fd, 0);
+    return data == MAP_FAILED ? nullptr : data;
+}
+
+void* allocate_large_pages(size_t* const size)
+{
+    size_t const large_size = round_up(*size, kLargePageSize);
+#if defined(MAP_HUGETLB)
+    // explicit huge pages only exist if the administrator reserved them
+    void* const data = map_pages(large_size, MAP_HUGETLB, -1);
+#elif defined(VM_FLAGS_SUPERPAGE_SIZE_2MB)
+    void* const data = map_pages(large_size, 0, VM_FLAGS_SUPERPAGE_SIZE_2MB);
+#else
+    void* const data = nullptr;
+#endif
+    if (data != nullptr) {
+        *size = large_size;
+    }
+    return data;
+}
+
+void* allocate_pages(size_t const size)
+{
+    return map_pages(size, 0, -1);
+}
+
+void free_pages(void* const data, size_t const size)
+{
+    munmap(data, size);
+}
+#endif  // _WIN32
+
+}  // anonymous namespace
+
+PageAllocation::PageAllocation(size_t const size, bool const large_pages)
+    : _size(size)
+{
+    if (size == 0) {
+        return;
+    }
+    if (large_pages) {
+        _data = allocate_large_pages(&_size);
+        _large_pages = _data != nullptr;
+    }
+    if (_data == nullptr) {
+#if defined(MADV_HUGEPAGE)
+        // fall back to transparent huge pages, which the kernel can only use
+        // for whole, aligned 2MiB ranges
+        if (large_pages) {
+            _size = round_up(size, kLargePageSize);
+        }
+#endif
+        _data = allocate_pages(_size);
+#if defined(MADV_HUGEPAGE)
+        if (large_pages && _data != nullptr) {
+            madvise(_data, _size, MADV_HUGEPAGE);
+        }
+#endif
+    }
+    assert(_data != nullptr && "Could not allocate pages");
+    if (_data == nullptr) {
+        _size = 0;
+    }
+}
+
+PageAllocation::~PageAllocation()
+{
+    release();
+}
+
+PageAllocation::PageAllocation(PageAllocation&& other)
+    : _data(other._data)
+    , _size(other._size)
+    , _large_pages(other._large_pages)
+{
+    other._data = nullptr;
+    other._size = 0;
+    other._large_pages = false;
+}
+
+PageAllocation& PageAllocation::operator=(PageAllocation&& other)
+{
+    if (this != &other) {
+        release();
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_large_pages, other._large_pages);
+    }
+    return *this;
+}
+
+void PageAllocation::release()
+{
+    if (_data != nullptr) {
+        free_pages(_data, _size);
+    }
+    _data = nullptr;
+    _size = 0;
+    _large_pages = false;
+}
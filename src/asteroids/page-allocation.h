@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+
+/// A block of memory allocated directly from the OS, aligned to at least a
+/// page. Large data sets that are streamed every frame (the asteroid field)
+/// live in one of these rather than in many small heap allocations, and can
+/// optionally be backed by large pages to cut TLB misses.
+class PageAllocation
+{
+   public:
+    PageAllocation() = default;
+    /// @brief Allocates at least `size` zeroed bytes. When `large_pages` is
+    ///     set, large (2MiB) pages are used if the OS grants them, otherwise
+    ///     the allocation silently falls back to regular pages.
+    PageAllocation(size_t size, bool large_pages);
+    ~PageAllocation();
+
+    PageAllocation(PageAllocation&& other);
+    PageAllocation& operator=(PageAllocation&& other);
+    PageAllocation(PageAllocation const&) = delete;
+    PageAllocation& operator=(PageAllocation const&) = delete;
+
+    void* data() const { return _data; }
+    /// @brief Size of the allocation, which may be rounded up from the request
+    size_t size() const { return _size; }
+    /// @brief Whether the allocation ended up backed by large pages
+    bool large_pages() const { return _large_pages; }
+
+   private:
+    void release();
+
+    void* _data = nullptr;
+    size_t _size = 0;
+    bool _large_pages = false;
+};
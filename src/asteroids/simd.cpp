@@ -0,0 +1,133 @@
+#include "simd.h"
+#include <cstdint>
+
+#if defined(AK_SIMD_SSE2)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif  // AK_SIMD_SSE2
+
+namespace {
+
+#if defined(AK_SIMD_SSE2)
+struct CpuidRegisters
+{
+    uint32_t eax;
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+};
+
+CpuidRegisters cpuid(uint32_t const leaf, uint32_t const subleaf)
+{
+    CpuidRegisters regs = {};
+#if defined(_MSC_VER)
+    int values[4] = {};
+    __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+    regs.eax = static_cast<uint32_t>(values[0]);
+    regs.ebx = static_cast<uint32_t>(values[1]);
+    regs.ecx = static_cast<uint32_t>(values[2]);
+    regs.edx = static_cast<uint32_t>(values[3]);
+#else
+    __cpuid_count(leaf, subleaf, regs.eax, regs.ebx, regs.ecx, regs.edx);
+#endif
+    return regs;
+}
+
+/// Returns which register states the OS saves on context switch (XCR0)
+uint64_t os_saved_state()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax = 0;
+    uint32_t edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+simd::InstructionSet detect_instruction_set()
+{
+    constexpr uint32_t kSSE2Bit = 1u << 26;     // leaf 1 edx
+    constexpr uint32_t kFMABit = 1u << 12;      // leaf 1 ecx
+    constexpr uint32_t kOSXSaveBit = 1u << 27;  // leaf 1 ecx
+    constexpr uint32_t kAVXBit = 1u << 28;      // leaf 1 ecx
+    constexpr uint32_t kAVX2Bit = 1u << 5;      // leaf 7 ebx
+    constexpr uint32_t kAVX512FBit = 1u << 16;  // leaf 7 ebx
+    constexpr uint64_t kYmmState = 0x6;         // xmm | ymm
+    constexpr uint64_t kZmmState = 0xe6;        // xmm | ymm | opmask | zmm
+
+    auto const max_leaf = cpuid(0, 0).eax;
+    auto const leaf1 = cpuid(1, 0);
+    if ((leaf1.edx & kSSE2Bit) == 0) {
+        return simd::InstructionSet::kScalar;
+    }
+    bool const has_xsave = (leaf1.ecx & kOSXSaveBit) != 0 && (leaf1.ecx & kAVXBit) != 0;
+    if (max_leaf < 7 || !has_xsave) {
+        return simd::InstructionSet::kSSE2;
+    }
+
+    // The AVX2 kernels are compiled with FMA as well. Each level also requires
+    // the ones below it, so callers can step down to any narrower one.
+    auto const leaf7 = cpuid(7, 0);
+    auto const os_state = os_saved_state();
+    bool const has_avx2 = (leaf7.ebx & kAVX2Bit) != 0 && (leaf1.ecx & kFMABit) != 0 &&
+                          (os_state & kYmmState) == kYmmState;
+    if (!has_avx2) {
+        return simd::InstructionSet::kSSE2;
+    }
+    if ((leaf7.ebx & kAVX512FBit) != 0 && (os_state & kZmmState) == kZmmState) {
+        return simd::InstructionSet::kAVX512;
+    }
+    return simd::InstructionSet::kAVX2;
+}
+#else
+simd::InstructionSet detect_instruction_set()
+{
+    return simd::InstructionSet::kScalar;
+}
+#endif  // AK_SIMD_SSE2
+
+/// @brief Steps down from `isa` to the widest instruction set whose kernels
+///     were compiled with matching code generation
+simd::InstructionSet widest_compiled(simd::InstructionSet const isa)
+{
+    bool const compiled[] = {true, simd::kCompiledSSE2, simd::kCompiledAVX2,
+                             simd::kCompiledAVX512};
+    auto index = static_cast<size_t>(isa);
+    while (!compiled[index]) {
+        --index;
+    }
+    return static_cast<simd::InstructionSet>(index);
+}
+
+}  // anonymous namespace
+
+namespace simd {
+
+InstructionSet best_instruction_set()
+{
+    static InstructionSet const best = widest_compiled(detect_instruction_set());
+    return best;
+}
+
+char const* instruction_set_name(InstructionSet const isa)
+{
+    switch (isa) {
+        case InstructionSet::kSSE2:
+            return "SSE2";
+        case InstructionSet::kAVX2:
+            return "AVX2";
+        case InstructionSet::kAVX512:
+            return "AVX-512";
+        case InstructionSet::kScalar:
+        default:
+            break;
+    }
+    return "Scalar";
+}
+
+}  // namespace simd
@@ -0,0 +1,254 @@
+#pragma once
+// Thin wrappers around the x86 vector registers. Kernels are written once as
+// templates over one of these types and instantiated per instruction set; every
+// wrapper exposes the same interface (kWidth, load/store, broadcast, gather,
+// arithmetic, min/max, greater, round and floor). `Scalar` implements the
+// interface with plain floats and is used both as the portable fallback and for
+// loop remainders. There is no mask type: comparisons return 1.0f or 0.0f per
+// lane so kernels can select arithmetically.
+//
+// Every file that includes this header compiles the wrappers, and any kernel
+// templates built on them, with its own code generation flags. They therefore
+// live in an inline namespace named after those flags, `AK_SIMD_TARGET`. If
+// they did not, the linker would keep one copy of each inline function and
+// could pick the AVX2 build of `Scalar` for code that runs on CPUs without AVX.
+#include <math.h>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AK_SIMD_SSE2 1
+#endif
+#if defined(__AVX2__) || (defined(_MSC_VER) && defined(AK_SIMD_SSE2))
+#define AK_SIMD_AVX2 1
+#endif
+#if defined(__AVX512F__) || (defined(_MSC_VER) && _MSC_VER >= 1911 && defined(AK_SIMD_SSE2))
+#define AK_SIMD_AVX512 1
+#endif
+
+#if defined(__AVX512F__)
+#define AK_SIMD_TARGET avx512
+#elif defined(__AVX2__)
+#define AK_SIMD_TARGET avx2
+#elif defined(__AVX__)
+#define AK_SIMD_TARGET avx
+#else
+#define AK_SIMD_TARGET baseline
+#endif
+
+#if defined(AK_SIMD_SSE2)
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+enum class InstructionSet {
+    kScalar = 0,
+    kSSE2,
+    kAVX2,
+    kAVX512,
+};
+
+/// @brief Returns the widest instruction set supported by both the CPU and the
+///     OS whose kernels were compiled with matching code generation
+InstructionSet best_instruction_set();
+
+/// @brief Returns a printable name for an instruction set
+char const* instruction_set_name(InstructionSet isa);
+
+/// Whether the kernels for each instruction set were compiled with its code
+/// generation. Defined by the matching asteroid-kernel-*.cpp.
+extern bool const kCompiledSSE2;
+extern bool const kCompiledAVX2;
+extern bool const kCompiledAVX512;
+
+inline namespace AK_SIMD_TARGET {
+
+//
+// Scalar
+//
+struct Scalar
+{
+    static constexpr size_t kWidth = 1;
+    float v;
+
+    static Scalar load(float const* p) { return {*p}; }
+    static Scalar broadcast(float f) { return {f}; }
+    /// @brief Looks up `table[index]`, where index holds a whole number
+    static Scalar gather(float const* table, Scalar index)
+    {
+        return {table[static_cast<int32_t>(index.v)]};
+    }
+    void store(float* p) const { *p = v; }
+};
+inline Scalar operator+(Scalar a, Scalar b) { return {a.v + b.v}; }
+inline Scalar operator-(Scalar a, Scalar b) { return {a.v - b.v}; }
+inline Scalar operator*(Scalar a, Scalar b) { return {a.v * b.v}; }
+inline Scalar operator-(Scalar a) { return {-a.v}; }
+inline Scalar min(Scalar a, Scalar b) { return {a.v < b.v ? a.v : b.v}; }
+inline Scalar max(Scalar a, Scalar b) { return {a.v > b.v ? a.v : b.v}; }
+/// @brief 1.0f where a > b, otherwise 0.0f
+inline Scalar greater(Scalar a, Scalar b) { return {a.v > b.v ? 1.0f : 0.0f}; }
+inline Scalar round(Scalar a) { return {nearbyintf(a.v)}; }
+inline Scalar floor(Scalar a) { return {floorf(a.v)}; }
+
+//
+// SSE2
+//
+#if defined(AK_SIMD_SSE2)
+struct SSE2
+{
+    static constexpr size_t kWidth = 4;
+    __m128 v;
+
+    static SSE2 load(float const* p) { return {_mm_loadu_ps(p)}; }
+    static SSE2 broadcast(float f) { return {_mm_set1_ps(f)}; }
+    static SSE2 gather(float const* table, SSE2 index)
+    {
+        // SSE2 has no gather; look the lanes up one at a time
+        alignas(16) int32_t lanes[kWidth];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_cvttps_epi32(index.v));
+        return {_mm_setr_ps(table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]])};
+    }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+};
+inline SSE2 operator+(SSE2 a, SSE2 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline SSE2 operator-(SSE2 a, SSE2 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline SSE2 operator*(SSE2 a, SSE2 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline SSE2 operator-(SSE2 a) { return {_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))}; }
+inline SSE2 min(SSE2 a, SSE2 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline SSE2 max(SSE2 a, SSE2 b) { return {_mm_max_ps(a.v, b.v)}; }
+inline SSE2 greater(SSE2 a, SSE2 b)
+{
+    return {_mm_and_ps(_mm_cmpgt_ps(a.v, b.v), _mm_set1_ps(1.0f))};
+}
+inline SSE2 round(SSE2 a) { return {_mm_cvtepi32_ps(_mm_cvtps_epi32(a.v))}; }
+inline SSE2 floor(SSE2 a)
+{
+    // SSE2 has no floor; round and step down where rounding went up
+    __m128 const r = round(a).v;
+    return {_mm_sub_ps(r, _mm_and_ps(_mm_cmpgt_ps(r, a.v), _mm_set1_ps(1.0f)))};
+}
+#endif  // AK_SIMD_SSE2
+
+//
+// AVX2
+//
+#if defined(AK_SIMD_AVX2)
+struct AVX2
+{
+    static constexpr size_t kWidth = 8;
+    __m256 v;
+
+    static AVX2 load(float const* p) { return {_mm256_loadu_ps(p)}; }
+    static AVX2 broadcast(float f) { return {_mm256_set1_ps(f)}; }
+    static AVX2 gather(float const* table, AVX2 index)
+    {
+        return {_mm256_i32gather_ps(table, _mm256_cvttps_epi32(index.v), sizeof(float))};
+    }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+};
+inline AVX2 operator+(AVX2 a, AVX2 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline AVX2 operator-(AVX2 a, AVX2 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline AVX2 operator*(AVX2 a, AVX2 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline AVX2 operator-(AVX2 a) { return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))}; }
+inline AVX2 min(AVX2 a, AVX2 b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline AVX2 max(AVX2 a, AVX2 b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline AVX2 greater(AVX2 a, AVX2 b)
+{
+    return {_mm256_and_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ), _mm256_set1_ps(1.0f))};
+}
+inline AVX2 round(AVX2 a)
+{
+    return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+}
+inline AVX2 floor(AVX2 a) { return {_mm256_floor_ps(a.v)}; }
+#endif  // AK_SIMD_AVX2
+
+//
+// AVX-512
+//
+#if defined(AK_SIMD_AVX512)
+struct AVX512
+{
+    static constexpr size_t kWidth = 16;
+    __m512 v;
+
+    static AVX512 load(float const* p) { return {_mm512_loadu_ps(p)}; }
+    static AVX512 broadcast(float f) { return {_mm512_set1_ps(f)}; }
+    static AVX512 gather(float const* table, AVX512 index)
+    {
+        return {_mm512_i32gather_ps(_mm512_cvttps_epi32(index.v), table, sizeof(float))};
+    }
+    void store(float* p) const { _mm512_storeu_ps(p, v); }
+};
+inline AVX512 operator+(AVX512 a, AVX512 b) { return {_mm512_add_ps(a.v, b.v)}; }
+inline AVX512 operator-(AVX512 a, AVX512 b) { return {_mm512_sub_ps(a.v, b.v)}; }
+inline AVX512 operator*(AVX512 a, AVX512 b) { return {_mm512_mul_ps(a.v, b.v)}; }
+inline AVX512 operator-(AVX512 a) { return {_mm512_sub_ps(_mm512_setzero_ps(), a.v)}; }
+inline AVX512 min(AVX512 a, AVX512 b) { return {_mm512_min_ps(a.v, b.v)}; }
+inline AVX512 max(AVX512 a, AVX512 b) { return {_mm512_max_ps(a.v, b.v)}; }
+inline AVX512 greater(AVX512 a, AVX512 b)
+{
+    return {_mm512_maskz_mov_ps(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ), _mm512_set1_ps(1.0f))};
+}
+inline AVX512 round(AVX512 a)
+{
+    return {_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+}
+inline AVX512 floor(AVX512 a)
+{
+    return {_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)};
+}
+#endif  // AK_SIMD_AVX512
+
+//
+// Generic math
+//
+template<typename F>
+F splat(float f)
+{
+    return F::broadcast(f);
+}
+
+/// @brief Computes sin(x) and cos(x) for every lane
+/// @details Cody-Waite reduction to [-pi/4, pi/4] followed by the Cephes
+///     minimax polynomials, accurate to a couple of ulps for |x| < 8192.
+///     Quadrant handling is done arithmetically so no mask type is needed.
+template<typename F>
+void sincos(F const x, F* const out_sin, F* const out_cos)
+{
+    F const quadrant = round(x * splat<F>(0.636619772367581343f));  // 2/pi
+    F r = x - quadrant * splat<F>(1.5703125f);
+    r = r - quadrant * splat<F>(4.837512969970703125e-4f);
+    r = r - quadrant * splat<F>(7.54978995489188216e-8f);
+
+    F const r2 = r * r;
+    F const sin_r =
+        r + r * r2 *
+                (splat<F>(-1.6666654611e-1f) +
+                 r2 * (splat<F>(8.3321608736e-3f) + r2 * splat<F>(-1.9515295891e-4f)));
+    F const cos_r =
+        splat<F>(1.0f) - splat<F>(0.5f) * r2 +
+        r2 * r2 *
+            (splat<F>(4.166664568298827e-2f) +
+             r2 * (splat<F>(-1.388731625493765e-3f) + r2 * splat<F>(2.443315711809948e-5f)));
+
+    // quadrant (mod 4) selects the polynomial and the sign of each result
+    F const one = splat<F>(1.0f);
+    F const two = splat<F>(2.0f);
+    F const four = splat<F>(4.0f);
+    F const q = quadrant - four * floor(quadrant * splat<F>(0.25f));
+    F const odd = q - two * floor(q * splat<F>(0.5f));
+    F const even = one - odd;
+    F const q_next = q + one;
+    F const q_cos = q_next - four * floor(q_next * splat<F>(0.25f));
+    F const sin_sign = one - two * floor(q * splat<F>(0.5f));
+    F const cos_sign = one - two * floor(q_cos * splat<F>(0.5f));
+
+    *out_sin = sin_sign * (even * sin_r + odd * cos_r);
+    *out_cos = cos_sign * (even * cos_r + odd * sin_r);
+}
+
+}  // namespace AK_SIMD_TARGET
+}  // namespace simd
@@ -469,3 +469,72 @@ float SimplexNoise1234::noise(float x, float y, float z, float w) {
     return 27.0f * (n0 + n1 + n2 + n3 + n4); // TODO: The scale factor is preliminary!
   }
 //---------------------------------------------------------------------
+
+/*
+ * Contribution of one 4D simplex corner with its derivative. The gradient
+ * vector is recovered from grad() by dotting it with the unit axes, and the
+ * derivative of t^4 * (g . d) with respect to d is added to dnoise[0..3].
+ */
+float SimplexNoise1234::dcorner( int hash, float x, float y, float z, float w,
+                                 float *dnoise ) {
+    float t = 0.6f - x*x - y*y - z*z - w*w;
+    if(t < 0.0f) return 0.0f;
+    float g[4] = { grad(hash, 1.0f, 0.0f, 0.0f, 0.0f), grad(hash, 0.0f, 1.0f, 0.0f, 0.0f),
+                   grad(hash, 0.0f, 0.0f, 1.0f, 0.0f), grad(hash, 0.0f, 0.0f, 0.0f, 1.0f) };
+    float d[4] = { x, y, z, w };
+    float gdotd = grad(hash, x, y, z, w);
+    float t2 = t * t;
+    float t4 = t2 * t2;
+    for(int a = 0; a < 4; ++a)
+      dnoise[a] += t4 * g[a] - 8.0f * t2 * t * gdotd * d[a];
+    return t4 * gdotd;
+  }
+
+// 4D simplex noise with analytic derivatives. Same value as noise(x,y,z,w),
+// and writes the partial derivatives with respect to x, y, z and w to dnoise.
+float SimplexNoise1234::noise(float x, float y, float z, float w, float *dnoise) {
+
+    // Skew to find the simplex cell, unskew its origin; see the 4D noise above
+    float s = (x + y + z + w) * F4;
+    float xs = x + s;
+    float ys = y + s;
+    float zs = z + s;
+    float ws = w + s;
+    int i = FASTFLOOR(xs);
+    int j = FASTFLOOR(ys);
+    int k = FASTFLOOR(zs);
+    int l = FASTFLOOR(ws);
+    float t = (i + j + k + l) * G4;
+    float x0 = x - (i - t);
+    float y0 = y - (j - t);
+    float z0 = z - (k - t);
+    float w0 = w - (l - t);
+
+    int c = ((x0 > y0) ? 32 : 0) + ((x0 > z0) ? 16 : 0) + ((y0 > z0) ? 8 : 0) +
+            ((x0 > w0) ? 4 : 0) + ((y0 > w0) ? 2 : 0) + ((z0 > w0) ? 1 : 0);
+
+    int ii = i & 0xff;
+    int jj = j & 0xff;
+    int kk = k & 0xff;
+    int ll = l & 0xff;
+
+    dnoise[0] = dnoise[1] = dnoise[2] = dnoise[3] = 0.0f;
+    float n = 0.0f;
+    for(int corner = 0; corner < 5; ++corner) {
+      // Corner n steps along every axis whose "simplex" entry is >= 4 - n
+      int rank = 4 - corner;
+      int i1 = simplex[c][0] >= rank ? 1 : 0;
+      int j1 = simplex[c][1] >= rank ? 1 : 0;
+      int k1 = simplex[c][2] >= rank ? 1 : 0;
+      int l1 = simplex[c][3] >= rank ? 1 : 0;
+      float offset = corner * G4;
+      n += dcorner(perm[ii+i1+perm[jj+j1+perm[kk+k1+perm[ll+l1]]]],
+                   x0 - i1 + offset, y0 - j1 + offset, z0 - k1 + offset, w0 - l1 + offset,
+                   dnoise);
+    }
+
+    for(int a = 0; a < 4; ++a)
+      dnoise[a] *= 27.0f;
+    return 27.0f * n;
+  }
+//---------------------------------------------------------------------
@@ -42,6 +42,10 @@ class SimplexNoise1234 {
     static float noise( float x, float y, float z );
     static float noise( float x, float y, float z, float w );
 
+/** 4D float Perlin noise that also writes its four partial derivatives to dnoise
+ */
+    static float noise( float x, float y, float z, float w, float *dnoise );
+
 /** 1D, 2D, 3D and 4D float Perlin noise, with a specified integer period
  */
     static float pnoise( float x, int px );
@@ -50,11 +54,16 @@ class SimplexNoise1234 {
     static float pnoise( float x, float y, float z, float w,
                               int px, int py, int pz, int pw );
 
+/** The permutation table, shared with the batched kernels in noise-kernel.h
+ */
+    static const unsigned char* permutation() { return perm; }
+
   private:
     static unsigned char perm[];
     static float grad( int hash, float x );
     static float grad( int hash, float x, float y );
     static float grad( int hash, float x, float y , float z );
     static float grad( int hash, float x, float y, float z, float t );
+    static float dcorner( int hash, float x, float y, float z, float w, float *dnoise );
 
 };
@@ -0,0 +1,84 @@
+#include "software-shaders.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4201)  // nameless struct/union
+#endif
+#include <mathfu/hlsl_mappings.h>
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+namespace {
+
+// The uniform blocks, as Application uploads them
+struct PerFrameUniforms
+{
+    mathfu::float4x4 projection;
+    mathfu::float4x4 view;
+    mathfu::float4x4 viewproj;
+};
+
+// Inverse of EncodeOctahedralNormal in mesh.cpp
+mathfu::float3 decode_octahedral(float const x, float const y)
+{
+    mathfu::float3 n(x, y, 1.0f - std::abs(x) - std::abs(y));
+    float const fold = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -fold : fold;
+    n.y += n.y >= 0.0f ? -fold : fold;
+    return n.Normalized();
+}
+
+// Rotates `v` by the unit quaternion `q`
+mathfu::float3 rotate(float const (&q)[4], mathfu::float3 const& v)
+{
+    mathfu::float3 const axis(q[0], q[1], q[2]);
+    auto const inner = mathfu::float3::CrossProduct(axis, v) + v * q[3];
+    return v + mathfu::float3::CrossProduct(axis, inner) * 2.0f;
+}
+
+void simple_vertex(void const* const* const constants, float const (*const attributes)[4],
+                   ak::SoftwareVertex* const vertex)
+{
+    auto const& frame = *static_cast<PerFrameUniforms const*>(constants[0]);
+    auto const& orientation = attributes[2];
+    auto const& position_scale = attributes[3];
+
+    mathfu::float3 const position(attributes[0][0], attributes[0][1], attributes[0][2]);
+    auto const world = rotate(orientation, position * position_scale[3]) +
+                       mathfu::float3(position_scale[0], position_scale[1], position_scale[2]);
+    auto const clip = frame.projection * (frame.view * mathfu::float4(world, 1.0f));
+    for (int ii = 0; ii < 4; ++ii) {
+        vertex->position[ii] = clip[ii];
+    }
+
+    auto const norm = decode_octahedral(attributes[1][0], attributes[1][1]);
+    auto const world_norm = rotate(orientation, norm);
+    for (int ii = 0; ii < 3; ++ii) {
+        vertex->varyings[ii] = world_norm[ii];
+    }
+}
+
+void simple_pixel(void const* /*constants*/, float const* const varyings, float* const color)
+{
+    float const ambient_factor = 0.1f;
+    mathfu::float3 const light_pos(0.5f, 0.25f, -1.0f);
+    mathfu::float3 const norm(varyings[0], varyings[1], varyings[2]);
+    float const n_dot_l = std::min(
+        std::max(mathfu::float3::DotProduct(norm.Normalized(), light_pos.Normalized()), 0.0f),
+        1.0f);
+
+    mathfu::float3 const brown(0.4f, 0.2f, 0.0f);
+    auto const lit = brown * ambient_factor + brown * (1.0f - ambient_factor) * n_dot_l;
+    color[0] = lit.x;
+    color[1] = lit.y;
+    color[2] = lit.z;
+    color[3] = 1.0f;
+}
+
+}  // namespace
+
+ak::SoftwareVertexShader const kSimpleVertexShader = {simple_vertex, 3};
+ak::SoftwarePixelShader const kSimplePixelShader = {simple_pixel};
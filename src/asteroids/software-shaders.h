@@ -0,0 +1,11 @@
+#pragma once
+// C++ ports of simple.vert and simple.frag for the software graphics device,
+// which takes the shader structs in place of bytecode; see software-shader.h.
+#include "graphics/software-shader.h"
+
+/// simple.vert: reads the per-frame constants from vertex slot 0 and the
+/// asteroid's transform from per-instance attributes 2 and 3, and passes the
+/// world space normal on in varyings 0 to 2
+extern ak::SoftwareVertexShader const kSimpleVertexShader;
+/// simple.frag: lights the asteroid brown from a fixed direction
+extern ak::SoftwarePixelShader const kSimplePixelShader;
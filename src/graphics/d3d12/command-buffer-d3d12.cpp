@@ -12,6 +12,19 @@ void CommandBufferD3D12::reset()
     _completion = 0;
 }
 
+bool CommandBufferD3D12::execute_render_pass(CommandBuffer* const* /*command_buffers*/,
+                                             size_t const /*count*/)
+{
+    // UNIMPLEMENTED
+    return false;
+}
+
+void* CommandBufferD3D12::get_upload_data(size_t const /*size*/, size_t const /*alignment*/)
+{
+    // UNIMPLEMENTED
+    return nullptr;
+}
+
 bool CommandBufferD3D12::begin_render_pass()
 {
     if (_graphics->_swap_chain == nullptr) {
@@ -77,7 +90,30 @@ void CommandBufferD3D12::set_index_buffer(Buffer* const /*buffer*/)
     // UNIMPLEMENTED
 }
 
-void CommandBufferD3D12::draw_indexed(uint32_t const /*index_count*/)
+void CommandBufferD3D12::set_instance_data(void const* /*upload_data*/, size_t /*size*/)
+{
+    // UNIMPLEMENTED
+}
+
+void CommandBufferD3D12::draw_indexed(uint32_t const /*index_count*/,
+                                      uint32_t const /*first_index*/,
+                                      int32_t const /*base_vertex*/)
+{
+    // UNIMPLEMENTED
+}
+
+void CommandBufferD3D12::draw_indexed_instanced(uint32_t const /*index_count*/,
+                                                uint32_t const /*instance_count*/,
+                                                uint32_t const /*first_index*/,
+                                                int32_t const /*base_vertex*/,
+                                                uint32_t const /*first_instance*/)
+{
+    // UNIMPLEMENTED
+}
+
+void CommandBufferD3D12::draw_indexed_indirect(void const* /*upload_data*/,
+                                               uint32_t const /*draw_count*/,
+                                               uint32_t const /*stride*/)
 {
     // UNIMPLEMENTED
 }
@@ -13,12 +13,20 @@ class CommandBufferD3D12 : public CommandBuffer
    public:
     void reset() final;
     bool begin_render_pass() final;
+    bool execute_render_pass(CommandBuffer* const* command_buffers, size_t count) final;
+    void* get_upload_data(size_t size, size_t alignment) final;
     void set_vertex_constant_data(uint32_t slot, void const* upload_data, size_t size) final;
     void set_pixel_constant_data(void const* upload_data, size_t size) final;
     void set_render_state(RenderState* const state) final;
     void set_vertex_buffer(Buffer* const buffer) final;
     void set_index_buffer(Buffer* const buffer) final;
-    void draw_indexed(uint32_t index_count) final;
+    void set_instance_data(void const* upload_data, size_t size) final;
+    void draw_indexed(uint32_t index_count, uint32_t first_index, int32_t base_vertex) final;
+    void draw_indexed_instanced(uint32_t index_count, uint32_t instance_count,
+                                uint32_t first_index, int32_t base_vertex,
+                                uint32_t first_instance) final;
+    void draw_indexed_indirect(void const* upload_data, uint32_t draw_count,
+                               uint32_t stride) final;
     void draw(uint32_t vertex_count) final;
     void end_render_pass() final;
 
@@ -237,16 +237,32 @@ int GraphicsD3D12::num_available_command_buffers()
     }
     return free_buffers;
 }
-bool GraphicsD3D12::execute(CommandBuffer* command_buffer)
+CommandBuffer* GraphicsD3D12::render_pass_command_buffer()
+{
+    // UNIMPLEMENTED
+    return nullptr;
+}
+bool GraphicsD3D12::execute(CommandBuffer* const* const command_buffers, size_t const count)
 {
     Expects(_device);
-    auto* const d3d12_buffer = static_cast<CommandBufferD3D12*>(command_buffer);  // NOLINT
-    HRESULT const hr = d3d12_buffer->_list->Close();
-    assert(SUCCEEDED(hr) && "Could not close command list");
+    Expects(count > 0 && command_buffers);
+    HRESULT hr = S_OK;
+    _submit_lists.clear();
+    for (size_t ii = 0; ii < count; ++ii) {
+        auto* const d3d12_buffer = static_cast<CommandBufferD3D12*>(command_buffers[ii]);  // NOLINT
+        hr = d3d12_buffer->_list->Close();
+        assert(SUCCEEDED(hr) && "Could not close command list");
+        _submit_lists.push_back(d3d12_buffer->_list.p);
+    }
 
-    _render_queue->ExecuteCommandLists(1, CommandListCast(&d3d12_buffer->_list.p));
-    d3d12_buffer->_completion = _last_fence_completion++;
-    _render_queue->Signal(_render_fence, d3d12_buffer->_completion);
+    // The lists run in order, and all complete at the one fence value
+    _render_queue->ExecuteCommandLists(static_cast<UINT>(_submit_lists.size()),
+                                       _submit_lists.data());
+    uint64_t const completion = _last_fence_completion++;
+    for (size_t ii = 0; ii < count; ++ii) {
+        static_cast<CommandBufferD3D12*>(command_buffers[ii])->_completion = completion;  // NOLINT
+    }
+    _render_queue->Signal(_render_fence, completion);
     return SUCCEEDED(hr);
 }
 
@@ -340,7 +356,8 @@ std::unique_ptr<Buffer> GraphicsD3D12::create_vertex_buffer(uint32_t size, void
     return nullptr;
 }
 
-std::unique_ptr<Buffer> GraphicsD3D12::create_index_buffer(uint32_t /*size*/, void const* /*data*/)
+std::unique_ptr<Buffer> GraphicsD3D12::create_index_buffer(uint32_t /*size*/, void const* /*data*/,
+                                                           IndexFormat /*format*/)
 {
     return std::unique_ptr<Buffer>();
 }
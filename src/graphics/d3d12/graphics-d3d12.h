@@ -4,6 +4,7 @@
 
 #include <array>
 #include <atomic>
+#include <vector>
 #include <gsl/gsl_assert>
 
 #include <d3d12.h>
@@ -68,14 +69,17 @@ class GraphicsD3D12 : public Graphics
     bool resize(int, int) final;
     bool present() final;
     CommandBuffer* command_buffer() final;
+    CommandBuffer* render_pass_command_buffer() final;
     int num_available_command_buffers() final;
-    bool execute(CommandBuffer* command_buffer) final;
+    using Graphics::execute;
+    bool execute(CommandBuffer* const* command_buffers, size_t count) final;
     void wait_for_idle() final;
     void* get_upload_data(size_t const size, size_t const alignment) final;
 
     std::unique_ptr<RenderState> create_render_state(RenderStateDesc const& desc) final;
     std::unique_ptr<Buffer> create_vertex_buffer(uint32_t size, void const* data) final;
-    std::unique_ptr<Buffer> create_index_buffer(uint32_t size, void const* data) final;
+    std::unique_ptr<Buffer> create_index_buffer(uint32_t size, void const* data,
+                                                IndexFormat format) final;
 
    private:
     friend class CommandBufferD3D12;
@@ -134,6 +138,7 @@ class GraphicsD3D12 : public Graphics
 
     std::array<CommandBufferD3D12, kMaxCommandBuffers> _command_lists;
     std::atomic<uint32_t> _current_command_buffer = {};
+    std::vector<ID3D12CommandList*> _submit_lists;  ///< scratch for execute
 
 #if defined(_DEBUG)
     CComPtr<IDXGIDebug1> _dxgi_debug;
@@ -6,6 +6,8 @@
 #if defined(__APPLE__)
 #include "metal/graphics-metal.h"
 #endif
+#include "null/graphics-null.h"
+#include "software/graphics-software.h"
 
 namespace {
 
@@ -16,8 +18,8 @@ constexpr ak::Graphics::API platform_default_api()
 #elif defined(__APPLE__)
     return ak::Graphics::kMetal;
 #else
-#error Must specify default API
-    return ak::Graphics::kUnknown;
+    // No supported GPU API on this platform, but headless use still works
+    return ak::Graphics::kNull;
 #endif
 }
 
@@ -30,6 +32,33 @@ RenderState::~RenderState() = default;
 Buffer::~Buffer() = default;
 Graphics::~Graphics() = default;
 
+uint32_t index_format_size(IndexFormat const format)
+{
+    return format == IndexFormat::kUInt32 ? sizeof(uint32_t) : sizeof(uint16_t);
+}
+
+uint32_t vertex_format_size(VertexFormat const format)
+{
+    switch (format) {
+        case VertexFormat::kFloat1:
+            return sizeof(float);
+        case VertexFormat::kFloat2:
+            return sizeof(float) * 2;
+        case VertexFormat::kFloat3:
+            return sizeof(float) * 3;
+        case VertexFormat::kFloat4:
+            return sizeof(float) * 4;
+        case VertexFormat::kSnorm16x2:
+            return sizeof(int16_t) * 2;
+        case VertexFormat::kSnorm16x4:
+            return sizeof(int16_t) * 4;
+        case VertexFormat::kUnknown:
+        default:
+            break;
+    }
+    return 0;
+}
+
 ScopedGraphics create_graphics(Graphics::API api)
 {
     if (api == Graphics::kDefault) {
@@ -46,6 +75,10 @@ ScopedGraphics create_graphics(Graphics::API api)
         case ak::Graphics::kMetal:
             return create_graphics_metal();
 #endif  // __APPLE__
+        case ak::Graphics::kNull:
+            return create_graphics_null();
+        case ak::Graphics::kSoftware:
+            return create_graphics_software();
         case ak::Graphics::kDefault:
         case ak::Graphics::kUnknown:
         default:
@@ -1,5 +1,6 @@
 #ifndef _AK_GRAPHICS_H_
 #define _AK_GRAPHICS_H_
+#include <cstdint>
 #include <memory>
 
 namespace ak {
@@ -10,15 +11,59 @@ struct ShaderDesc
     size_t size;
 };
 
+/// Format of one vertex attribute in the vertex buffer
+enum class VertexFormat {
+    kUnknown = 0,
+    kFloat1,
+    kFloat2,
+    kFloat3,
+    kFloat4,
+    kSnorm16x2,  ///< int16_t components read as floats in [-1, 1]
+    kSnorm16x4,
+};
+
+/// @brief Size of one attribute of `format` in bytes, or 0 for kUnknown
+uint32_t vertex_format_size(VertexFormat format);
+
+/// Element type of an index buffer
+enum class IndexFormat {
+    kUInt16,
+    kUInt32,  ///< For meshes, or merged sets of meshes, with more than 65535 vertices
+};
+
+/// @brief Size of one index of `format` in bytes
+uint32_t index_format_size(IndexFormat format);
+
+/// Which stream a vertex attribute is read from
+enum class InputRate {
+    kPerVertex = 0,  ///< The vertex buffer, advancing once per vertex
+    kPerInstance,    ///< The instance data, advancing once per instance
+};
+
+/// One vertex attribute. Attributes are tightly packed in the order given
+///     within their stream, so each stream's stride is the sum of the sizes of
+///     its attributes.
 struct InputLayout
 {
     char const* name;
     uint32_t slot;
-    uint32_t num_floats;  // TODO(kw): Support more than just float
+    VertexFormat format;
+    InputRate rate;
 };
 static InputLayout const kEndLayout = {
-    nullptr, 0, 0,
+    nullptr, 0, VertexFormat::kUnknown, InputRate::kPerVertex,
 };
+/// Arguments of one draw made by CommandBuffer::draw_indexed_indirect, laid out
+///     as VkDrawIndexedIndirectCommand and D3D12_DRAW_INDEXED_ARGUMENTS
+struct DrawIndexedArguments
+{
+    uint32_t index_count;
+    uint32_t instance_count;
+    uint32_t first_index;  ///< Offset of the first index to draw in the index buffer
+    int32_t base_vertex;   ///< Value added to each index before reading the vertex buffer
+    uint32_t first_instance;
+};
+
 struct RenderStateDesc
 {
     ShaderDesc vertex_shader;
@@ -45,6 +90,20 @@ class CommandBuffer
     /// framebuffer.
     virtual bool begin_render_pass() = 0;
 
+    /// @brief Makes a whole render pass out of render pass command buffers: begins
+    ///     the pass, runs their commands in the order given and ends it
+    /// @param[in] command_buffers Buffers from Graphics::render_pass_command_buffer,
+    ///     whose recording is finished. They are executed with this buffer, and
+    ///     must not be accessed after this call.
+    virtual bool execute_render_pass(CommandBuffer* const* command_buffers, size_t count) = 0;
+
+    /// @brief Allocates upload memory for this command buffer's own use, from
+    ///     blocks of the device's upload buffer. Unlike Graphics::get_upload_data,
+    ///     only the first allocation of each block takes a lock, so buffers
+    ///     recorded on different threads allocate without contention.
+    /// @note The memory is valid until the buffer is executed or reset
+    virtual void* get_upload_data(size_t size, size_t alignment = 256) = 0;
+
     /// @brief Sets constant buffer in vertex shader slot 0
     /// @param[in] upload_data A pointer previously retrieved from `get_upload_buffer`
     virtual void set_vertex_constant_data(uint32_t slot, void const* upload_data, size_t size) = 0;
@@ -56,13 +115,42 @@ class CommandBuffer
     /// Resource setting
     virtual void set_render_state(RenderState* const state) = 0;
     virtual void set_vertex_buffer(Buffer* const buffer) = 0;
+    /// @brief Binds an index buffer, read in the format it was created with
     virtual void set_index_buffer(Buffer* const buffer) = 0;
+    /// @brief Binds the per-instance stream, read by the render state's
+    ///     InputRate::kPerInstance attributes
+    /// @param[in] upload_data A pointer previously retrieved from `get_upload_buffer`
+    virtual void set_instance_data(void const* upload_data, size_t size) = 0;
 
     /// @brief Makes a non-indexed draw call
     virtual void draw(uint32_t vertex_count) = 0;
 
     /// @brief Makes an indexed draw call
-    virtual void draw_indexed(uint32_t index_count) = 0;
+    /// @param[in] first_index Offset of the first index to draw in the index buffer
+    /// @param[in] base_vertex Value added to each index before reading the vertex buffer
+    virtual void draw_indexed(uint32_t index_count, uint32_t first_index,
+                              int32_t base_vertex) = 0;
+
+    /// @brief Makes an indexed draw call for several instances of a mesh
+    /// @param[in] first_index Offset of the first index to draw in the index buffer
+    /// @param[in] base_vertex Value added to each index before reading the vertex buffer
+    /// @param[in] first_instance Element of the instance data the first instance reads
+    virtual void draw_indexed_instanced(uint32_t index_count, uint32_t instance_count,
+                                        uint32_t first_index, int32_t base_vertex,
+                                        uint32_t first_instance) = 0;
+
+    /// @brief Makes `draw_count` indexed draw calls, whose arguments are read
+    ///     when the command buffer is executed
+    /// @details Devices that cannot start an indirect draw past instance 0
+    ///     (Vulkan without drawIndirectFirstInstance) make the draws directly
+    ///     instead, reading the arguments as the call is recorded, so they have
+    ///     to be written before it.
+    /// @param[in] upload_data An array of DrawIndexedArguments in memory
+    ///     previously retrieved from `get_upload_buffer`
+    /// @param[in] stride Bytes from one draw's arguments to the next; at least
+    ///     sizeof(DrawIndexedArguments) and a multiple of 4
+    virtual void draw_indexed_indirect(void const* upload_data, uint32_t draw_count,
+                                       uint32_t stride) = 0;
 
     /// @brief Ends a previously started render pass
     virtual void end_render_pass() = 0;
@@ -99,6 +187,8 @@ class Graphics
         kD3D12,
         kVulkan,
         kMetal,
+        kNull,      ///< No rendering. Available on every platform.
+        kSoftware,  ///< Rasterizes on the CPU, offscreen. Available on every platform.
 
         kUnknown = -1,
     };
@@ -109,6 +199,7 @@ class Graphics
     /// @details Windows D3D: IDXGISwapChain
     ///          macOS Metal: CAMetalLayer
     ///          Windows Vulkan: vkSwapChainKHR
+    ///          Software: an offscreen image; the window is not used
     /// @param[in] window Native window handle (Windows: HWND, macOS: NSWindow*)
     /// @param[in] application Native application handle (Windows: HINSTANCE, macOS: NSApplication*)
     virtual bool create_swap_chain(void* window, void* application) = 0;
@@ -124,18 +215,34 @@ class Graphics
     /// @return NULL if no command buffers are available
     virtual CommandBuffer* command_buffer() = 0;
 
+    /// @brief Returns an open command buffer that records draws for the inside
+    ///     of a render pass, to be run by CommandBuffer::execute_render_pass.
+    ///     It is already in the pass, so it does not begin or end one, and
+    ///     starts with nothing bound.
+    /// @details Several can be recorded at once, each on its own thread, to
+    ///     split the draws of one render pass across threads.
+    ///          Windows D3D: a direct command list
+    ///          macOS Metal: an encoder of a parallel render command encoder
+    ///          Windows Vulkan: a secondary command buffer
+    /// @return NULL if no command buffers are available
+    virtual CommandBuffer* render_pass_command_buffer() = 0;
+
     /// @brief Returns a rough guess of currently available command buffers
     /// @note This method is not atomic, due to threading, this number may not be
     ///     exact.
     virtual int num_available_command_buffers() = 0;
 
+    /// @brief Executes command buffers on the GPU, in the order given, as one
+    ///     submission
+    virtual bool execute(CommandBuffer* const* command_buffers, size_t count) = 0;
     /// @brief Executes a command buffer on the GPU
-    virtual bool execute(CommandBuffer* command_buffer) = 0;
+    bool execute(CommandBuffer* command_buffer) { return execute(&command_buffer, 1); }
 
     /// @brief Waits on the CPU until the GPU is idle
     virtual void wait_for_idle() = 0;
 
-    /// @brief Allocates memory from the upload buffer to use as constant buffer data
+    /// @brief Allocates memory from the upload buffer to use as constant buffer,
+    ///     instance or draw argument data. Safe to call from any thread.
     virtual void* get_upload_data(size_t const size, size_t const alignment = 256) = 0;
     template<typename T>
     T* get_upload_data()
@@ -145,7 +252,8 @@ class Graphics
 
     virtual std::unique_ptr<RenderState> create_render_state(RenderStateDesc const& desc) = 0;
     virtual std::unique_ptr<Buffer> create_vertex_buffer(uint32_t size, void const* data) = 0;
-    virtual std::unique_ptr<Buffer> create_index_buffer(uint32_t size, void const* data) = 0;
+    virtual std::unique_ptr<Buffer> create_index_buffer(uint32_t size, void const* data,
+                                                        IndexFormat format) = 0;
 };
 
 using ScopedGraphics = std::unique_ptr<Graphics>;
@@ -0,0 +1,51 @@
+#ifndef _AK_SOFTWARE_SHADER_H_
+#define _AK_SOFTWARE_SHADER_H_
+#include <cstdint>
+
+namespace ak {
+
+// The kSoftware device runs shaders written in C++. The ShaderDesc of a
+// render state points at a SoftwareVertexShader or SoftwarePixelShader in place
+// of bytecode, with the size of that struct.
+
+/// Most floats a vertex shader can pass on to the pixel shader
+constexpr uint32_t kSoftwareMaxVaryings = 8;
+/// Most vertex attributes of an input layout
+constexpr uint32_t kSoftwareMaxAttributes = 4;
+/// Most vertex constant buffer slots
+constexpr uint32_t kSoftwareMaxConstantSlots = 4;
+
+/// Output of a vertex shader
+struct SoftwareVertex
+{
+    float position[4];  ///< Clip space position; depth is z / w in [0, 1]
+    float varyings[kSoftwareMaxVaryings];
+};
+
+struct SoftwareVertexShader
+{
+    /// @brief Shades one vertex
+    /// @param[in] constants The constant data bound to each vertex slot, or
+    ///     nullptr for a slot with none
+    /// @param[in] attributes The vertex's attributes, by input layout slot.
+    ///     Each is read as four floats; components its format lacks are 0,
+    ///     except w, which is 1.
+    void (*main)(void const* const* constants, float const (*attributes)[4],
+                 SoftwareVertex* vertex);
+    /// Varyings the shader writes, from the first
+    uint32_t varying_count;
+};
+
+struct SoftwarePixelShader
+{
+    /// @brief Shades one pixel
+    /// @param[in] constants The pixel constant data, or nullptr if none is bound
+    /// @param[in] varyings The vertex shader's varyings, interpolated with
+    ///     perspective correction
+    /// @param[out] color Red, green, blue and alpha in [0, 1]
+    void (*main)(void const* constants, float const* varyings, float* color);
+};
+
+}  // namespace ak
+
+#endif  // _AK_SOFTWARE_SHADER_H_
@@ -14,6 +14,16 @@ class CommandBufferMetal : public CommandBuffer
    public:
     void reset() final;
     bool begin_render_pass() final;
+    bool execute_render_pass(CommandBuffer* const* /*command_buffers*/, size_t /*count*/) final
+    {
+        // UNIMPLEMENTED
+        return false;
+    }
+    void* get_upload_data(size_t /*size*/, size_t /*alignment*/) final
+    {
+        // UNIMPLEMENTED
+        return nullptr;
+    }
     void set_vertex_constant_data(uint32_t /*slot*/, void const* /*upload_data*/, size_t /*size*/) final
     {
         // UNIMPLEMENTED
@@ -34,11 +44,27 @@ class CommandBufferMetal : public CommandBuffer
     {
         // UNIMPLEMENTED
     }
+    void set_instance_data(void const* /*upload_data*/, size_t /*size*/) final
+    {
+        // UNIMPLEMENTED
+    }
     void draw(uint32_t /*vertex_count*/) final
     {
         // UNIMPLEMENTED
     }
-    void draw_indexed(uint32_t /*index_count*/) final
+    void draw_indexed(uint32_t /*index_count*/, uint32_t /*first_index*/,
+                      int32_t /*base_vertex*/) final
+    {
+        // UNIMPLEMENTED
+    }
+    void draw_indexed_instanced(uint32_t /*index_count*/, uint32_t /*instance_count*/,
+                                uint32_t /*first_index*/, int32_t /*base_vertex*/,
+                                uint32_t /*first_instance*/) final
+    {
+        // UNIMPLEMENTED
+    }
+    void draw_indexed_indirect(void const* /*upload_data*/, uint32_t /*draw_count*/,
+                               uint32_t /*stride*/) final
     {
         // UNIMPLEMENTED
     }
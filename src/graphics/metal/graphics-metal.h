@@ -25,14 +25,17 @@ class GraphicsMetal : public Graphics
     bool resize(int, int) final;
     bool present() final;
     CommandBuffer* command_buffer() final;
+    CommandBuffer* render_pass_command_buffer() final;
     int num_available_command_buffers() final;
-    bool execute(CommandBuffer* command_buffer) final;
+    using Graphics::execute;
+    bool execute(CommandBuffer* const* command_buffers, size_t count) final;
     void wait_for_idle() final;
     void* get_upload_data(size_t const size, size_t const alignment) final;
 
     std::unique_ptr<RenderState> create_render_state(RenderStateDesc const& /*desc*/) final;
     std::unique_ptr<Buffer> create_vertex_buffer(uint32_t size, void const* data) final;
-    std::unique_ptr<Buffer> create_index_buffer(uint32_t size, void const* data) final;
+    std::unique_ptr<Buffer> create_index_buffer(uint32_t size, void const* data,
+                                                IndexFormat format) final;
 
    private:
     friend class CommandBufferMetal;
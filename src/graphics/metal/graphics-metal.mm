@@ -92,13 +92,22 @@ int GraphicsMetal::num_available_command_buffers()
     }
     return free_buffers;
 }
-bool GraphicsMetal::execute(CommandBuffer* command_buffer)
+CommandBuffer* GraphicsMetal::render_pass_command_buffer()
 {
-    auto* const metal_buffer = static_cast<CommandBufferMetal*>(command_buffer);
-    [metal_buffer->_buffer addCompletedHandler:^(id<MTLCommandBuffer> /*buffer*/) {
-        metal_buffer->reset();
-    }];
-    [metal_buffer->_buffer commit];
+    // UNIMPLEMENTED
+    return nullptr;
+}
+bool GraphicsMetal::execute(CommandBuffer* const* const command_buffers, size_t const count)
+{
+    Expects(count > 0 && command_buffers);
+    // Buffers of one queue run in the order they are committed
+    for (size_t ii = 0; ii < count; ++ii) {
+        auto* const metal_buffer = static_cast<CommandBufferMetal*>(command_buffers[ii]);
+        [metal_buffer->_buffer addCompletedHandler:^(id<MTLCommandBuffer> /*buffer*/) {
+            metal_buffer->reset();
+        }];
+        [metal_buffer->_buffer commit];
+    }
     return true;
 }
 void GraphicsMetal::wait_for_idle()
@@ -123,7 +132,8 @@ std::unique_ptr<Buffer> GraphicsMetal::create_vertex_buffer(uint32_t /*size*/, v
     // UNIMPLEMENTED
     return std::unique_ptr<Buffer>();
 }
-std::unique_ptr<Buffer> GraphicsMetal::create_index_buffer(uint32_t /*size*/, void const* /*data*/)
+std::unique_ptr<Buffer> GraphicsMetal::create_index_buffer(uint32_t /*size*/, void const* /*data*/,
+                                                           IndexFormat /*format*/)
 {
     // UNIMPLEMENTED
     return std::unique_ptr<Buffer>();
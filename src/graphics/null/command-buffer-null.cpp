@@ -0,0 +1,229 @@
+#include "command-buffer-null.h"
+#include "graphics-null.h"
+
+#include <algorithm>
+#include <cstring>
+#include <gsl/gsl>
+
+namespace ak {
+
+constexpr size_t CommandBufferNull::kUploadBlockSize;
+
+void CommandBufferNull::clear()
+{
+    _commands.clear();
+    _render_pass_buffers.clear();
+    _open = false;
+    _in_render_pass = false;
+    _render_pass_only = false;
+    _index_buffer = nullptr;
+    _upload_block = nullptr;
+    _upload_block_end = nullptr;
+}
+
+void CommandBufferNull::reset()
+{
+    if (_open) {
+        _graphics->release(this);
+    }
+}
+
+bool CommandBufferNull::begin_render_pass()
+{
+    Expects(_open && !_in_render_pass && !_render_pass_only);
+    if (!_graphics->_swap_chain) {
+        return false;
+    }
+    _in_render_pass = true;
+    _commands.push_back({CommandTypeNull::kBeginRenderPass});
+    return true;
+}
+
+bool CommandBufferNull::execute_render_pass(CommandBuffer* const* const command_buffers,
+                                            size_t const count)
+{
+    Expects(count == 0 || command_buffers);
+    for (size_t ii = 0; ii < count; ++ii) {
+        auto* const buffer = static_cast<CommandBufferNull*>(command_buffers[ii]);
+        // Each buffer can only be run once, and is closed by running it
+        Expects(buffer && buffer->_graphics == _graphics && buffer->_render_pass_only &&
+                buffer->_in_render_pass);
+        buffer->_in_render_pass = false;
+    }
+    if (!begin_render_pass()) {
+        for (size_t ii = 0; ii < count; ++ii) {
+            static_cast<CommandBufferNull*>(command_buffers[ii])->reset();
+        }
+        return false;
+    }
+    for (size_t ii = 0; ii < count; ++ii) {
+        auto* const buffer = static_cast<CommandBufferNull*>(command_buffers[ii]);
+        CommandNull command = {CommandTypeNull::kExecuteCommands};
+        command.object = buffer;
+        _commands.push_back(command);
+        _render_pass_buffers.push_back(buffer);
+    }
+    end_render_pass();
+    return true;
+}
+
+void* CommandBufferNull::get_upload_data(size_t const size, size_t const alignment)
+{
+    Expects(_open);
+    Expects(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    // Aligned as offsets in the upload buffer, as the device aligns them
+    auto* const upload_start = _graphics->_upload_buffer.data();
+    size_t offset = 0;
+    if (_upload_block != nullptr) {
+        offset = (size_t(_upload_block - upload_start) + alignment - 1) & ~(alignment - 1);
+    }
+    if (_upload_block == nullptr || offset + size > size_t(_upload_block_end - upload_start)) {
+        // Data larger than a block gets a block to itself
+        size_t const block_size = std::max(size, kUploadBlockSize);
+        auto* const block =
+            static_cast<uint8_t*>(_graphics->get_upload_data(block_size, alignment));
+        if (block == nullptr) {
+            return nullptr;
+        }
+        _upload_block = block + size;
+        _upload_block_end = block + block_size;
+        return block;
+    }
+    _upload_block = upload_start + offset + size;
+    return upload_start + offset;
+}
+
+void CommandBufferNull::record_upload_data(CommandTypeNull const type, uint32_t const slot,
+                                           void const* const upload_data, size_t const size)
+{
+    Expects(_open && upload_data);
+    // As on a GPU, only the upload buffer can be bound
+    auto const* const upload_start = _graphics->_upload_buffer.data();
+    auto const* const data = static_cast<uint8_t const*>(upload_data);
+    Expects(data >= upload_start && size <= _graphics->_upload_buffer.size() &&
+            size_t(data - upload_start) <= _graphics->_upload_buffer.size() - size);
+
+    CommandNull command = {type, slot};
+    command.size = static_cast<uint32_t>(size);
+    command.upload_offset = size_t(data - upload_start);
+    _commands.push_back(command);
+}
+
+void CommandBufferNull::set_vertex_constant_data(uint32_t const slot, void const* upload_data,
+                                                 size_t const size)
+{
+    record_upload_data(CommandTypeNull::kSetVertexConstantData, slot, upload_data, size);
+}
+
+void CommandBufferNull::set_pixel_constant_data(void const* upload_data, size_t const size)
+{
+    record_upload_data(CommandTypeNull::kSetPixelConstantData, 0, upload_data, size);
+}
+
+void CommandBufferNull::set_render_state(RenderState* const state)
+{
+    Expects(_open && state);
+    CommandNull command = {CommandTypeNull::kSetRenderState};
+    command.object = state;
+    _commands.push_back(command);
+}
+
+void CommandBufferNull::set_vertex_buffer(Buffer* const buffer)
+{
+    Expects(_open && buffer);
+    CommandNull command = {CommandTypeNull::kSetVertexBuffer};
+    command.object = buffer;
+    _commands.push_back(command);
+}
+
+void CommandBufferNull::set_index_buffer(Buffer* const buffer)
+{
+    Expects(_open && buffer);
+    _index_buffer = static_cast<BufferNull*>(buffer);
+    CommandNull command = {CommandTypeNull::kSetIndexBuffer};
+    command.object = buffer;
+    _commands.push_back(command);
+}
+
+void CommandBufferNull::set_instance_data(void const* upload_data, size_t const size)
+{
+    record_upload_data(CommandTypeNull::kSetInstanceData, 0, upload_data, size);
+}
+
+void CommandBufferNull::draw(uint32_t const vertex_count)
+{
+    Expects(_in_render_pass);
+    CommandNull command = {CommandTypeNull::kDraw};
+    command.count = vertex_count;
+    _commands.push_back(command);
+}
+
+void CommandBufferNull::draw_indexed(uint32_t const index_count, uint32_t const first_index,
+                                     int32_t const base_vertex)
+{
+    Expects(_in_render_pass && _index_buffer);
+    size_t const index_size = index_format_size(_index_buffer->_index_format);
+    Expects((size_t{first_index} + index_count) * index_size <= _index_buffer->_data.size());
+    CommandNull command = {CommandTypeNull::kDrawIndexed};
+    command.count = index_count;
+    command.first_index = first_index;
+    command.base_vertex = base_vertex;
+    _commands.push_back(command);
+}
+
+void CommandBufferNull::draw_indexed_instanced(uint32_t const index_count,
+                                               uint32_t const instance_count,
+                                               uint32_t const first_index,
+                                               int32_t const base_vertex,
+                                               uint32_t const first_instance)
+{
+    Expects(_in_render_pass && _index_buffer);
+    size_t const index_size = index_format_size(_index_buffer->_index_format);
+    Expects((size_t{first_index} + index_count) * index_size <= _index_buffer->_data.size());
+    CommandNull command = {CommandTypeNull::kDrawIndexedInstanced};
+    command.count = index_count;
+    command.first_index = first_index;
+    command.base_vertex = base_vertex;
+    command.instance_count = instance_count;
+    command.first_instance = first_instance;
+    _commands.push_back(command);
+}
+
+void CommandBufferNull::draw_indexed_indirect(void const* const upload_data,
+                                              uint32_t const draw_count, uint32_t const stride)
+{
+    Expects(_in_render_pass && _index_buffer && upload_data);
+    Expects(stride >= sizeof(DrawIndexedArguments) && stride % 4 == 0);
+    // The arguments are read when the buffer is executed, so only their
+    // place in the upload buffer can be checked now
+    auto const* const upload_start = _graphics->_upload_buffer.data();
+    auto const* const data = static_cast<uint8_t const*>(upload_data);
+    size_t const size =
+        draw_count > 0 ? size_t{draw_count - 1} * stride + sizeof(DrawIndexedArguments) : 0;
+    Expects(data >= upload_start && size <= _graphics->_upload_buffer.size() &&
+            size_t(data - upload_start) <= _graphics->_upload_buffer.size() - size);
+
+    if (!_graphics->_indirect_first_instance) {
+        for (uint32_t ii = 0; ii < draw_count; ++ii) {
+            DrawIndexedArguments draw;
+            memcpy(&draw, data + size_t{ii} * stride, sizeof(draw));
+            draw_indexed_instanced(draw.index_count, draw.instance_count, draw.first_index,
+                                   draw.base_vertex, draw.first_instance);
+        }
+        return;
+    }
+    CommandNull command = {CommandTypeNull::kDrawIndexedIndirect};
+    command.count = draw_count;
+    command.stride = stride;
+    command.upload_offset = size_t(data - upload_start);
+    _commands.push_back(command);
+}
+
+void CommandBufferNull::end_render_pass()
+{
+    Expects(_in_render_pass && !_render_pass_only);
+    _in_render_pass = false;
+    _commands.push_back({CommandTypeNull::kEndRenderPass});
+}
+
+}  // namespace ak
@@ -0,0 +1,98 @@
+#ifndef _AK_COMMANDBUFFER_NULL_H_
+#define _AK_COMMANDBUFFER_NULL_H_
+#include "graphics/graphics.h"
+
+#include <vector>
+
+namespace ak {
+
+enum class CommandTypeNull : uint32_t {
+    kBeginRenderPass,
+    kSetVertexConstantData,
+    kSetPixelConstantData,
+    kSetRenderState,
+    kSetVertexBuffer,
+    kSetIndexBuffer,
+    kSetInstanceData,
+    kDraw,
+    kDrawIndexed,
+    kDrawIndexedInstanced,
+    kDrawIndexedIndirect,
+    kExecuteCommands,
+    kEndRenderPass,
+};
+
+/// One recorded command. Only the fields its type uses are set; the rest stay zero.
+struct CommandNull
+{
+    CommandTypeNull type;
+    uint32_t slot = 0;             ///< Constant buffer slot
+    uint32_t count = 0;            ///< Vertices or indices drawn, or draws of kDrawIndexedIndirect
+    uint32_t first_index = 0;      ///< kDrawIndexed and kDrawIndexedInstanced
+    int32_t base_vertex = 0;       ///< kDrawIndexed and kDrawIndexedInstanced
+    uint32_t instance_count = 0;   ///< kDrawIndexedInstanced
+    uint32_t first_instance = 0;   ///< kDrawIndexedInstanced
+    uint32_t size = 0;             ///< Bytes of constant or instance data
+    uint32_t stride = 0;           ///< Bytes between the draw arguments of kDrawIndexedIndirect
+    size_t upload_offset = 0;      ///< Offset of the data or draw arguments in the upload buffer
+    void const* object = nullptr;  ///< The bound RenderState or Buffer, or CommandBufferNull run
+};
+
+/// Command buffer that validates call order and records the commands into
+/// memory, for GraphicsNull to "execute" by reading them back
+class CommandBufferNull : public CommandBuffer
+{
+   public:
+    void reset() final;
+    bool begin_render_pass() final;
+    bool execute_render_pass(CommandBuffer* const* command_buffers, size_t count) final;
+    void* get_upload_data(size_t size, size_t alignment) final;
+    void set_vertex_constant_data(uint32_t slot, void const* upload_data, size_t size) final;
+    void set_pixel_constant_data(void const* upload_data, size_t size) final;
+    void set_render_state(RenderState* const state) final;
+    void set_vertex_buffer(Buffer* const buffer) final;
+    void set_index_buffer(Buffer* const buffer) final;
+    void set_instance_data(void const* upload_data, size_t size) final;
+    void draw(uint32_t vertex_count) final;
+    void draw_indexed(uint32_t index_count, uint32_t first_index, int32_t base_vertex) final;
+    void draw_indexed_instanced(uint32_t index_count, uint32_t instance_count,
+                                uint32_t first_index, int32_t base_vertex,
+                                uint32_t first_instance) final;
+    void draw_indexed_indirect(void const* upload_data, uint32_t draw_count,
+                               uint32_t stride) final;
+    void end_render_pass() final;
+
+    /// @brief The commands recorded since the buffer was opened
+    std::vector<CommandNull> const& commands() const { return _commands; }
+
+    /// Upload memory taken from the device at a time by get_upload_data
+    static constexpr size_t kUploadBlockSize = 256 * 1024;
+
+   private:
+    friend class GraphicsNull;
+
+    /// @brief Forgets all recorded commands and state, keeping the memory
+    void clear();
+    void record_upload_data(CommandTypeNull type, uint32_t slot, void const* upload_data,
+                            size_t size);
+
+    class GraphicsNull* _graphics = nullptr;
+
+    class BufferNull* _index_buffer = nullptr;
+    std::vector<CommandNull> _commands;
+    /// Render pass command buffers run by this one, released with it
+    std::vector<CommandBufferNull*> _render_pass_buffers;
+    /// Upload buffer position when the buffer was opened; see GraphicsNull
+    uint64_t _upload_start = 0;
+    // the rest of the upload block get_upload_data allocates from
+    uint8_t* _upload_block = nullptr;
+    uint8_t* _upload_block_end = nullptr;
+
+    bool _open = false;
+    bool _in_render_pass = false;
+    bool _render_pass_only = false;  ///< from render_pass_command_buffer
+};
+
+}  // namespace ak
+
+#endif  // _AK_COMMANDBUFFER_NULL_H_
@@ -0,0 +1,253 @@
+#include "graphics-null.h"
+
+#include <algorithm>
+#include <cstring>
+#include <gsl/gsl>
+
+namespace ak {
+
+constexpr uint32_t GraphicsNull::kUploadBufferSize;
+
+GraphicsNull::GraphicsNull(bool const indirect_first_instance)
+    : _indirect_first_instance(indirect_first_instance)
+    , _upload_buffer(kUploadBufferSize)
+{
+    // Handed out from the back, so the first request gets the first buffer
+    _free_command_buffers.reserve(kMaxCommandBuffers);
+    for (size_t ii = kMaxCommandBuffers; ii-- > 0;) {
+        auto& buffer = gsl::at(_command_buffers, ii);
+        buffer._graphics = this;
+        _free_command_buffers.push_back(&buffer);
+    }
+}
+
+GraphicsNull::~GraphicsNull() = default;
+
+Graphics::API GraphicsNull::api_type() const
+{
+    return kNull;
+}
+
+bool GraphicsNull::create_swap_chain(void* /*window*/, void* /*application*/)
+{
+    // There is nothing to present to, so any window will do, even none
+    _swap_chain = true;
+    return true;
+}
+
+bool GraphicsNull::resize(int /*width*/, int /*height*/)
+{
+    return _swap_chain;
+}
+
+bool GraphicsNull::present()
+{
+    return _swap_chain;
+}
+
+CommandBuffer* GraphicsNull::command_buffer()
+{
+    return acquire();
+}
+
+CommandBuffer* GraphicsNull::render_pass_command_buffer()
+{
+    auto* const buffer = acquire();
+    if (buffer != nullptr) {
+        buffer->_render_pass_only = true;
+        buffer->_in_render_pass = true;
+    }
+    return buffer;
+}
+
+CommandBufferNull* GraphicsNull::acquire()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_free_command_buffers.empty()) {
+        return nullptr;
+    }
+    // The most recently released buffer, whose command memory is likely
+    // still in cache
+    auto* const buffer = _free_command_buffers.back();
+    _free_command_buffers.pop_back();
+    buffer->_open = true;
+    buffer->_upload_start = _upload_head;
+    return buffer;
+}
+
+int GraphicsNull::num_available_command_buffers()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return static_cast<int>(_free_command_buffers.size());
+}
+
+bool GraphicsNull::execute(CommandBuffer* const* const command_buffers, size_t const count)
+{
+    Expects(count == 0 || command_buffers);
+    ExecutionStatsNull stats = {};
+    for (size_t ii = 0; ii < count; ++ii) {
+        auto* const null_buffer = static_cast<CommandBufferNull*>(command_buffers[ii]);
+        Expects(null_buffer && null_buffer->_open && !null_buffer->_in_render_pass &&
+                !null_buffer->_render_pass_only);
+        run_commands(null_buffer->_commands);
+
+        // Stand in for the GPU, which would read the commands back now
+        ++stats.command_buffers;
+        count_commands(null_buffer->_commands, &stats);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stats.command_buffers += stats.command_buffers;
+        _stats.commands += stats.commands;
+        _stats.draws += stats.draws;
+        _stats.elements += stats.elements;
+        _stats.instances += stats.instances;
+        _stats.constant_bytes += stats.constant_bytes;
+        _stats.instance_bytes += stats.instance_bytes;
+        _stats.argument_bytes += stats.argument_bytes;
+    }
+    for (size_t ii = 0; ii < count; ++ii) {
+        release(static_cast<CommandBufferNull*>(command_buffers[ii]));
+    }
+    return true;
+}
+
+void GraphicsNull::count_commands(std::vector<CommandNull> const& commands,
+                                  ExecutionStatsNull* const stats) const
+{
+    stats->commands += commands.size();
+    for (auto const& command : commands) {
+        switch (command.type) {
+            case CommandTypeNull::kSetVertexConstantData:
+            case CommandTypeNull::kSetPixelConstantData:
+                stats->constant_bytes += command.size;
+                break;
+            case CommandTypeNull::kSetInstanceData:
+                stats->instance_bytes += command.size;
+                break;
+            case CommandTypeNull::kDraw:
+            case CommandTypeNull::kDrawIndexed:
+                ++stats->draws;
+                stats->elements += command.count;
+                break;
+            case CommandTypeNull::kDrawIndexedInstanced:
+                ++stats->draws;
+                stats->elements += uint64_t{command.count} * command.instance_count;
+                stats->instances += command.instance_count;
+                break;
+            case CommandTypeNull::kDrawIndexedIndirect: {
+                auto const* const arguments =
+                    static_cast<uint8_t const*>(upload_data(command.upload_offset));
+                for (uint32_t ii = 0; ii < command.count; ++ii) {
+                    DrawIndexedArguments draw;
+                    memcpy(&draw, arguments + size_t{ii} * command.stride, sizeof(draw));
+                    Expects(draw.first_instance == 0 || _indirect_first_instance);
+                    ++stats->draws;
+                    stats->elements += uint64_t{draw.index_count} * draw.instance_count;
+                    stats->instances += draw.instance_count;
+                }
+                stats->argument_bytes += uint64_t{command.count} * sizeof(DrawIndexedArguments);
+                break;
+            }
+            case CommandTypeNull::kExecuteCommands: {
+                auto const* const buffer = static_cast<CommandBufferNull const*>(command.object);
+                ++stats->command_buffers;
+                count_commands(buffer->_commands, stats);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+void GraphicsNull::run_commands(std::vector<CommandNull> const& /*commands*/)
+{
+}
+
+void GraphicsNull::release(CommandBufferNull* const buffer)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto* const render_pass_buffer : buffer->_render_pass_buffers) {
+        render_pass_buffer->clear();
+        _free_command_buffers.push_back(render_pass_buffer);
+    }
+    buffer->clear();
+    _free_command_buffers.push_back(buffer);
+}
+
+void GraphicsNull::wait_for_idle()
+{
+    // Command buffers finish as they are executed
+}
+
+void* GraphicsNull::get_upload_data(size_t const size, size_t const alignment)
+{
+    Expects(size <= kUploadBufferSize);
+    Expects(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t const lap = _upload_head - _upload_head % kUploadBufferSize;
+    uint64_t position = lap + ((_upload_head - lap + alignment - 1) & ~uint64_t(alignment - 1));
+    if (position + size > lap + kUploadBufferSize) {
+        // Too little room before the end of the buffer: start from the beginning
+        position = lap + kUploadBufferSize;
+    }
+    uint64_t const end = position + size;
+    if (end - _upload_tail > kUploadBufferSize) {
+        // Everything allocated since the oldest open command buffer started is
+        // still in use
+        _upload_tail = _upload_head;
+        for (auto const& buffer : _command_buffers) {
+            if (buffer._open) {
+                _upload_tail = std::min(_upload_tail, buffer._upload_start);
+            }
+        }
+        if (end - _upload_tail > kUploadBufferSize) {
+            return nullptr;
+        }
+    }
+    _upload_head = end;
+    return _upload_buffer.data() + static_cast<size_t>(position % kUploadBufferSize);
+}
+
+std::unique_ptr<RenderState> GraphicsNull::create_render_state(RenderStateDesc const& /*desc*/)
+{
+    return std::make_unique<RenderStateNull>();
+}
+
+std::unique_ptr<Buffer> GraphicsNull::create_vertex_buffer(uint32_t size, void const* data)
+{
+    return create_buffer(size, data);
+}
+
+std::unique_ptr<Buffer> GraphicsNull::create_index_buffer(uint32_t size, void const* data,
+                                                          IndexFormat const format)
+{
+    auto buffer = create_buffer(size, data);
+    buffer->_index_format = format;
+    return buffer;
+}
+
+std::unique_ptr<BufferNull> GraphicsNull::create_buffer(uint32_t size, void const* data)
+{
+    auto buffer = std::make_unique<BufferNull>();
+    buffer->_data.resize(size);
+    if (data != nullptr) {
+        memcpy(buffer->_data.data(), data, size);
+    }
+    return buffer;
+}
+
+ExecutionStatsNull GraphicsNull::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+ScopedGraphics create_graphics_null()
+{
+    return std::make_unique<GraphicsNull>();
+}
+
+}  // namespace ak
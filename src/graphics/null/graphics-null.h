@@ -0,0 +1,138 @@
+#ifndef _AK_GRAPHICS_NULL_H_
+#define _AK_GRAPHICS_NULL_H_
+#include "graphics/graphics.h"
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+#include "command-buffer-null.h"
+
+namespace ak {
+
+class RenderStateNull : public RenderState
+{
+};
+
+class BufferNull : public Buffer
+{
+   public:
+    std::vector<uint8_t> _data;
+    IndexFormat _index_format = IndexFormat::kUInt16;  ///< Only used by index buffers
+};
+
+/// Totals over every command buffer a GraphicsNull has executed
+struct ExecutionStatsNull
+{
+    uint64_t command_buffers;  ///< Including the render pass command buffers they ran
+    uint64_t commands;
+    uint64_t draws;
+    uint64_t elements;        ///< Vertices and indices drawn, over every instance
+    uint64_t instances;       ///< Instances drawn by instanced and indirect draws
+    uint64_t constant_bytes;  ///< Constant data read from the upload buffer
+    uint64_t instance_bytes;  ///< Instance data read from the upload buffer
+    uint64_t argument_bytes;  ///< Indirect draw arguments read from the upload buffer
+};
+
+/// Graphics device with no GPU behind it, which lets the application run
+/// headless, e.g. for measuring the CPU side of rendering on machines without
+/// a supported API. Command buffers are pooled and record into memory;
+/// executing one reads its commands and constant data back, in place of a GPU,
+/// and returns it to the pool. Render pass command buffers share the pool, and
+/// return to it with the buffer that ran them.
+///
+/// Upload data comes from a ring buffer, as on the GPU backends. Data is in use
+/// by every command buffer that was open when it was allocated, and is only
+/// handed out again once they have all been executed or reset.
+///
+/// Devices that execute the commands themselves, such as GraphicsSoftware,
+/// derive from it for the recording and override run_commands.
+class GraphicsNull : public Graphics
+{
+   public:
+    /// @param indirect_first_instance Whether indirect draws may start past
+    ///     instance 0. Without it the command buffers make direct draws in
+    ///     their place, as the Vulkan backend does on devices without
+    ///     drawIndirectFirstInstance, and executing an indirect draw that
+    ///     starts past instance 0 fails.
+    explicit GraphicsNull(bool indirect_first_instance = true);
+    ~GraphicsNull() override;
+
+    API api_type() const override;
+    bool create_swap_chain(void* window, void* application) final;
+    bool resize(int width, int height) override;
+    bool present() override;
+    CommandBuffer* command_buffer() final;
+    CommandBuffer* render_pass_command_buffer() final;
+    int num_available_command_buffers() final;
+    using Graphics::execute;
+    bool execute(CommandBuffer* const* command_buffers, size_t count) final;
+    void wait_for_idle() final;
+    /// @return nullptr if the upload buffer has no room that is not in use
+    void* get_upload_data(size_t const size, size_t const alignment) final;
+
+    std::unique_ptr<RenderState> create_render_state(RenderStateDesc const& desc) override;
+    std::unique_ptr<Buffer> create_vertex_buffer(uint32_t size, void const* data) final;
+    std::unique_ptr<Buffer> create_index_buffer(uint32_t size, void const* data,
+                                                IndexFormat format) final;
+
+    ExecutionStatsNull stats() const;
+
+    static constexpr uint32_t kUploadBufferSize = 1024 * 1024 * 64;  // 64MiB upload buffer
+
+   protected:
+    /// @brief Runs the commands of a buffer as it is executed, in place of a
+    ///     GPU. The null device has nothing to run.
+    virtual void run_commands(std::vector<CommandNull> const& commands);
+    /// @brief The constant or instance data a command recorded at `upload_offset`
+    void const* upload_data(size_t const upload_offset) const
+    {
+        return _upload_buffer.data() + upload_offset;
+    }
+
+   private:
+    friend class CommandBufferNull;
+
+    GraphicsNull(const GraphicsNull&) = delete;
+    GraphicsNull& operator=(const GraphicsNull&) = delete;
+    GraphicsNull(GraphicsNull&&) = delete;
+    GraphicsNull& operator=(GraphicsNull&&) = delete;
+
+    std::unique_ptr<BufferNull> create_buffer(uint32_t size, void const* data);
+    /// @brief Takes an open command buffer from the pool
+    CommandBufferNull* acquire();
+    /// @brief Returns an open command buffer to the pool, with the render pass
+    ///     buffers it ran
+    void release(CommandBufferNull* buffer);
+    /// @brief Adds up the commands, and those of the render pass buffers they run
+    void count_commands(std::vector<CommandNull> const& commands,
+                        ExecutionStatsNull* stats) const;
+
+    //
+    // data members
+    //
+
+    // guards the pool, the upload buffer positions and the stats, so command
+    // buffers can be recorded on several threads
+    mutable std::mutex _mutex;
+
+    // execution
+    std::array<CommandBufferNull, kMaxCommandBuffers> _command_buffers;
+    std::vector<CommandBufferNull*> _free_command_buffers;
+    ExecutionStatsNull _stats = {};
+    bool _swap_chain = false;
+    bool const _indirect_first_instance;
+
+    // upload buffer. Positions count every byte handed out since creation, so
+    // position % kUploadBufferSize is the offset in the buffer.
+    std::vector<uint8_t> _upload_buffer;
+    uint64_t _upload_head = 0;  ///< Position of the next allocation
+    uint64_t _upload_tail = 0;  ///< No data before this position is in use
+};
+
+/// @brief Creates a Graphics device that does no rendering
+ScopedGraphics create_graphics_null();
+
+}  // namespace ak
+
+#endif  // _AK_GRAPHICS_NULL_H_
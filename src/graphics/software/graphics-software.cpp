@@ -0,0 +1,203 @@
+#include "graphics-software.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <gsl/gsl>
+
+namespace ak {
+
+namespace {
+
+/// Render target clear color, as on the GPU backends: RGBA (0, 0.75, 1, 1)
+constexpr uint32_t kClearColor = 0xffffbf00;
+
+}  // anonymous namespace
+
+GraphicsSoftware::GraphicsSoftware(size_t const num_threads)
+    : _rasterizer(num_threads)
+{
+}
+
+GraphicsSoftware::~GraphicsSoftware() = default;
+
+Graphics::API GraphicsSoftware::api_type() const
+{
+    return kSoftware;
+}
+
+bool GraphicsSoftware::resize(int const width, int const height)
+{
+    if (!GraphicsNull::resize(width, height)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> const lock(_raster_mutex);
+    _rasterizer.resize(width, height);
+    _front_buffer.assign(size_t(width) * size_t(height), kClearColor);
+    return true;
+}
+
+bool GraphicsSoftware::present()
+{
+    if (!GraphicsNull::present()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> const lock(_raster_mutex);
+    _rasterizer.copy_color(&_front_buffer);
+    return true;
+}
+
+void GraphicsSoftware::read_back(std::vector<uint32_t>* const image) const
+{
+    Expects(image);
+    std::lock_guard<std::mutex> const lock(_raster_mutex);
+    *image = _front_buffer;
+}
+
+std::unique_ptr<RenderState> GraphicsSoftware::create_render_state(RenderStateDesc const& desc)
+{
+    // The "bytecode" is the C++ shader itself
+    Expects(desc.vertex_shader.bytecode &&
+            desc.vertex_shader.size == sizeof(SoftwareVertexShader));
+    Expects(desc.pixel_shader.bytecode && desc.pixel_shader.size == sizeof(SoftwarePixelShader));
+    auto state = std::make_unique<RenderStateSoftware>();
+    memcpy(&state->_vertex_shader, desc.vertex_shader.bytecode, sizeof(SoftwareVertexShader));
+    memcpy(&state->_pixel_shader, desc.pixel_shader.bytecode, sizeof(SoftwarePixelShader));
+    Expects(state->_vertex_shader.main && state->_pixel_shader.main);
+    Expects(state->_vertex_shader.varying_count <= kSoftwareMaxVaryings);
+
+    for (auto const* layout = desc.input_layout;
+         layout != nullptr && layout->format != VertexFormat::kUnknown; ++layout) {
+        Expects(layout->slot < kSoftwareMaxAttributes);
+        bool const per_instance = layout->rate == InputRate::kPerInstance;
+        auto& stride = per_instance ? state->_instance_stride : state->_vertex_stride;
+        state->_attribute_formats[layout->slot] = layout->format;
+        state->_attribute_offsets[layout->slot] = stride;
+        state->_attribute_per_instance[layout->slot] = per_instance;
+        stride += vertex_format_size(layout->format);
+    }
+    return state;
+}
+
+void GraphicsSoftware::run_commands(std::vector<CommandNull> const& commands)
+{
+    std::lock_guard<std::mutex> const lock(_raster_mutex);
+    queue_draws(commands);
+    // The constant data may be handed out again once the buffer is executed
+    _rasterizer.flush();
+}
+
+void GraphicsSoftware::queue_draws(std::vector<CommandNull> const& commands)
+{
+    // Nothing bound carries over from or to another command buffer
+    DrawSoftware draw = {};
+    RenderStateSoftware const* state = nullptr;
+    BufferNull const* vertex_buffer = nullptr;
+    BufferNull const* index_buffer = nullptr;
+    uint8_t const* instance_data = nullptr;
+    size_t instance_size = 0;
+    for (auto const& command : commands) {
+        switch (command.type) {
+            case CommandTypeNull::kBeginRenderPass:
+                _rasterizer.clear(kClearColor);
+                break;
+            case CommandTypeNull::kSetVertexConstantData:
+                Expects(command.slot < kSoftwareMaxConstantSlots);
+                draw.vertex_constants[command.slot] = upload_data(command.upload_offset);
+                break;
+            case CommandTypeNull::kSetPixelConstantData:
+                draw.pixel_constants = upload_data(command.upload_offset);
+                break;
+            case CommandTypeNull::kSetRenderState:
+                state = static_cast<RenderStateSoftware const*>(command.object);
+                break;
+            case CommandTypeNull::kSetVertexBuffer:
+                vertex_buffer = static_cast<BufferNull const*>(command.object);
+                break;
+            case CommandTypeNull::kSetIndexBuffer:
+                index_buffer = static_cast<BufferNull const*>(command.object);
+                break;
+            case CommandTypeNull::kSetInstanceData:
+                instance_data = static_cast<uint8_t const*>(upload_data(command.upload_offset));
+                instance_size = command.size;
+                break;
+            case CommandTypeNull::kDraw:
+            case CommandTypeNull::kDrawIndexed:
+            case CommandTypeNull::kDrawIndexedInstanced:
+            case CommandTypeNull::kDrawIndexedIndirect: {
+                Expects(state && vertex_buffer);
+                draw.vertex_shader = state->_vertex_shader;
+                draw.pixel_shader = state->_pixel_shader;
+                std::copy(std::begin(state->_attribute_formats),
+                          std::end(state->_attribute_formats), draw.attribute_formats);
+                std::copy(std::begin(state->_attribute_offsets),
+                          std::end(state->_attribute_offsets), draw.attribute_offsets);
+                std::copy(std::begin(state->_attribute_per_instance),
+                          std::end(state->_attribute_per_instance), draw.attribute_per_instance);
+                draw.vertex_stride = state->_vertex_stride;
+                draw.vertices = vertex_buffer->_data.data();
+                draw.vertex_count =
+                    draw.vertex_stride > 0
+                        ? static_cast<uint32_t>(vertex_buffer->_data.size() / draw.vertex_stride)
+                        : 0;
+                bool const indexed = command.type != CommandTypeNull::kDraw;
+                draw.indices = indexed ? index_buffer->_data.data() : nullptr;
+                draw.index_format = indexed ? index_buffer->_index_format : IndexFormat::kUInt16;
+
+                // Each instance is drawn on its own, reading its element of
+                // the instance data
+                auto const draw_instances = [&](uint32_t const first_instance,
+                                                uint32_t const instance_count) {
+                    size_t const stride = state->_instance_stride;
+                    size_t const end_instance = size_t{first_instance} + instance_count;
+                    Expects(stride == 0 ||
+                            (instance_data && end_instance * stride <= instance_size));
+                    for (size_t ii = first_instance; ii < end_instance; ++ii) {
+                        draw.instance = instance_data + ii * stride;
+                        _rasterizer.draw(draw);
+                    }
+                };
+                if (command.type == CommandTypeNull::kDrawIndexedIndirect) {
+                    // The arguments are read now, as a GPU would read them
+                    auto const* const arguments =
+                        static_cast<uint8_t const*>(upload_data(command.upload_offset));
+                    size_t const index_size = index_format_size(draw.index_format);
+                    for (uint32_t ii = 0; ii < command.count; ++ii) {
+                        DrawIndexedArguments args;
+                        memcpy(&args, arguments + size_t{ii} * command.stride, sizeof(args));
+                        Expects((size_t{args.first_index} + args.index_count) * index_size <=
+                                index_buffer->_data.size());
+                        draw.first = args.first_index;
+                        draw.count = args.index_count;
+                        draw.base_vertex = args.base_vertex;
+                        draw_instances(args.first_instance, args.instance_count);
+                    }
+                    break;
+                }
+                draw.first = command.first_index;
+                draw.count = command.count;
+                draw.base_vertex = command.base_vertex;
+                if (command.type == CommandTypeNull::kDrawIndexedInstanced) {
+                    draw_instances(command.first_instance, command.instance_count);
+                    break;
+                }
+                draw.instance = nullptr;
+                _rasterizer.draw(draw);
+                break;
+            }
+            case CommandTypeNull::kExecuteCommands:
+                queue_draws(static_cast<CommandBufferNull const*>(command.object)->commands());
+                break;
+            case CommandTypeNull::kEndRenderPass:
+            default:
+                break;
+        }
+    }
+}
+
+ScopedGraphics create_graphics_software()
+{
+    return std::make_unique<GraphicsSoftware>();
+}
+
+}  // namespace ak
@@ -0,0 +1,77 @@
+#ifndef _AK_GRAPHICS_SOFTWARE_H_
+#define _AK_GRAPHICS_SOFTWARE_H_
+#include "graphics/graphics.h"
+#include "graphics/software-shader.h"
+
+#include <mutex>
+#include <vector>
+
+#include "null/graphics-null.h"
+#include "rasterizer.h"
+
+namespace ak {
+
+class RenderStateSoftware : public RenderState
+{
+   public:
+    SoftwareVertexShader _vertex_shader = {};
+    SoftwarePixelShader _pixel_shader = {};
+    VertexFormat _attribute_formats[kSoftwareMaxAttributes] = {};
+    uint32_t _attribute_offsets[kSoftwareMaxAttributes] = {};
+    bool _attribute_per_instance[kSoftwareMaxAttributes] = {};
+    uint32_t _vertex_stride = 0;
+    uint32_t _instance_stride = 0;
+};
+
+/// Graphics device that rasterizes on the CPU, for rendering on machines with
+/// no GPU. It records and pools command buffers as GraphicsNull does, and
+/// executing one runs its draws through a Rasterizer. Shaders are C++; see
+/// software-shader.h.
+///
+/// The swap chain is an offscreen image, sized by resize. present copies the
+/// frame drawn since the last present into it, for read_back.
+class GraphicsSoftware : public GraphicsNull
+{
+   public:
+    /// @param[in] num_threads Threads to rasterize on, including the one that
+    ///     calls execute. 0 uses every hardware thread.
+    explicit GraphicsSoftware(size_t num_threads = 0);
+    ~GraphicsSoftware() final;
+
+    API api_type() const final;
+    bool resize(int width, int height) final;
+    bool present() final;
+
+    std::unique_ptr<RenderState> create_render_state(RenderStateDesc const& desc) final;
+
+    /// @brief Copies the last presented frame into `image`, as width() by
+    ///     height() RGBA8 pixels in rows from the top
+    void read_back(std::vector<uint32_t>* image) const;
+    int width() const { return _rasterizer.width(); }
+    int height() const { return _rasterizer.height(); }
+
+    RasterStatsSoftware const& raster_stats() const { return _rasterizer.stats(); }
+
+   private:
+    void run_commands(std::vector<CommandNull> const& commands) final;
+    /// @brief Queues the draws of `commands` on the rasterizer, and those of the
+    ///     render pass buffers they run
+    void queue_draws(std::vector<CommandNull> const& commands);
+
+    //
+    // data members
+    //
+
+    // Command buffers may be recorded on several threads, but only one at a
+    // time is rasterized
+    mutable std::mutex _raster_mutex;
+    Rasterizer _rasterizer;
+    std::vector<uint32_t> _front_buffer;
+};
+
+/// @brief Creates a Graphics device that rasterizes on the CPU
+ScopedGraphics create_graphics_software();
+
+}  // namespace ak
+
+#endif  // _AK_GRAPHICS_SOFTWARE_H_
@@ -0,0 +1,706 @@
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <gsl/gsl>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AK_RASTERIZER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace ak {
+
+/// Setup data of one triangle, for every tile it touches. Attributes are
+/// planes over the screen: value at the pixel (min_x, min_y), then the change
+/// from one pixel to the next along x and along y.
+struct Rasterizer::Triangle
+{
+    int32_t min_x;  ///< Bounds of the pixels whose centers may be covered, inclusive
+    int32_t min_y;
+    int32_t max_x;
+    int32_t max_y;
+    int32_t edge_dx[3];  ///< Change in each edge function from one pixel to the next
+    int32_t edge_dy[3];
+    int64_t edge_c[3];  ///< Edge functions at the center of pixel (0, 0)
+    float depth[3];
+    float inv_w[3];
+    float varyings[kSoftwareMaxVaryings][3];  ///< Each varying divided by w
+    uint32_t draw;
+    /// No wider or taller than a tile, so its edge functions fit in 32 bits
+    /// anywhere in a tile it touches
+    bool small;
+};
+
+/// One thread's share of a batch
+struct Rasterizer::Job
+{
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<uint32_t>> bins;  ///< Triangles touching each tile, in order
+    uint64_t triangles_visible = 0;
+
+    // direct-mapped cache of shaded vertices, emptied for each draw
+    std::vector<uint32_t> cache_tags;
+    std::vector<SoftwareVertex> cache;
+};
+
+constexpr int Rasterizer::kTileSize;
+constexpr int Rasterizer::kMaxSize;
+
+namespace {
+
+/// Triangles each thread sets up per batch, which bounds the memory binning uses
+constexpr uint32_t kTrianglesPerJob = 4096;
+/// Entries in each thread's vertex cache. The meshes are ordered for a small
+/// FIFO cache, so a direct-mapped one of this size hits nearly as often.
+constexpr uint32_t kVertexCacheSize = 256;
+constexpr uint32_t kNoVertex = ~0u;
+
+constexpr int kSubpixelBits = 4;
+constexpr float kSubpixels = 1 << kSubpixelBits;
+/// Triangles are clipped to this many pixels either side of the center of the
+/// render target. With kMaxSize, this keeps the edge functions of a triangle
+/// crossing a tile within 31 bits anywhere in the tile.
+constexpr float kGuardBand = 8192.0f;
+
+/// A clip-space plane, which a position p is inside of where dot(plane, p) >= 0
+struct ClipPlane
+{
+    float x, y, z, w;
+};
+
+/// Most vertices a triangle can have after clipping to six planes
+constexpr uint32_t kMaxClipVertices = 9;
+
+float plane_distance(ClipPlane const& plane, SoftwareVertex const& vertex)
+{
+    float const* const p = vertex.position;
+    return plane.x * p[0] + plane.y * p[1] + plane.z * p[2] + plane.w * p[3];
+}
+
+SoftwareVertex lerp_vertex(SoftwareVertex const& a, SoftwareVertex const& b, float const t,
+                           uint32_t const varying_count)
+{
+    SoftwareVertex vertex;
+    for (int ii = 0; ii < 4; ++ii) {
+        vertex.position[ii] = a.position[ii] + (b.position[ii] - a.position[ii]) * t;
+    }
+    for (uint32_t ii = 0; ii < varying_count; ++ii) {
+        vertex.varyings[ii] = a.varyings[ii] + (b.varyings[ii] - a.varyings[ii]) * t;
+    }
+    return vertex;
+}
+
+/// @brief Clips a convex polygon to a plane (Sutherland-Hodgman)
+/// @return The number of vertices written to `out`
+uint32_t clip_polygon(ClipPlane const& plane, SoftwareVertex const* const in, uint32_t const count,
+                      uint32_t const varying_count, SoftwareVertex* const out)
+{
+    uint32_t out_count = 0;
+    for (uint32_t ii = 0; ii < count; ++ii) {
+        auto const& a = in[ii];
+        auto const& b = in[(ii + 1) % count];
+        float const da = plane_distance(plane, a);
+        float const db = plane_distance(plane, b);
+        if (da >= 0.0f) {
+            out[out_count++] = a;
+        }
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            out[out_count++] = lerp_vertex(a, b, da / (da - db), varying_count);
+        }
+    }
+    return out_count;
+}
+
+/// @brief Reads the attributes of one vertex and runs the vertex shader on it
+void shade_vertex(DrawSoftware const& draw, uint32_t const vertex, SoftwareVertex* const out)
+{
+    Expects(vertex < draw.vertex_count);
+    float attributes[kSoftwareMaxAttributes][4] = {};
+    uint8_t const* const data = draw.vertices + size_t{vertex} * draw.vertex_stride;
+    for (uint32_t slot = 0; slot < kSoftwareMaxAttributes; ++slot) {
+        auto& attribute = attributes[slot];
+        attribute[3] = 1.0f;
+        uint8_t const* const source =
+            (draw.attribute_per_instance[slot] ? draw.instance : data) +
+            draw.attribute_offsets[slot];
+        switch (draw.attribute_formats[slot]) {
+            case VertexFormat::kFloat1:
+            case VertexFormat::kFloat2:
+            case VertexFormat::kFloat3:
+            case VertexFormat::kFloat4:
+                memcpy(attribute, source, vertex_format_size(draw.attribute_formats[slot]));
+                break;
+            case VertexFormat::kSnorm16x2:
+            case VertexFormat::kSnorm16x4: {
+                int16_t components[4];
+                uint32_t const size = vertex_format_size(draw.attribute_formats[slot]);
+                memcpy(components, source, size);
+                for (uint32_t ii = 0; ii < size / sizeof(int16_t); ++ii) {
+                    attribute[ii] = std::max(components[ii] / 32767.0f, -1.0f);
+                }
+                break;
+            }
+            case VertexFormat::kUnknown:
+            default:
+                break;
+        }
+    }
+    draw.vertex_shader.main(draw.vertex_constants, attributes, out);
+}
+
+/// @brief Index `element` of a draw, with the base vertex applied
+uint32_t draw_vertex(DrawSoftware const& draw, uint32_t const element)
+{
+    if (draw.indices == nullptr) {
+        return draw.first + element;
+    }
+    uint32_t const index =
+        draw.index_format == IndexFormat::kUInt32
+            ? static_cast<uint32_t const*>(draw.indices)[draw.first + element]
+            : static_cast<uint16_t const*>(draw.indices)[draw.first + element];
+    return static_cast<uint32_t>(int64_t{index} + draw.base_vertex);
+}
+
+/// @brief Fits a plane through a value at three points
+void setup_plane(float const* const x, float const* const y, float const (&values)[3],
+                 float const inv_area, float const origin_x, float const origin_y,
+                 float* const plane)
+{
+    float const x10 = x[1] - x[0];
+    float const y10 = y[1] - y[0];
+    float const x20 = x[2] - x[0];
+    float const y20 = y[2] - y[0];
+    float const v10 = values[1] - values[0];
+    float const v20 = values[2] - values[0];
+    float const dx = (v10 * y20 - v20 * y10) * inv_area;
+    float const dy = (v20 * x10 - v10 * x20) * inv_area;
+    // Pixels are sampled at their centers
+    plane[0] = values[0] + dx * (origin_x + 0.5f - x[0]) + dy * (origin_y + 0.5f - y[0]);
+    plane[1] = dx;
+    plane[2] = dy;
+}
+
+#if defined(AK_RASTERIZER_SSE2)
+/// All bits set in the lanes whose bit is set in the index
+alignas(16) int32_t const kLaneMasks[16][4] = {
+    {0, 0, 0, 0},   {-1, 0, 0, 0},   {0, -1, 0, 0},   {-1, -1, 0, 0},
+    {0, 0, -1, 0},  {-1, 0, -1, 0},  {0, -1, -1, 0},  {-1, -1, -1, 0},
+    {0, 0, 0, -1},  {-1, 0, 0, -1},  {0, -1, 0, -1},  {-1, -1, 0, -1},
+    {0, 0, -1, -1}, {-1, 0, -1, -1}, {0, -1, -1, -1}, {-1, -1, -1, -1},
+};
+#endif
+
+uint32_t pack_rgba8(float const* const color)
+{
+    uint32_t packed = 0;
+    for (uint32_t ii = 0; ii < 4; ++ii) {
+        float const value = std::min(std::max(color[ii], 0.0f), 1.0f);
+        packed |= static_cast<uint32_t>(value * 255.0f + 0.5f) << (ii * 8);
+    }
+    return packed;
+}
+
+}  // anonymous namespace
+
+Rasterizer::Rasterizer(size_t num_threads)
+{
+    if (num_threads == 0) {
+        num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    for (size_t ii = 0; ii < num_threads; ++ii) {
+        auto job = std::make_unique<Job>();
+        job->triangles.reserve(kTrianglesPerJob);
+        job->cache_tags.resize(kVertexCacheSize);
+        job->cache.resize(kVertexCacheSize);
+        _jobs.push_back(std::move(job));
+    }
+    for (size_t ii = 1; ii < num_threads; ++ii) {
+        _threads.emplace_back(&Rasterizer::worker_main, this);
+    }
+}
+
+Rasterizer::~Rasterizer()
+{
+    {
+        std::lock_guard<std::mutex> const lock(_mutex);
+        _shutdown = true;
+    }
+    _wake.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void Rasterizer::resize(int const width, int const height)
+{
+    Expects(width >= 0 && height >= 0 && width <= kMaxSize && height <= kMaxSize);
+    flush();
+    _width = width;
+    _height = height;
+    _tiles_x = (width + kTileSize - 1) / kTileSize;
+    _tiles_y = (height + kTileSize - 1) / kTileSize;
+    _stride = _tiles_x * kTileSize;
+    size_t const pixels = size_t(_stride) * size_t(_tiles_y * kTileSize);
+    _color.assign(pixels, _clear_color);
+    _depth.assign(pixels, 0.0f);
+    for (auto& job : _jobs) {
+        job->bins.resize(size_t(_tiles_x) * size_t(_tiles_y));
+    }
+}
+
+void Rasterizer::clear(uint32_t const color)
+{
+    flush();
+    _clear_color = color;
+    parallel_for(size_t(_tiles_x) * size_t(_tiles_y),
+                 [this](size_t const tile) { clear_tile(tile); });
+}
+
+void Rasterizer::draw(DrawSoftware const& draw)
+{
+    uint32_t const triangle_count = draw.count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+    _stats.triangles += triangle_count;
+    if (_width == 0 || _height == 0) {
+        return;
+    }
+
+    // Split the draw across batches when it does not fit in one
+    uint32_t const capacity = kTrianglesPerJob * static_cast<uint32_t>(_jobs.size());
+    _draws.push_back(draw);
+    for (uint32_t first = 0; first < triangle_count;) {
+        if (_queued_triangles == capacity) {
+            flush();
+            _draws.push_back(draw);
+        }
+        uint32_t const count = std::min(capacity - _queued_triangles, triangle_count - first);
+        _segments.push_back({static_cast<uint32_t>(_draws.size() - 1), first, count});
+        _queued_triangles += count;
+        first += count;
+    }
+}
+
+void Rasterizer::flush()
+{
+    if (_queued_triangles > 0) {
+        auto const start = std::chrono::high_resolution_clock::now();
+
+        // Geometry: each thread sets up and bins an equal run of triangles
+        size_t const job_count = _jobs.size();
+        uint32_t const total = _queued_triangles;
+        uint32_t const per_job = (total + static_cast<uint32_t>(job_count) - 1) /
+                                 static_cast<uint32_t>(job_count);
+        parallel_for(job_count, [&](size_t const job) {
+            uint32_t const begin = std::min(static_cast<uint32_t>(job) * per_job, total);
+            setup_triangles(_jobs[job].get(), begin, std::min(begin + per_job, total));
+        });
+
+        // Rasterization: each thread draws whole tiles
+        _shaded_pixels = 0;
+        parallel_for(size_t(_tiles_x) * size_t(_tiles_y),
+                     [this](size_t const tile) { rasterize_tile(tile); });
+
+        for (auto const& job : _jobs) {
+            _stats.triangles_visible += job->triangles_visible;
+        }
+        _stats.pixels += _shaded_pixels;
+        _stats.seconds += std::chrono::duration<double>(
+                              std::chrono::high_resolution_clock::now() - start)
+                              .count();
+    }
+    _draws.clear();
+    _segments.clear();
+    _queued_triangles = 0;
+}
+
+void Rasterizer::copy_color(std::vector<uint32_t>* const image)
+{
+    flush();
+    image->resize(size_t(_width) * size_t(_height));
+    for (int y = 0; y < _height; ++y) {
+        std::copy_n(_color.data() + size_t(y) * size_t(_stride), _width,
+                    image->data() + size_t(y) * size_t(_width));
+    }
+}
+
+void Rasterizer::setup_triangles(Job* const job, uint32_t const first_triangle,
+                                 uint32_t const end_triangle)
+{
+    job->triangles.clear();
+    for (auto& bin : job->bins) {
+        bin.clear();
+    }
+    job->triangles_visible = 0;
+
+    float const half_width = static_cast<float>(_width) * 0.5f;
+    float const half_height = static_cast<float>(_height) * 0.5f;
+    // Guard band, then near and far. Only the near plane is needed for the
+    // divide by w; the rest keep the fixed point coordinates in range.
+    float const guard_x = kGuardBand / half_width;
+    float const guard_y = kGuardBand / half_height;
+    ClipPlane const clip_planes[] = {
+        {1.0f, 0.0f, 0.0f, guard_x}, {-1.0f, 0.0f, 0.0f, guard_x}, {0.0f, 1.0f, 0.0f, guard_y},
+        {0.0f, -1.0f, 0.0f, guard_y}, {0.0f, 0.0f, -1.0f, 1.0f},   {0.0f, 0.0f, 1.0f, 0.0f},
+    };
+
+    auto const setup = [&](DrawSoftware const& draw, uint32_t const draw_index,
+                           SoftwareVertex const& v0, SoftwareVertex const& v1,
+                           SoftwareVertex const& v2) {
+        SoftwareVertex const* vertices[] = {&v0, &v1, &v2};
+        float inv_w[3];
+        int32_t fixed_x[3];
+        int32_t fixed_y[3];
+        for (int ii = 0; ii < 3; ++ii) {
+            float const* const position = vertices[ii]->position;
+            inv_w[ii] = 1.0f / position[3];
+            float const x = half_width + position[0] * inv_w[ii] * half_width;
+            float const y = half_height - position[1] * inv_w[ii] * half_height;
+            fixed_x[ii] = static_cast<int32_t>(std::lrint(x * kSubpixels));
+            fixed_y[ii] = static_cast<int32_t>(std::lrint(y * kSubpixels));
+        }
+
+        // Clockwise on screen, with y down, is the front and has a positive area
+        int64_t const area =
+            int64_t{fixed_x[1] - fixed_x[0]} * int64_t{fixed_y[2] - fixed_y[0]} -
+            int64_t{fixed_x[2] - fixed_x[0]} * int64_t{fixed_y[1] - fixed_y[0]};
+        if (area <= 0) {
+            return;
+        }
+
+        // Pixels whose centers lie within the triangle's bounds
+        int32_t constexpr half = 1 << (kSubpixelBits - 1);
+        int32_t constexpr round_up = (1 << kSubpixelBits) - 1;
+        auto const min_fixed_x = std::min({fixed_x[0], fixed_x[1], fixed_x[2]});
+        auto const min_fixed_y = std::min({fixed_y[0], fixed_y[1], fixed_y[2]});
+        auto const max_fixed_x = std::max({fixed_x[0], fixed_x[1], fixed_x[2]});
+        auto const max_fixed_y = std::max({fixed_y[0], fixed_y[1], fixed_y[2]});
+        Triangle triangle;
+        triangle.min_x = std::max((min_fixed_x - half + round_up) >> kSubpixelBits, 0);
+        triangle.min_y = std::max((min_fixed_y - half + round_up) >> kSubpixelBits, 0);
+        triangle.max_x = std::min((max_fixed_x - half) >> kSubpixelBits, _width - 1);
+        triangle.max_y = std::min((max_fixed_y - half) >> kSubpixelBits, _height - 1);
+        if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y) {
+            return;
+        }
+        int32_t constexpr tile_extent = kTileSize << kSubpixelBits;
+        triangle.small = max_fixed_x - min_fixed_x <= tile_extent &&
+                         max_fixed_y - min_fixed_y <= tile_extent;
+
+        // Edge function of edge a -> b: positive inside, and zero on the edge
+        // only where the top-left rule puts its pixels inside
+        for (int ii = 0; ii < 3; ++ii) {
+            int const a = ii;
+            int const b = (ii + 1) % 3;
+            int64_t const dx = int64_t{fixed_y[a]} - fixed_y[b];
+            int64_t const dy = int64_t{fixed_x[b]} - fixed_x[a];
+            bool const top_left = dx > 0 || (dx == 0 && dy > 0);
+            int64_t const c = -(dx * fixed_x[a] + dy * fixed_y[a]) - (top_left ? 0 : 1);
+            triangle.edge_dx[ii] = static_cast<int32_t>(dx << kSubpixelBits);
+            triangle.edge_dy[ii] = static_cast<int32_t>(dy << kSubpixelBits);
+            triangle.edge_c[ii] = c + (dx + dy) * half;
+        }
+
+        float x[3];
+        float y[3];
+        for (int ii = 0; ii < 3; ++ii) {
+            x[ii] = static_cast<float>(fixed_x[ii]) / kSubpixels;
+            y[ii] = static_cast<float>(fixed_y[ii]) / kSubpixels;
+        }
+        float const inv_area = (kSubpixels * kSubpixels) / static_cast<float>(area);
+        float const origin_x = static_cast<float>(triangle.min_x);
+        float const origin_y = static_cast<float>(triangle.min_y);
+        float const depth[] = {
+            v0.position[2] * inv_w[0], v1.position[2] * inv_w[1], v2.position[2] * inv_w[2],
+        };
+        setup_plane(x, y, depth, inv_area, origin_x, origin_y, triangle.depth);
+        setup_plane(x, y, inv_w, inv_area, origin_x, origin_y, triangle.inv_w);
+        for (uint32_t ii = 0; ii < draw.vertex_shader.varying_count; ++ii) {
+            float const values[] = {
+                v0.varyings[ii] * inv_w[0], v1.varyings[ii] * inv_w[1],
+                v2.varyings[ii] * inv_w[2],
+            };
+            setup_plane(x, y, values, inv_area, origin_x, origin_y, triangle.varyings[ii]);
+        }
+        triangle.draw = draw_index;
+
+        auto const index = static_cast<uint32_t>(job->triangles.size());
+        job->triangles.push_back(triangle);
+        ++job->triangles_visible;
+        for (int ty = triangle.min_y / kTileSize; ty <= triangle.max_y / kTileSize; ++ty) {
+            for (int tx = triangle.min_x / kTileSize; tx <= triangle.max_x / kTileSize; ++tx) {
+                job->bins[size_t(ty) * size_t(_tiles_x) + size_t(tx)].push_back(index);
+            }
+        }
+    };
+
+    // The segments of the batch that overlap this job's run of triangles
+    uint32_t segment_start = 0;
+    for (auto const& segment : _segments) {
+        uint32_t const begin = std::max(segment_start, first_triangle);
+        uint32_t const end = std::min(segment_start + segment.triangle_count, end_triangle);
+        uint32_t const first = segment.first_triangle + (begin - segment_start);
+        segment_start += segment.triangle_count;
+        if (begin >= end) {
+            continue;
+        }
+        auto const& draw = _draws[segment.draw];
+        std::fill(job->cache_tags.begin(), job->cache_tags.end(), kNoVertex);
+        for (uint32_t triangle = first; triangle < first + (end - begin); ++triangle) {
+            SoftwareVertex vertices[3];
+            for (uint32_t ii = 0; ii < 3; ++ii) {
+                uint32_t const vertex = draw_vertex(draw, triangle * 3 + ii);
+                uint32_t const slot = vertex % kVertexCacheSize;
+                if (job->cache_tags[slot] != vertex) {
+                    shade_vertex(draw, vertex, &job->cache[slot]);
+                    job->cache_tags[slot] = vertex;
+                }
+                vertices[ii] = job->cache[slot];
+            }
+
+            // Skip triangles wholly outside one side of the view volume
+            uint32_t outside_all = ~0u;
+            bool needs_clip = false;
+            for (auto const& vertex : vertices) {
+                float const x = vertex.position[0];
+                float const y = vertex.position[1];
+                float const z = vertex.position[2];
+                float const w = vertex.position[3];
+                outside_all &= (x > w ? 1u : 0u) | (x < -w ? 2u : 0u) | (y > w ? 4u : 0u) |
+                               (y < -w ? 8u : 0u) | (z > w ? 16u : 0u) | (z < 0.0f ? 32u : 0u);
+                needs_clip |= std::abs(x) > guard_x * w || std::abs(y) > guard_y * w ||
+                              z > w || z < 0.0f;
+            }
+            if (outside_all != 0) {
+                continue;
+            }
+            if (!needs_clip) {
+                setup(draw, segment.draw, vertices[0], vertices[1], vertices[2]);
+                continue;
+            }
+
+            SoftwareVertex polygon[2][kMaxClipVertices];
+            std::copy_n(vertices, 3, polygon[0]);
+            uint32_t count = 3;
+            int current = 0;
+            for (auto const& plane : clip_planes) {
+                count = clip_polygon(plane, polygon[current], count,
+                                     draw.vertex_shader.varying_count, polygon[1 - current]);
+                current = 1 - current;
+            }
+            for (uint32_t ii = 2; ii < count; ++ii) {
+                setup(draw, segment.draw, polygon[current][0], polygon[current][ii - 1],
+                      polygon[current][ii]);
+            }
+        }
+    }
+}
+
+void Rasterizer::rasterize_tile(size_t const tile)
+{
+    int const tile_x = static_cast<int>(tile % size_t(_tiles_x)) * kTileSize;
+    int const tile_y = static_cast<int>(tile / size_t(_tiles_x)) * kTileSize;
+    int const tile_end_x = std::min(tile_x + kTileSize, _width) - 1;
+    int const tile_end_y = std::min(tile_y + kTileSize, _height) - 1;
+    uint64_t pixels = 0;
+
+    for (auto const& job : _jobs) {
+        for (auto const index : job->bins[tile]) {
+            auto const& triangle = job->triangles[index];
+            auto const& draw = _draws[triangle.draw];
+            // Runs the pixel shader for a covered pixel that passed the depth test
+            auto const shade = [&](int const x, int const y) {
+                float const dx = static_cast<float>(x - triangle.min_x);
+                float const dy = static_cast<float>(y - triangle.min_y);
+                auto const& inv_w = triangle.inv_w;
+                float const w = 1.0f / (inv_w[0] + inv_w[1] * dx + inv_w[2] * dy);
+                float varyings[kSoftwareMaxVaryings];
+                for (uint32_t ii = 0; ii < draw.vertex_shader.varying_count; ++ii) {
+                    auto const& plane = triangle.varyings[ii];
+                    varyings[ii] = (plane[0] + plane[1] * dx + plane[2] * dy) * w;
+                }
+                float rgba[4] = {};
+                draw.pixel_shader.main(draw.pixel_constants, varyings, rgba);
+                return pack_rgba8(rgba);
+            };
+            int const x0 = std::max(tile_x, triangle.min_x);
+            int const y0 = std::max(tile_y, triangle.min_y);
+            int const x1 = std::min(tile_end_x, triangle.max_x);
+            int const y1 = std::min(tile_end_y, triangle.max_y);
+            // Blocks of four pixels start on multiples of four
+            int const block_x0 = x0 & ~3;
+
+            // Of a larger triangle, edges the whole rectangle is inside of are
+            // skipped by stepping them from 0 by 0. The others cross it, so
+            // their values within the tile fit in 32 bits.
+            int32_t start[3];
+            int32_t step_x[3];
+            int32_t step_y[3];
+            bool outside = false;
+            for (int ii = 0; ii < 3; ++ii) {
+                auto const edge = [&](int const x, int const y) {
+                    return triangle.edge_c[ii] + int64_t{triangle.edge_dx[ii]} * x +
+                           int64_t{triangle.edge_dy[ii]} * y;
+                };
+                bool inside = false;
+                if (!triangle.small) {
+                    int64_t const corners[] = {edge(x0, y0), edge(x1, y0), edge(x0, y1),
+                                               edge(x1, y1)};
+                    auto const minmax = std::minmax_element(std::begin(corners), std::end(corners));
+                    outside |= *minmax.second < 0;
+                    inside = *minmax.first >= 0;
+                }
+                start[ii] = inside ? 0 : static_cast<int32_t>(edge(block_x0, y0));
+                step_x[ii] = inside ? 0 : triangle.edge_dx[ii];
+                step_y[ii] = inside ? 0 : triangle.edge_dy[ii];
+            }
+            if (outside) {
+                continue;
+            }
+
+            float const depth_dx = triangle.depth[1];
+            float const depth_start = triangle.depth[0] +
+                                      depth_dx * static_cast<float>(block_x0 - triangle.min_x) +
+                                      triangle.depth[2] * static_cast<float>(y0 - triangle.min_y);
+#if defined(AK_RASTERIZER_SSE2)
+            __m128i edge_row[3];
+            __m128i edge_step_x[3];
+            for (int ii = 0; ii < 3; ++ii) {
+                int32_t const step = step_x[ii];
+                edge_row[ii] = _mm_setr_epi32(start[ii], start[ii] + step, start[ii] + 2 * step,
+                                              start[ii] + 3 * step);
+                edge_step_x[ii] = _mm_set1_epi32(4 * step);
+            }
+            __m128 const depth_lanes =
+                _mm_setr_ps(0.0f, depth_dx, 2.0f * depth_dx, 3.0f * depth_dx);
+            __m128 const depth_step_x = _mm_set1_ps(4.0f * depth_dx);
+#endif
+            for (int y = y0; y <= y1; ++y) {
+                int const row = y - y0;
+                float const depth_row = depth_start + triangle.depth[2] * static_cast<float>(row);
+                uint32_t* const color = _color.data() + size_t(y) * size_t(_stride);
+                float* const depth = _depth.data() + size_t(y) * size_t(_stride);
+#if defined(AK_RASTERIZER_SSE2)
+                __m128i e0 = edge_row[0];
+                __m128i e1 = edge_row[1];
+                __m128i e2 = edge_row[2];
+                __m128 z = _mm_add_ps(_mm_set1_ps(depth_row), depth_lanes);
+                for (int x = block_x0; x <= x1; x += 4) {
+                    // a lane is outside where any edge function is negative
+                    __m128i const signs = _mm_or_si128(e0, _mm_or_si128(e1, e2));
+                    int covered = ~_mm_movemask_ps(_mm_castsi128_ps(signs)) & 0xf;
+                    // only the pixels in [x0, x1]
+                    covered &= (0xf << std::max(x0 - x, 0)) & (0xf >> std::max(x + 3 - x1, 0));
+                    if (covered != 0) {
+                        __m128 const old_depth = _mm_loadu_ps(depth + x);
+                        int const passed = covered & _mm_movemask_ps(_mm_cmpgt_ps(z, old_depth));
+                        if (passed != 0) {
+                            __m128 const mask = _mm_castsi128_ps(_mm_load_si128(
+                                reinterpret_cast<__m128i const*>(kLaneMasks[passed])));
+                            _mm_storeu_ps(depth + x, _mm_or_ps(_mm_and_ps(mask, z),
+                                                               _mm_andnot_ps(mask, old_depth)));
+                            for (int lane = 0; lane < 4; ++lane) {
+                                if ((passed & (1 << lane)) != 0) {
+                                    color[x + lane] = shade(x + lane, y);
+                                    ++pixels;
+                                }
+                            }
+                        }
+                    }
+                    e0 = _mm_add_epi32(e0, edge_step_x[0]);
+                    e1 = _mm_add_epi32(e1, edge_step_x[1]);
+                    e2 = _mm_add_epi32(e2, edge_step_x[2]);
+                    z = _mm_add_ps(z, depth_step_x);
+                }
+                for (int ii = 0; ii < 3; ++ii) {
+                    edge_row[ii] = _mm_add_epi32(edge_row[ii], _mm_set1_epi32(step_y[ii]));
+                }
+#else
+                int32_t edges[3];
+                for (int ii = 0; ii < 3; ++ii) {
+                    edges[ii] = start[ii] + step_y[ii] * row + step_x[ii] * (x0 - block_x0);
+                }
+                float z = depth_row + depth_dx * static_cast<float>(x0 - block_x0);
+                for (int x = x0; x <= x1; ++x) {
+                    if ((edges[0] | edges[1] | edges[2]) >= 0 && z > depth[x]) {
+                        depth[x] = z;
+                        color[x] = shade(x, y);
+                        ++pixels;
+                    }
+                    for (int ii = 0; ii < 3; ++ii) {
+                        edges[ii] += step_x[ii];
+                    }
+                    z += depth_dx;
+                }
+#endif
+            }
+        }
+    }
+    _shaded_pixels += pixels;
+}
+
+void Rasterizer::clear_tile(size_t const tile)
+{
+    size_t const x = tile % size_t(_tiles_x) * kTileSize;
+    size_t const y = tile / size_t(_tiles_x) * kTileSize;
+    for (size_t row = y; row < y + kTileSize; ++row) {
+        size_t const offset = row * size_t(_stride) + x;
+        std::fill_n(_color.data() + offset, kTileSize, _clear_color);
+        std::fill_n(_depth.data() + offset, kTileSize, 0.0f);
+    }
+}
+
+void Rasterizer::parallel_for(size_t const count, std::function<void(size_t item)> const& func)
+{
+    if (_threads.empty() || count <= 1) {
+        for (size_t item = 0; item < count; ++item) {
+            func(item);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> const lock(_mutex);
+        _func = &func;
+        _item_count = count;
+        _next_item = 0;
+        _busy_threads = _threads.size();
+        ++_generation;
+    }
+    _wake.notify_all();
+
+    for (size_t item = _next_item++; item < count; item = _next_item++) {
+        func(item);
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _busy_threads == 0; });
+    _func = nullptr;
+}
+
+void Rasterizer::worker_main()
+{
+    uint64_t generation = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _wake.wait(lock, [&] { return _shutdown || _generation != generation; });
+        if (_shutdown) {
+            return;
+        }
+        generation = _generation;
+        auto const& func = *_func;
+        size_t const count = _item_count;
+        lock.unlock();
+        for (size_t item = _next_item++; item < count; item = _next_item++) {
+            func(item);
+        }
+        lock.lock();
+        if (--_busy_threads == 0) {
+            _done.notify_one();
+        }
+    }
+}
+
+}  // namespace ak
@@ -0,0 +1,151 @@
+#ifndef _AK_RASTERIZER_H_
+#define _AK_RASTERIZER_H_
+#include "graphics/graphics.h"
+#include "graphics/software-shader.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ak {
+
+/// Everything a draw call reads. The pointers must stay valid until the
+/// rasterizer is flushed.
+struct DrawSoftware
+{
+    SoftwareVertexShader vertex_shader;
+    SoftwarePixelShader pixel_shader;
+    VertexFormat attribute_formats[kSoftwareMaxAttributes];  ///< kUnknown where unused
+    /// Offset in the vertex, or in the instance for per-instance attributes
+    uint32_t attribute_offsets[kSoftwareMaxAttributes];
+    bool attribute_per_instance[kSoftwareMaxAttributes];
+    uint32_t vertex_stride;
+    uint8_t const* vertices;
+    uint32_t vertex_count;
+    uint8_t const* instance;  ///< Per-instance attributes of the one instance drawn
+    void const* indices;  ///< nullptr for a non-indexed draw
+    IndexFormat index_format;
+    uint32_t first;  ///< First index, or first vertex of a non-indexed draw
+    uint32_t count;  ///< Indices or vertices drawn
+    int32_t base_vertex;
+    void const* vertex_constants[kSoftwareMaxConstantSlots];
+    void const* pixel_constants;
+};
+
+/// Totals over every draw a Rasterizer has run
+struct RasterStatsSoftware
+{
+    uint64_t triangles;          ///< Triangles drawn
+    uint64_t triangles_visible;  ///< Triangles left after clipping and culling
+    uint64_t pixels;             ///< Pixels that passed the depth test and were shaded
+    double seconds;              ///< Time spent running draws
+};
+
+/// Tile-based, multi-threaded triangle rasterizer.
+///
+/// Draws are queued into batches. A batch is split into one contiguous run of
+/// triangles per thread; each thread shades the vertices of its run, clips and
+/// culls its triangles, sets them up and bins them into the screen tiles they
+/// touch. The tiles are then rasterized in parallel, each by one thread, which
+/// takes the bins of the runs in order so triangles land in draw order.
+///
+/// Triangles are back-face culled, clockwise on screen being the front as on
+/// the GPU backends, and depth tested with a reversed depth buffer: depth is
+/// cleared to 0 and a pixel is drawn where its depth is greater. Coverage uses
+/// 4 bits of subpixel precision and the top-left fill rule; edge functions are
+/// evaluated four pixels at a time.
+class Rasterizer
+{
+   public:
+    static constexpr int kTileSize = 64;  ///< Pixels along each side of a tile
+    /// Largest width and height of the render target
+    static constexpr int kMaxSize = 8192;
+
+    /// @brief Creates a rasterizer using `num_threads` threads in total,
+    ///     including the calling thread. 0 uses every hardware thread.
+    explicit Rasterizer(size_t num_threads = 0);
+    ~Rasterizer();
+
+    Rasterizer(Rasterizer const&) = delete;
+    Rasterizer& operator=(Rasterizer const&) = delete;
+
+    /// @brief Reallocates the render target, after running the queued draws
+    void resize(int width, int height);
+    int width() const { return _width; }
+    int height() const { return _height; }
+
+    /// @brief Clears color, to an RGBA8 value, and depth, after running the
+    ///     queued draws
+    void clear(uint32_t color);
+    void draw(DrawSoftware const& draw);
+    /// @brief Runs the queued draws
+    void flush();
+
+    /// @brief Copies the render target's color into `image`, as `width` by
+    ///     `height` RGBA8 pixels in rows from the top, after running the queued
+    ///     draws
+    void copy_color(std::vector<uint32_t>* image);
+
+    size_t num_threads() const { return _threads.size() + 1; }
+    RasterStatsSoftware const& stats() const { return _stats; }
+
+   private:
+    struct Triangle;
+    struct Job;
+    struct Segment
+    {
+        uint32_t draw;
+        uint32_t first_triangle;
+        uint32_t triangle_count;
+    };
+
+    /// @brief Calls `func(item)` for every item in [0, count) across all threads
+    void parallel_for(size_t count, std::function<void(size_t item)> const& func);
+    void worker_main();
+
+    void setup_triangles(Job* job, uint32_t first_triangle, uint32_t end_triangle);
+    void rasterize_tile(size_t tile);
+    void clear_tile(size_t tile);
+
+    //
+    // data members
+    //
+
+    int _width = 0;
+    int _height = 0;
+    int _stride = 0;  ///< Pixels between rows: the width, rounded up to whole tiles
+    int _tiles_x = 0;
+    int _tiles_y = 0;
+    std::vector<uint32_t> _color;
+    std::vector<float> _depth;
+    uint32_t _clear_color = 0;
+
+    // queued draws
+    std::vector<DrawSoftware> _draws;
+    std::vector<Segment> _segments;
+    uint32_t _queued_triangles = 0;
+    std::vector<std::unique_ptr<Job>> _jobs;  ///< One per thread
+    RasterStatsSoftware _stats = {};
+    std::atomic<uint64_t> _shaded_pixels{0};  ///< by the tiles of the current batch
+
+    // threads
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::function<void(size_t item)> const* _func = nullptr;
+    size_t _item_count = 0;
+    std::atomic<size_t> _next_item{0};
+    size_t _busy_threads = 0;
+    uint64_t _generation = 0;
+    bool _shutdown = false;
+};
+
+}  // namespace ak
+
+#endif  // _AK_RASTERIZER_H_
@@ -1,22 +1,94 @@
 #include "command-buffer-vulkan.h"
 #include "graphics-vulkan.h"
 
+#include <algorithm>
+#include <cstring>
 #include <gsl/gsl>
 
 namespace ak {
 
+constexpr size_t CommandBufferVulkan::kUploadBlockSize;
+constexpr uint64_t CommandBufferVulkan::kNotSubmitted;
+
 void CommandBufferVulkan::reset()
 {
-    VkResult result = _graphics->vkResetFences(_graphics->_device, 1, &_fence);
-    assert(VK_SUCCEEDED(result) && "Could not reset fence");
+    VkResult result = VK_SUCCESS;
+    if (!_render_pass_only) {
+        result = _graphics->vkResetFences(_graphics->_device, 1, &_fence);
+        assert(VK_SUCCEEDED(result) && "Could not reset fence");
+    }
+    _executed_buffers.clear();
     result = _graphics->vkResetCommandPool(_graphics->_device, _pool, 0);
     assert(VK_SUCCEEDED(result) && "Could not reset pool");
     result = _graphics->vkResetCommandBuffer(_buffer, 0);
     assert(VK_SUCCEEDED(result) && "Could not reset buffer");
+    _upload_block = nullptr;
+    _upload_block_end = nullptr;
     _open = false;
 }
 
 bool CommandBufferVulkan::begin_render_pass()
+{
+    Expects(!_render_pass_only);
+    if (!begin_render_pass(VK_SUBPASS_CONTENTS_INLINE)) {
+        return false;
+    }
+    set_viewport();
+    return true;
+}
+
+bool CommandBufferVulkan::execute_render_pass(CommandBuffer* const* const command_buffers,
+                                              size_t const count)
+{
+    Expects(!_render_pass_only && (count == 0 || command_buffers));
+    _render_pass_buffers.clear();
+    for (size_t ii = 0; ii < count; ++ii) {
+        auto* const buffer = static_cast<CommandBufferVulkan*>(command_buffers[ii]);
+        Expects(buffer && buffer->_render_pass_only && buffer->_open);
+        VkResult const result = _graphics->vkEndCommandBuffer(buffer->_buffer);
+        assert(VK_SUCCEEDED(result) && "Could not end command buffer");
+        // It can be recorded again once this buffer is done on the GPU
+        _executed_buffers.push_back(buffer);
+        buffer->_open = false;
+        _render_pass_buffers.push_back(buffer->_buffer);
+    }
+    // A pass run from secondary buffers can hold nothing else
+    if (!begin_render_pass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)) {
+        return false;
+    }
+    if (!_render_pass_buffers.empty()) {
+        _graphics->vkCmdExecuteCommands(_buffer,
+                                        static_cast<uint32_t>(_render_pass_buffers.size()),
+                                        _render_pass_buffers.data());
+    }
+    end_render_pass();
+    return true;
+}
+
+void* CommandBufferVulkan::get_upload_data(size_t const size, size_t const alignment)
+{
+    Expects(_open);
+    Expects(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    auto const aligned = (reinterpret_cast<uintptr_t>(_upload_block) + alignment - 1) &
+                         ~uintptr_t(alignment - 1);
+    if (_upload_block == nullptr || aligned + size > uintptr_t(_upload_block_end)) {
+        // The device's allocations start aligned to at least `alignment`.
+        // Data larger than a block gets a block to itself.
+        size_t const block_size = std::max(size, kUploadBlockSize);
+        auto* const block =
+            static_cast<uint8_t*>(_graphics->get_upload_data(block_size, alignment));
+        if (block == nullptr) {
+            return nullptr;
+        }
+        _upload_block = block + size;
+        _upload_block_end = block + block_size;
+        return block;
+    }
+    _upload_block = reinterpret_cast<uint8_t*>(aligned + size);
+    return reinterpret_cast<uint8_t*>(aligned);
+}
+
+bool CommandBufferVulkan::begin_render_pass(VkSubpassContents const contents)
 {
     if (_graphics->_swap_chain == VK_NULL_HANDLE) {
         return false;
@@ -45,8 +117,14 @@ bool CommandBufferVulkan::begin_render_pass()
         num_clear_values,  // clearValueCount
         clear_values,      // pClearValues
     };
-    _graphics->vkCmdBeginRenderPass(_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    _graphics->vkCmdBeginRenderPass(_buffer, &render_pass_begin_info, contents);
+    return true;
+}
 
+void CommandBufferVulkan::set_viewport()
+{
+    // Dynamic state, which secondary buffers do not inherit
+    auto const extent = _graphics->_surface_capabilities.currentExtent;
     VkRect2D const scissor = {
         {0, 0},  // offset
         extent,  // extent
@@ -57,8 +135,6 @@ bool CommandBufferVulkan::begin_render_pass()
         0, 0, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f,
     };
     _graphics->vkCmdSetViewport(_buffer, 0, 1, &viewport);
-
-    return true;
 }
 
 void CommandBufferVulkan::set_vertex_constant_data(uint32_t slot, void const* const upload_data,
@@ -145,7 +221,17 @@ void CommandBufferVulkan::set_index_buffer(Buffer* const buffer)
     }
     auto* const vulkan_buffer = static_cast<BufferVulkan*>(buffer);
     VkDeviceSize const offset = 0;
-    _graphics->vkCmdBindIndexBuffer(_buffer, vulkan_buffer->_buffer, 0, VK_INDEX_TYPE_UINT16);
+    _graphics->vkCmdBindIndexBuffer(_buffer, vulkan_buffer->_buffer, offset,
+                                    vulkan_buffer->_index_type);
+}
+
+void CommandBufferVulkan::set_instance_data(void const* const upload_data, size_t /*size*/)
+{
+    // The upload buffer doubles as the vertex buffer of binding 1
+    VkDeviceSize const offset = static_cast<VkDeviceSize>(
+        static_cast<uint8_t const*>(upload_data) - _graphics->_upload_start);
+    _graphics->vkCmdBindVertexBuffers(_buffer, 1, 1, &_graphics->_upload_buffer->_buffer,
+                                      &offset);
 }
 
 void CommandBufferVulkan::draw(uint32_t const vertex_count)
@@ -153,9 +239,49 @@ void CommandBufferVulkan::draw(uint32_t const vertex_count)
     _graphics->vkCmdDraw(_buffer, vertex_count, 1, 0, 0);
 }
 
-void CommandBufferVulkan::draw_indexed(uint32_t const index_count)
+void CommandBufferVulkan::draw_indexed(uint32_t const index_count, uint32_t const first_index,
+                                       int32_t const base_vertex)
+{
+    _graphics->vkCmdDrawIndexed(_buffer, index_count, 1, first_index, base_vertex, 0);
+}
+
+void CommandBufferVulkan::draw_indexed_instanced(uint32_t const index_count,
+                                                 uint32_t const instance_count,
+                                                 uint32_t const first_index,
+                                                 int32_t const base_vertex,
+                                                 uint32_t const first_instance)
+{
+    _graphics->vkCmdDrawIndexed(_buffer, index_count, instance_count, first_index, base_vertex,
+                                first_instance);
+}
+
+void CommandBufferVulkan::draw_indexed_indirect(void const* const upload_data,
+                                                uint32_t const draw_count, uint32_t const stride)
 {
-    _graphics->vkCmdDrawIndexed(_buffer, index_count, 1, 0, 0, 0);
+    if (!_graphics->_draw_indirect_first_instance) {
+        // Indirect draws have to start at instance 0 without the feature. The
+        // arguments are already in mapped memory, so make the draws directly.
+        auto const* const arguments = static_cast<uint8_t const*>(upload_data);
+        for (uint32_t ii = 0; ii < draw_count; ++ii) {
+            DrawIndexedArguments draw;
+            memcpy(&draw, arguments + size_t{ii} * stride, sizeof(draw));
+            _graphics->vkCmdDrawIndexed(_buffer, draw.index_count, draw.instance_count,
+                                        draw.first_index, draw.base_vertex, draw.first_instance);
+        }
+        return;
+    }
+    auto const offset = static_cast<VkDeviceSize>(static_cast<uint8_t const*>(upload_data) -
+                                                  _graphics->_upload_start);
+    if (_graphics->_multi_draw_indirect) {
+        _graphics->vkCmdDrawIndexedIndirect(_buffer, _graphics->_upload_buffer->_buffer, offset,
+                                            draw_count, stride);
+        return;
+    }
+    // Without the feature, each indirect draw can only make one draw
+    for (uint32_t ii = 0; ii < draw_count; ++ii) {
+        _graphics->vkCmdDrawIndexedIndirect(_buffer, _graphics->_upload_buffer->_buffer,
+                                            offset + VkDeviceSize{ii} * stride, 1, stride);
+    }
 }
 
 void CommandBufferVulkan::end_render_pass()
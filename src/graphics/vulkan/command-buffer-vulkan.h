@@ -6,6 +6,9 @@
 #include <vulkan/vk_platform.h>
 #include <vulkan/vulkan.h>
 
+#include <cstdint>
+#include <vector>
+
 namespace ak {
 
 class CommandBufferVulkan : public CommandBuffer
@@ -13,25 +16,54 @@ class CommandBufferVulkan : public CommandBuffer
    public:
     void reset() final;
     bool begin_render_pass() final;
+    bool execute_render_pass(CommandBuffer* const* command_buffers, size_t count) final;
+    void* get_upload_data(size_t size, size_t alignment) final;
     void set_vertex_constant_data(uint32_t slot, void const* upload_data, size_t size) final;
     void set_pixel_constant_data(void const* upload_data, size_t size) final;
     void set_render_state(RenderState* const state) final;
     void set_vertex_buffer(Buffer* const buffer) final;
     void set_index_buffer(Buffer* const buffer) final;
+    void set_instance_data(void const* upload_data, size_t size) final;
     void draw(uint32_t vertex_count) final;
-    void draw_indexed(uint32_t index_count) final;
+    void draw_indexed(uint32_t index_count, uint32_t first_index, int32_t base_vertex) final;
+    void draw_indexed_instanced(uint32_t index_count, uint32_t instance_count,
+                                uint32_t first_index, int32_t base_vertex,
+                                uint32_t first_instance) final;
+    void draw_indexed_indirect(void const* upload_data, uint32_t draw_count,
+                               uint32_t stride) final;
     void end_render_pass() final;
 
+    /// Upload memory taken from the device at a time by get_upload_data
+    static constexpr size_t kUploadBlockSize = 256 * 1024;
+    /// The submit serial of a buffer handed out and not yet submitted
+    static constexpr uint64_t kNotSubmitted = UINT64_MAX;
+
    private:
     friend class GraphicsVulkan;
 
+    /// @brief Begins the render pass on the current back buffer
+    bool begin_render_pass(VkSubpassContents contents);
+    /// @brief Sets the viewport and scissor to the whole back buffer
+    void set_viewport();
+
     GraphicsVulkan* _graphics = nullptr;
 
     class RenderStateVulkan* _current_render_state = nullptr;
     VkCommandPool _pool = VK_NULL_HANDLE;
     VkCommandBuffer _buffer = VK_NULL_HANDLE;
+    /// Signaled once the GPU is done with a submission ending in this buffer.
+    /// Render pass buffers have none.
     VkFence _fence = VK_NULL_HANDLE;
+    /// The submission that last ran the buffer, which is free again once the
+    /// GPU is past it. Guarded by GraphicsVulkan::_submit_mutex.
+    uint64_t _submit_serial = 0;
+    std::vector<CommandBufferVulkan*> _executed_buffers;  ///< render pass buffers this one runs
+    std::vector<VkCommandBuffer> _render_pass_buffers;    ///< scratch for execute_render_pass
+    // the rest of the upload block get_upload_data allocates from
+    uint8_t* _upload_block = nullptr;
+    uint8_t* _upload_block_end = nullptr;
     bool _open = false;
+    bool _render_pass_only = false;  ///< a secondary buffer, from render_pass_command_buffer
 };
 
 }  // namespace ak
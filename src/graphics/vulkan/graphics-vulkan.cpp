@@ -84,6 +84,9 @@ GraphicsVulkan::~GraphicsVulkan()
         vkDestroyCommandPool(_device, buffer._pool, _vk_allocator);
         vkDestroyFence(_device, buffer._fence, _vk_allocator);
     }
+    for (auto const& buffer : _render_pass_command_buffers) {
+        vkDestroyCommandPool(_device, buffer._pool, _vk_allocator);
+    }
     for (auto const& back_buffer : _back_buffer_views) {
         vkDestroyImageView(_device, back_buffer, _vk_allocator);
     }
@@ -344,13 +347,15 @@ bool GraphicsVulkan::present()
 
 CommandBuffer* GraphicsVulkan::command_buffer()
 {
-    uint_fast32_t const currIndex = _current_command_buffer.fetch_add(1) % kMaxCommandBuffers;
-    auto& buffer = gsl::at(_command_buffers, currIndex);
-    if (vkGetFenceStatus(_device, buffer._fence) != VK_SUCCESS || buffer._open) {
-        /// @TODO: This case needs to be handled
+    CommandBufferVulkan* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_submit_mutex);
+        buffer = acquire(_command_buffers, &_current_command_buffer);
+    }
+    if (buffer == nullptr) {
         return nullptr;
     }
-    buffer.reset();
+    buffer->reset();
 
     constexpr VkCommandBufferBeginInfo const beginInfo = {
         VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,  // sType
@@ -358,43 +363,125 @@ CommandBuffer* GraphicsVulkan::command_buffer()
         VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,  // flags
         nullptr,                                      // pInheritanceInfo
     };
-    auto const result = vkBeginCommandBuffer(buffer._buffer, &beginInfo);
+    auto const result = vkBeginCommandBuffer(buffer->_buffer, &beginInfo);
+    assert(VK_SUCCEEDED(result) && "Could not begin buffer");
+
+    buffer->_open = true;
+    return buffer;
+}
+CommandBuffer* GraphicsVulkan::render_pass_command_buffer()
+{
+    CommandBufferVulkan* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_submit_mutex);
+        buffer = acquire(_render_pass_command_buffers, &_current_render_pass_command_buffer);
+    }
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+    buffer->reset();
+
+    // Recorded for the one subpass of the render pass, on whichever
+    // framebuffer it is run in
+    VkCommandBufferInheritanceInfo const inheritance_info = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,  // sType
+        nullptr,                                            // pNext
+        _render_pass,                                       // renderPass
+        0,                                                  // subpass
+        VK_NULL_HANDLE,                                     // framebuffer
+        VK_FALSE,                                           // occlusionQueryEnable
+        0,                                                  // queryFlags
+        0,                                                  // pipelineStatistics
+    };
+    VkCommandBufferBeginInfo const begin_info = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,  // sType
+        nullptr,                                      // pNext
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+            VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,  // flags
+        &inheritance_info,                                     // pInheritanceInfo
+    };
+    auto const result = vkBeginCommandBuffer(buffer->_buffer, &begin_info);
     assert(VK_SUCCEEDED(result) && "Could not begin buffer");
 
-    buffer._open = true;
-    return &buffer;
+    buffer->_open = true;
+    buffer->set_viewport();
+    return buffer;
+}
+CommandBufferVulkan* GraphicsVulkan::acquire(
+    std::array<CommandBufferVulkan, kMaxCommandBuffers>& buffers, uint32_t* const next)
+{
+    update_completed_serial();
+    for (size_t ii = 0; ii < buffers.size(); ++ii) {
+        auto& buffer = gsl::at(buffers, (*next)++ % kMaxCommandBuffers);
+        if (buffer._submit_serial <= _completed_serial) {
+            buffer._submit_serial = CommandBufferVulkan::kNotSubmitted;
+            return &buffer;
+        }
+    }
+    return nullptr;
+}
+void GraphicsVulkan::update_completed_serial()
+{
+    // A fence is signaled only once every earlier submission is done too.
+    // Handed out buffers are skipped, as their fences may be being reset.
+    for (auto const& buffer : _command_buffers) {
+        auto const serial = buffer._submit_serial;
+        if (serial != CommandBufferVulkan::kNotSubmitted && serial > _completed_serial &&
+            vkGetFenceStatus(_device, buffer._fence) == VK_SUCCESS) {
+            _completed_serial = serial;
+        }
+    }
 }
 int GraphicsVulkan::num_available_command_buffers()
 {
+    std::lock_guard<std::mutex> lock(_submit_mutex);
+    update_completed_serial();
     int available_command_buffers = 0;
     for (auto const& buffer : _command_buffers) {
-        if (!buffer._open) {
+        if (buffer._submit_serial <= _completed_serial) {
             available_command_buffers++;
         }
     }
     return available_command_buffers;
 }
-bool GraphicsVulkan::execute(CommandBuffer* command_buffer)
+bool GraphicsVulkan::execute(CommandBuffer* const* const command_buffers, size_t const count)
 {
-    Expects(command_buffer);
+    Expects(count > 0 && command_buffers);
     Expects(_device);
-    auto* const vk_buffer = static_cast<CommandBufferVulkan*>(command_buffer);
-    VkResult result = vkEndCommandBuffer(vk_buffer->_buffer);
-    assert(VK_SUCCEEDED(result) && "Could not end command buffer");
+    _submit_buffers.clear();
+    for (size_t ii = 0; ii < count; ++ii) {
+        auto* const vk_buffer = static_cast<CommandBufferVulkan*>(command_buffers[ii]);
+        Expects(vk_buffer && !vk_buffer->_render_pass_only);
+        VkResult const result = vkEndCommandBuffer(vk_buffer->_buffer);
+        assert(VK_SUCCEEDED(result) && "Could not end command buffer");
+        _submit_buffers.push_back(vk_buffer->_buffer);
+    }
     VkSubmitInfo const submit_info = {
-        VK_STRUCTURE_TYPE_SUBMIT_INFO,  // sType
-        nullptr,                        // pNext
-        0,                              // waitSemaphoreCount
-        nullptr,                        // pWaitSemaphores
-        nullptr,                        // pWaitDstStageMask
-        1,                              // commandBufferCount
-        &vk_buffer->_buffer,            // pCommandBuffers
-        0,                              // signalSemaphoreCount
-        nullptr,                        // pSignalSemaphores
+        VK_STRUCTURE_TYPE_SUBMIT_INFO,                  // sType
+        nullptr,                                        // pNext
+        0,                                              // waitSemaphoreCount
+        nullptr,                                        // pWaitSemaphores
+        nullptr,                                        // pWaitDstStageMask
+        static_cast<uint32_t>(_submit_buffers.size()),  // commandBufferCount
+        _submit_buffers.data(),                         // pCommandBuffers
+        0,                                              // signalSemaphoreCount
+        nullptr,                                        // pSignalSemaphores
     };
-    result = vkQueueSubmit(_render_queue, 1, &submit_info, vk_buffer->_fence);
+    std::lock_guard<std::mutex> lock(_submit_mutex);
+    // Every buffer of the submission, and every render pass buffer they run,
+    // is free once the fence of the last one is signaled
+    uint64_t const serial = ++_submit_serial;
+    for (size_t ii = 0; ii < count; ++ii) {
+        auto* const vk_buffer = static_cast<CommandBufferVulkan*>(command_buffers[ii]);
+        vk_buffer->_submit_serial = serial;
+        for (auto* const executed : vk_buffer->_executed_buffers) {
+            executed->_submit_serial = serial;
+        }
+        vk_buffer->_open = false;
+    }
+    auto* const last_buffer = static_cast<CommandBufferVulkan*>(command_buffers[count - 1]);
+    VkResult const result = vkQueueSubmit(_render_queue, 1, &submit_info, last_buffer->_fence);
     assert(VK_SUCCEEDED(result) && "Could not submit command buffer");
-    vk_buffer->_open = false;
     return true;
 }
 
@@ -502,51 +589,67 @@ std::unique_ptr<RenderState> GraphicsVulkan::create_render_state(RenderStateDesc
         },
     };
 
-    // input layout
+    // input layout. Binding 0 is the vertex buffer and binding 1 the instance
+    // data, each with its attributes packed in order
     std::vector<VkVertexInputAttributeDescription> attribute_desc;
     auto const* layout = desc.input_layout;
-    uint32_t current_offset = 0;
+    uint32_t current_offset[2] = {};
     while (layout && layout->name) {
+        uint32_t const binding = layout->rate == InputRate::kPerInstance ? 1 : 0;
         VkFormat format = VK_FORMAT_UNDEFINED;
-        switch (layout->num_floats) {
-            case 1:
+        switch (layout->format) {
+            case VertexFormat::kFloat1:
                 format = VK_FORMAT_R32_SFLOAT;
                 break;
-            case 2:
+            case VertexFormat::kFloat2:
                 format = VK_FORMAT_R32G32_SFLOAT;
                 break;
-            case 3:
+            case VertexFormat::kFloat3:
                 format = VK_FORMAT_R32G32B32_SFLOAT;
                 break;
-            case 4:
+            case VertexFormat::kFloat4:
                 format = VK_FORMAT_R32G32B32A32_SFLOAT;
                 break;
+            case VertexFormat::kSnorm16x2:
+                format = VK_FORMAT_R16G16_SNORM;
+                break;
+            case VertexFormat::kSnorm16x4:
+                format = VK_FORMAT_R16G16B16A16_SNORM;
+                break;
+            case VertexFormat::kUnknown:
             default:
                 break;
         }
         attribute_desc.push_back({
-            layout->slot,   // location
-            0,              // binding
-            format,         // format
-            current_offset  // offset
+            layout->slot,             // location
+            binding,                  // binding
+            format,                   // format
+            current_offset[binding],  // offset
         });
-        current_offset += sizeof(float) * layout->num_floats;
+        current_offset[binding] += vertex_format_size(layout->format);
         layout++;
     }
 
     VkVertexInputBindingDescription const vertex_binding_desc[] = {
         {
             0,                           // binding
-            current_offset,              // stride
+            current_offset[0],           // stride
             VK_VERTEX_INPUT_RATE_VERTEX  // inputRate
         },
+        {
+            1,                             // binding
+            current_offset[1],             // stride
+            VK_VERTEX_INPUT_RATE_INSTANCE  // inputRate
+        },
     };
+    // Only describe the instance binding when something reads it
+    uint32_t const num_input_bindings = current_offset[1] > 0 ? 2 : 1;
 
     VkPipelineVertexInputStateCreateInfo const vertex_input_state_info = {
         VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,  // sType
         nullptr,                                                    // pNext
         0,                                                          // flags
-        array_length(vertex_binding_desc),                          // vertexBindingDescriptionCount
+        num_input_bindings,                                         // vertexBindingDescriptionCount
         vertex_binding_desc,                                        // pVertexBindingDescriptions
         static_cast<uint32_t>(attribute_desc.size()),  // vertexAttributeDescriptionCount
         attribute_desc.data(),                         // pVertexAttributeDescriptions
@@ -712,10 +815,13 @@ std::unique_ptr<Buffer> GraphicsVulkan::create_vertex_buffer(uint32_t const size
 }
 
 std::unique_ptr<Buffer> GraphicsVulkan::create_index_buffer(uint32_t const size,
-                                                            void const* const data)
+                                                            void const* const data,
+                                                            IndexFormat const format)
 {
     auto index_buffer =
         create_buffer(size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    index_buffer->_index_type =
+        format == IndexFormat::kUInt32 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
 
     // upload data
     void* gpu_data = nullptr;
@@ -882,6 +988,15 @@ void GraphicsVulkan::create_device()
         VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME,
     };
     constexpr uint32_t const num_known_extensions = array_length(known_extensions);
+
+    VkPhysicalDeviceFeatures supported_features = {};
+    vkGetPhysicalDeviceFeatures(_physical_device, &supported_features);
+    VkPhysicalDeviceFeatures enabled_features = {};
+    enabled_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+    enabled_features.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+    _multi_draw_indirect = enabled_features.multiDrawIndirect == VK_TRUE;
+    _draw_indirect_first_instance = enabled_features.drawIndirectFirstInstance == VK_TRUE;
+
     VkDeviceCreateInfo const device_info = {
         VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,     // sType
         nullptr,                                  // pNext
@@ -892,7 +1007,7 @@ void GraphicsVulkan::create_device()
         nullptr,                                  // ppEnabledLayerNames
         num_known_extensions,                     // enabledExtensionCount
         gsl::make_span(known_extensions).data(),  // ppEnabledExtensionNames
-        nullptr,                                  // pEnabledFeatures
+        &enabled_features,                        // pEnabledFeatures
     };
     VkResult const result = vkCreateDevice(_physical_device, &device_info, nullptr, &_device);
     assert(VK_SUCCEEDED(result) && "Could not create device");
@@ -1009,6 +1124,30 @@ void GraphicsVulkan::create_command_buffers()
 
         buffer._graphics = this;
     }
+    // Render pass buffers, each also with a pool of its own so they can be
+    // recorded on different threads at once
+    for (auto& buffer : _render_pass_command_buffers) {
+        VkCommandPoolCreateInfo const pool_info = {
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,       // sType
+            nullptr,                                          // pNext
+            VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,  // flags
+            _queue_index,                                     // queueFamilyIndex
+        };
+        VkResult result = vkCreateCommandPool(_device, &pool_info, nullptr, &buffer._pool);
+        assert(VK_SUCCEEDED(result));
+        VkCommandBufferAllocateInfo const buffer_info = {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,  // sType
+            nullptr,                                         // pNext
+            buffer._pool,                                    // commandPool
+            VK_COMMAND_BUFFER_LEVEL_SECONDARY,               // level
+            1,                                               // commandBufferCount
+        };
+        result = vkAllocateCommandBuffers(_device, &buffer_info, &buffer._buffer);
+        assert(VK_SUCCEEDED(result));
+
+        buffer._graphics = this;
+        buffer._render_pass_only = true;
+    }
 }
 
 void GraphicsVulkan::create_depth_buffer()
@@ -1138,7 +1277,9 @@ std::unique_ptr<BufferVulkan> GraphicsVulkan::create_buffer(uint32_t size, VkBuf
 void GraphicsVulkan::create_upload_buffer()
 {
     _upload_buffer =
-        create_buffer(kUploadBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        create_buffer(kUploadBufferSize,
+                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
     VkResult const result = vkMapMemory(_device, _upload_buffer->_memory, 0, kUploadBufferSize, 0,
@@ -1203,6 +1344,7 @@ size_t GraphicsVulkan::align_upload_buffer(size_t const alignment)
 
 void* GraphicsVulkan::get_upload_data(size_t const size, size_t const alignment)
 {
+    std::lock_guard<std::mutex> const lock(_upload_mutex);
     size_t const offset = align_upload_buffer(alignment);
     size_t const available = _upload_end - _upload_current;
     if (available < size) {
@@ -4,7 +4,7 @@
 
 #include <array>
 #include <vector>
-#include <atomic>
+#include <mutex>
 #include <gsl/gsl_assert>
 
 #define VK_NO_PROTOTYPES
@@ -44,6 +44,7 @@ class BufferVulkan : public Buffer
     class GraphicsVulkan* _graphics = nullptr;
     VkDeviceMemory _memory = VK_NULL_HANDLE;
     VkBuffer _buffer = VK_NULL_HANDLE;
+    VkIndexType _index_type = VK_INDEX_TYPE_UINT16;  ///< Only used by index buffers
 };
 
 class GraphicsVulkan : public Graphics
@@ -57,14 +58,17 @@ class GraphicsVulkan : public Graphics
     bool resize(int, int) final;
     bool present() final;
     CommandBuffer* command_buffer() final;
+    CommandBuffer* render_pass_command_buffer() final;
     int num_available_command_buffers() final;
-    bool execute(CommandBuffer* command_buffer) final;
+    using Graphics::execute;
+    bool execute(CommandBuffer* const* command_buffers, size_t count) final;
     void wait_for_idle() final;
     void* get_upload_data(size_t const size, size_t const alignment) final;
 
     std::unique_ptr<RenderState> create_render_state(RenderStateDesc const& desc) final;
     std::unique_ptr<Buffer> create_vertex_buffer(uint32_t size, void const* data) final;
-    std::unique_ptr<Buffer> create_index_buffer(uint32_t size, void const* data) final;
+    std::unique_ptr<Buffer> create_index_buffer(uint32_t size, void const* data,
+                                                IndexFormat format) final;
 
    private:
     friend class CommandBufferVulkan;
@@ -84,6 +88,14 @@ class GraphicsVulkan : public Graphics
     void create_device();
     void create_render_passes();
     void create_command_buffers();
+    /// @brief Marks the first free buffer of `buffers`, trying each in turn
+    ///     from `*next`, as handed out. Call with _submit_mutex held.
+    /// @return NULL if every buffer is recording or still on the GPU
+    CommandBufferVulkan* acquire(std::array<CommandBufferVulkan, kMaxCommandBuffers>& buffers,
+                                 uint32_t* next);
+    /// @brief Moves _completed_serial up to the newest submission whose
+    ///     fence is signaled. Call with _submit_mutex held.
+    void update_completed_serial();
     void create_depth_buffer();
     std::unique_ptr<BufferVulkan> create_buffer(uint32_t size, VkBufferUsageFlags usage,
                                                 VkMemoryPropertyFlags property_flags);
@@ -132,6 +144,8 @@ class GraphicsVulkan : public Graphics
     uint32_t _queue_index = UINT32_MAX;
 
     VkDevice _device = VK_NULL_HANDLE;
+    bool _multi_draw_indirect = false;           ///< one indirect draw can make several draws
+    bool _draw_indirect_first_instance = false;  ///< indirect draws can start past instance 0
 
     // Surface
     VkSurfaceKHR _surface = VK_NULL_HANDLE;
@@ -161,9 +175,18 @@ class GraphicsVulkan : public Graphics
     // execution
     VkQueue _render_queue = VK_NULL_HANDLE;
     std::array<CommandBufferVulkan, kMaxCommandBuffers> _command_buffers;
-    std::atomic<uint32_t> _current_command_buffer = {};
-
-    // upload buffer
+    std::array<CommandBufferVulkan, kMaxCommandBuffers> _render_pass_command_buffers;
+    // Submissions are numbered in order, and a buffer is free once the GPU is
+    // past the one that last ran it. Guarded so any thread can take a buffer.
+    std::mutex _submit_mutex;
+    uint32_t _current_command_buffer = 0;
+    uint32_t _current_render_pass_command_buffer = 0;
+    uint64_t _submit_serial = 0;     ///< the latest submission
+    uint64_t _completed_serial = 0;  ///< the latest submission known to be done
+    std::vector<VkCommandBuffer> _submit_buffers;  ///< scratch for execute
+
+    // upload buffer. The position is guarded so any thread can allocate.
+    std::mutex _upload_mutex;
     std::unique_ptr<BufferVulkan> _upload_buffer;
     uint8_t* _upload_start = nullptr;
     uint8_t const* _upload_end = nullptr;
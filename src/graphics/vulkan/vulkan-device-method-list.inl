@@ -38,6 +38,7 @@ VK_DEVICE_FUNCTION(vkQueueSubmit)
 
 VK_DEVICE_FUNCTION(vkCmdBeginRenderPass)
 VK_DEVICE_FUNCTION(vkCmdEndRenderPass)
+VK_DEVICE_FUNCTION(vkCmdExecuteCommands)
 
 VK_DEVICE_FUNCTION(vkCreateShaderModule)
 VK_DEVICE_FUNCTION(vkDestroyShaderModule)
@@ -58,6 +59,7 @@ VK_DEVICE_FUNCTION(vkCmdBindVertexBuffers)
 VK_DEVICE_FUNCTION(vkCmdBindIndexBuffer)
 VK_DEVICE_FUNCTION(vkCmdDraw)
 VK_DEVICE_FUNCTION(vkCmdDrawIndexed)
+VK_DEVICE_FUNCTION(vkCmdDrawIndexedIndirect)
 
 VK_DEVICE_FUNCTION(vkCreateBuffer)
 VK_DEVICE_FUNCTION(vkDestroyBuffer)
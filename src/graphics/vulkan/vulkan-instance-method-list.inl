@@ -3,6 +3,7 @@ VK_INSTANCE_FUNCTION(vkCreateDebugReportCallbackEXT)
 VK_INSTANCE_FUNCTION(vkDestroyDebugReportCallbackEXT)
 VK_INSTANCE_FUNCTION(vkEnumeratePhysicalDevices)
 VK_INSTANCE_FUNCTION(vkGetPhysicalDeviceProperties)
+VK_INSTANCE_FUNCTION(vkGetPhysicalDeviceFeatures)
 VK_INSTANCE_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)
 VK_INSTANCE_FUNCTION(vkGetPhysicalDeviceMemoryProperties)
 VK_INSTANCE_FUNCTION(vkCreateDevice)
@@ -0,0 +1,413 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "asteroid-field.h"
+
+namespace {
+
+constexpr float kPi = 3.14159265358979323846f;
+
+/// @brief Fills a field with the same kind of data the application uses
+AsteroidField create_field(size_t const count)
+{
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> scale_dist(0.2f, 3.0f);
+    std::uniform_real_distribution<float> radius_dist(100.0f, 800.0f);
+    std::uniform_real_distribution<float> velocity_dist(-2.0f, 2.0f);
+    std::uniform_real_distribution<float> angle_dist(-kPi, kPi);
+    std::normal_distribution<float> axis_dist;
+
+    AsteroidField field;
+    field.allocate(count);
+    for (size_t ii = 0; ii < count; ++ii) {
+        auto const scale = scale_dist(gen);
+        auto const axis =
+            mathfu::float3(axis_dist(gen), axis_dist(gen), axis_dist(gen)).Normalized();
+        for (int jj = 0; jj < 3; ++jj) {
+            field.spin_axis[jj][ii] = axis[jj];
+        }
+        field.spin_velocity[ii] = velocity_dist(gen);
+        field.orbit_velocity[ii] = velocity_dist(gen) * 0.01f;
+        auto const rotation =
+            mathfu::Quaternion<float>::FromAngleAxis(angle_dist(gen), axis) *
+            mathfu::Quaternion<float>::FromAngleAxis(angle_dist(gen), {0.0f, 1.0f, 0.0f});
+        field.set_transform(ii, {radius_dist(gen), 10.0f, radius_dist(gen)}, rotation, scale);
+    }
+    return field;
+}
+
+/// @brief The straightforward matrix implementation the kernels replace
+mathfu::float4x4 reference_update(AsteroidField const& field, size_t const index,
+                                  float const delta_time)
+{
+    mathfu::float3 const axis(field.spin_axis[0][index], field.spin_axis[1][index],
+                              field.spin_axis[2][index]);
+    auto const orbit = mathfu::float4x4::FromRotationMatrix(
+        mathfu::float4x4::RotationY(field.orbit_velocity[index] * delta_time));
+    auto const spin =
+        mathfu::Quaternion<float>::FromAngleAxis(field.spin_velocity[index] * delta_time, axis)
+            .ToMatrix4();
+    return orbit * field.world(index) * spin;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("asteroid field update")
+{
+    simd::InstructionSet const instruction_sets[] = {
+        simd::InstructionSet::kScalar, simd::InstructionSet::kSSE2, simd::InstructionSet::kAVX2,
+        simd::InstructionSet::kAVX512,
+    };
+    float const delta_times[] = {1.0f / 60.0f, 0.1f, 2.5f};
+    // Counts that are not multiples of any vector width exercise the remainder loop
+    size_t const counts[] = {1, 37, 1031};
+
+    GIVEN("asteroid fields of different sizes")
+    {
+        WHEN("each field is updated with every instruction set the machine supports")
+        {
+            THEN("every asteroid matches the matrix implementation")
+            {
+                for (auto const isa : instruction_sets) {
+                    if (isa > simd::best_instruction_set()) {
+                        continue;
+                    }
+                    INFO("instruction set: " << simd::instruction_set_name(isa));
+                    for (auto const count : counts) {
+                        for (auto const delta_time : delta_times) {
+                            auto field = create_field(count);
+                            std::vector<mathfu::float4x4> expected(count);
+                            for (size_t ii = 0; ii < count; ++ii) {
+                                expected[ii] = reference_update(field, ii, delta_time);
+                            }
+                            field.update(delta_time, isa);
+
+                            for (size_t ii = 0; ii < count; ++ii) {
+                                auto const actual = field.world(ii);
+                                for (int row = 0; row < 4; ++row) {
+                                    for (int col = 0; col < 4; ++col) {
+                                        REQUIRE(actual(row, col) ==
+                                                Approx(expected[ii](row, col))
+                                                    .epsilon(1e-4)
+                                                    .margin(1e-3));
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("asteroid field orientation stays normalized")
+{
+    GIVEN("an asteroid field")
+    {
+        auto field = create_field(37);
+        WHEN("it is simulated for many frames")
+        {
+            for (int frame = 0; frame < 100000; ++frame) {
+                field.update(1.0f / 60.0f);
+            }
+            THEN("every orientation is still a unit quaternion")
+            {
+                for (size_t ii = 0; ii < field.size(); ++ii) {
+                    float length_sq = 0.0f;
+                    for (auto const& component : field.orientation) {
+                        length_sq += component[ii] * component[ii];
+                    }
+                    REQUIRE(length_sq == Approx(1.0f).margin(1e-5));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("asteroid field closed-form evaluation")
+{
+    size_t const count = 1031;
+    float const delta_time = 1.0f / 60.0f;
+    int const num_frames = 600;
+
+    GIVEN("two identical asteroid fields")
+    {
+        auto integrated = create_field(count);
+        auto evaluated = create_field(count);
+
+        WHEN("one is integrated frame by frame and the other evaluated at the end time")
+        {
+            for (int frame = 0; frame < num_frames; ++frame) {
+                integrated.update(delta_time);
+            }
+            evaluated.evaluate(delta_time * num_frames);
+
+            THEN("both end up in the same place")
+            {
+                for (size_t ii = 0; ii < count; ++ii) {
+                    auto const expected = integrated.world(ii);
+                    auto const actual = evaluated.world(ii);
+                    for (int row = 0; row < 4; ++row) {
+                        for (int col = 0; col < 4; ++col) {
+                            REQUIRE(actual(row, col) ==
+                                    Approx(expected(row, col)).epsilon(1e-3).margin(1e-2));
+                        }
+                    }
+                }
+            }
+        }
+        WHEN("the field is evaluated in scattered subsets")
+        {
+            float const time = 12.5f;
+            evaluated.evaluate(time);
+            // reverse order, uneven ranges and a different instruction set
+            for (size_t end = count; end > 0;) {
+                size_t const begin = end > 7 ? end - 7 : 0;
+                integrated.evaluate(time, simd::InstructionSet::kScalar, begin, end);
+                end = begin;
+            }
+            THEN("the result matches evaluating everything at once")
+            {
+                for (size_t ii = 0; ii < count; ++ii) {
+                    auto const expected = evaluated.world(ii);
+                    auto const actual = integrated.world(ii);
+                    for (int row = 0; row < 4; ++row) {
+                        for (int col = 0; col < 4; ++col) {
+                            REQUIRE(actual(row, col) ==
+                                    Approx(expected(row, col)).epsilon(1e-4).margin(1e-3));
+                        }
+                    }
+                }
+            }
+        }
+        WHEN("the field is rebased part way through")
+        {
+            evaluated.evaluate(3.0f);
+            evaluated.rebase();
+            evaluated.evaluate(2.0f);
+            integrated.evaluate(5.0f);
+            THEN("the result matches a single evaluation")
+            {
+                for (size_t ii = 0; ii < count; ++ii) {
+                    auto const expected = integrated.world(ii);
+                    auto const actual = evaluated.world(ii);
+                    for (int row = 0; row < 4; ++row) {
+                        for (int col = 0; col < 4; ++col) {
+                            REQUIRE(actual(row, col) ==
+                                    Approx(expected(row, col)).epsilon(1e-4).margin(1e-3));
+                        }
+                    }
+                }
+            }
+        }
+        WHEN("the field is rebased analytically part way through")
+        {
+            evaluated.rebase(3.0f);
+            evaluated.evaluate(2.0f);
+            integrated.evaluate(5.0f);
+            THEN("the result matches a single evaluation")
+            {
+                for (size_t ii = 0; ii < count; ++ii) {
+                    auto const expected = integrated.world(ii);
+                    auto const actual = evaluated.world(ii);
+                    for (int row = 0; row < 4; ++row) {
+                        for (int col = 0; col < 4; ++col) {
+                            REQUIRE(actual(row, col) ==
+                                    Approx(expected(row, col)).epsilon(1e-4).margin(1e-3));
+                        }
+                    }
+                }
+            }
+        }
+        WHEN("the positions of all and the orientations of some are evaluated")
+        {
+            float const time = 7.25f;
+            integrated.evaluate(time);
+            evaluated.evaluate_positions(time, simd::best_instruction_set(), 0, count);
+            std::vector<uint32_t> odd;
+            for (size_t ii = count; ii-- > 0;) {
+                if (ii % 2 == 1) {
+                    odd.push_back(static_cast<uint32_t>(ii));
+                }
+            }
+            evaluated.evaluate_orientations(time, odd.data(), odd.size());
+            THEN("every position and only those orientations match a full evaluation")
+            {
+                for (size_t ii = 0; ii < count; ++ii) {
+                    for (int jj = 0; jj < 3; ++jj) {
+                        REQUIRE(evaluated.position[jj][ii] ==
+                                Approx(integrated.position[jj][ii]).epsilon(1e-4).margin(1e-3));
+                    }
+                    auto const& expected =
+                        ii % 2 == 1 ? integrated.orientation : evaluated.initial_orientation;
+                    for (int jj = 0; jj < 4; ++jj) {
+                        REQUIRE(evaluated.orientation[jj][ii] ==
+                                Approx(expected[jj][ii]).epsilon(1e-4).margin(1e-4));
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("asteroid field culling")
+{
+    simd::InstructionSet const instruction_sets[] = {
+        simd::InstructionSet::kScalar, simd::InstructionSet::kSSE2, simd::InstructionSet::kAVX2,
+        simd::InstructionSet::kAVX512,
+    };
+    size_t const count = 1031;
+    float const bounding_radius = 1.5f;
+
+    // A perspective projection looking down +z with a 90 degree field of
+    // view: clip = (x, y, 1, z). The side planes are z = |x| and z = |y|.
+    mathfu::float4x4 const viewproj(1.0f, 0.0f, 0.0f, 0.0f,  //
+                                    0.0f, 1.0f, 0.0f, 0.0f,  //
+                                    0.0f, 0.0f, 0.0f, 1.0f,  //
+                                    0.0f, 0.0f, 1.0f, 0.0f);
+
+    GIVEN("asteroids scattered around and behind the camera")
+    {
+        auto field = create_field(count);
+        std::mt19937 gen(5678);
+        std::uniform_real_distribution<float> position_dist(-20.0f, 20.0f);
+        std::vector<uint32_t> expected;
+        for (size_t ii = 0; ii < count; ++ii) {
+            float const x = position_dist(gen);
+            float const y = position_dist(gen);
+            float const z = position_dist(gen);
+            field.position[0][ii] = x;
+            field.position[1][ii] = y;
+            field.position[2][ii] = z;
+            // distance to each plane is (z - |x|) / sqrt(2)
+            float const margin = field.scale[ii] * bounding_radius * std::sqrt(2.0f);
+            if (z - std::abs(x) >= -margin && z - std::abs(y) >= -margin) {
+                expected.push_back(static_cast<uint32_t>(ii));
+            }
+        }
+        REQUIRE(!expected.empty());
+        REQUIRE(expected.size() < count);
+
+        THEN("every instruction set finds exactly the spheres touching the frustum")
+        {
+            for (auto const isa : instruction_sets) {
+                if (isa > simd::best_instruction_set()) {
+                    continue;
+                }
+                INFO("instruction set: " << simd::instruction_set_name(isa));
+                std::vector<uint32_t> visible(count);
+                auto const visible_count =
+                    field.cull(viewproj, bounding_radius, isa, 0, count, visible.data());
+                visible.resize(visible_count);
+                REQUIRE(visible == expected);
+
+                // culling a sub-range only reports indices inside it
+                auto const partial_count =
+                    field.cull(viewproj, bounding_radius, isa, 100, 200, visible.data());
+                REQUIRE(partial_count ==
+                        static_cast<size_t>(std::count_if(
+                            expected.begin(), expected.end(),
+                            [](uint32_t const index) { return index >= 100 && index < 200; })));
+                for (size_t ii = 0; ii < partial_count; ++ii) {
+                    REQUIRE(visible[ii] >= 100);
+                    REQUIRE(visible[ii] < 200);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("asteroid field storage")
+{
+    GIVEN("a field allocated with large pages requested")
+    {
+        size_t const count = 1031;
+        AsteroidField field;
+        REQUIRE(field.allocate(count, true));
+        std::vector<float*> const streams = {
+            field.orientation[0], field.orientation[1], field.orientation[2],
+            field.orientation[3], field.position[0], field.position[1],
+            field.position[2], field.initial_orientation[0], field.initial_orientation[1],
+            field.initial_orientation[2], field.initial_orientation[3], field.initial_position[0],
+            field.initial_position[1], field.initial_position[2], field.scale,
+            field.spin_axis[0], field.spin_axis[1], field.spin_axis[2],
+            field.spin_velocity, field.orbit_velocity,
+        };
+
+        THEN("every array starts on a cache line and is zeroed")
+        {
+            REQUIRE(field.size() == count);
+            REQUIRE(field.allocated_bytes() >= streams.size() * count * sizeof(float));
+            for (auto const stream : streams) {
+                REQUIRE(reinterpret_cast<uintptr_t>(stream) % 64 == 0);
+                for (size_t ii = 0; ii < count; ++ii) {
+                    REQUIRE(stream[ii] == 0.0f);
+                }
+            }
+        }
+        WHEN("each array is filled with its own value")
+        {
+            for (size_t jj = 0; jj < streams.size(); ++jj) {
+                std::fill(streams[jj], streams[jj] + count, static_cast<float>(jj));
+            }
+            THEN("no array overlaps another")
+            {
+                for (size_t jj = 0; jj < streams.size(); ++jj) {
+                    for (size_t ii = 0; ii < count; ++ii) {
+                        REQUIRE(streams[jj][ii] == static_cast<float>(jj));
+                    }
+                }
+            }
+            AND_WHEN("the field is moved")
+            {
+                AsteroidField moved(std::move(field));
+                THEN("the storage moves with it")
+                {
+                    REQUIRE(moved.size() == count);
+                    REQUIRE(moved.scale == streams[14]);
+                    REQUIRE(moved.scale[count - 1] == 14.0f);
+                    REQUIRE(field.size() == 0);
+                    REQUIRE(field.scale == nullptr);
+                }
+            }
+        }
+    }
+    GIVEN("a field too large to allocate")
+    {
+        AsteroidField field;
+        REQUIRE(field.allocate(16));
+        bool const allocated = field.allocate(std::numeric_limits<size_t>::max());
+
+        THEN("the allocation fails and leaves the field empty")
+        {
+            REQUIRE_FALSE(allocated);
+            REQUIRE(field.size() == 0);
+            REQUIRE(field.scale == nullptr);
+            REQUIRE(field.position[0] == nullptr);
+        }
+    }
+}
+
+TEST_CASE("simd sincos")
+{
+    GIVEN("inputs covering several periods")
+    {
+        THEN("the scalar fallback matches the standard library")
+        {
+            for (float x = -100.0f; x < 100.0f; x += 0.01f) {
+                simd::Scalar s;
+                simd::Scalar c;
+                simd::sincos(simd::Scalar::broadcast(x), &s, &c);
+                REQUIRE(s.v == Approx(std::sin(x)).margin(1e-5));
+                REQUIRE(c.v == Approx(std::cos(x)).margin(1e-5));
+            }
+        }
+    }
+}
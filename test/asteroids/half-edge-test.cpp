@@ -0,0 +1,113 @@
+#include "catch.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include "half-edge.h"
+#include "mesh.h"
+
+namespace {
+
+/// @brief Checks the links every half-edge structure must satisfy
+template<typename Index>
+void check_half_edges(std::vector<Index> const& indices, HalfEdges const& half_edges)
+{
+    auto const count = static_cast<uint32_t>(indices.size());
+    REQUIRE(half_edges.twin.size() == count);
+    REQUIRE(half_edges.edge.size() == count);
+    for (uint32_t half_edge = 0; half_edge < count; ++half_edge) {
+        REQUIRE(next_half_edge(prev_half_edge(half_edge)) == half_edge);
+        REQUIRE(next_half_edge(next_half_edge(next_half_edge(half_edge))) == half_edge);
+        REQUIRE(next_half_edge(half_edge) / 3 == half_edge / 3);
+
+        uint32_t const twin = half_edges.twin[half_edge];
+        if (twin != kNoHalfEdge) {
+            REQUIRE(half_edges.twin[twin] == half_edge);
+            REQUIRE(indices[twin] == indices[next_half_edge(half_edge)]);
+            REQUIRE(indices[next_half_edge(twin)] == indices[half_edge]);
+            REQUIRE(half_edges.edge[twin] == half_edges.edge[half_edge]);
+        }
+        uint32_t const first = half_edges.edge_half_edge[half_edges.edge[half_edge]];
+        REQUIRE((first == half_edge || first == twin));
+        REQUIRE(first <= half_edge);
+    }
+}
+
+/// @brief Triangles visited walking the fan around `vertex`
+size_t fan_size(HalfEdges const& half_edges, size_t const vertex)
+{
+    size_t size = 0;
+    uint32_t const first = half_edges.vertex_half_edge[vertex];
+    for (uint32_t half_edge = first; half_edge != kNoHalfEdge;) {
+        ++size;
+        half_edge = next_in_fan(half_edges, half_edge);
+        if (half_edge == first) {
+            break;
+        }
+    }
+    return size;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("half-edges")
+{
+    GIVEN("an icosahedron")
+    {
+        Mesh mesh;
+        CreateIcosahedron(&mesh);
+        HalfEdges half_edges;
+        build_half_edges(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(),
+                         &half_edges);
+
+        THEN("every half-edge has a twin and the edges are numbered once each")
+        {
+            check_half_edges(mesh.indices, half_edges);
+            REQUIRE(half_edges.edge_half_edge.size() == 30);
+            for (auto const twin : half_edges.twin) {
+                REQUIRE(twin != kNoHalfEdge);
+            }
+        }
+        THEN("the fan around every vertex has its five triangles")
+        {
+            for (size_t vertex = 0; vertex < mesh.vertices.size(); ++vertex) {
+                uint32_t const half_edge = half_edges.vertex_half_edge[vertex];
+                REQUIRE(mesh.indices[half_edge] == vertex);
+                REQUIRE(fan_size(half_edges, vertex) == 5);
+            }
+        }
+    }
+    GIVEN("an open grid with an unused vertex")
+    {
+        // 0 - 1 - 2
+        // | \ | \ |
+        // 3 - 4 - 5   6
+        std::vector<uint32_t> const indices = {0, 1, 4, 0, 4, 3, 1, 2, 5, 1, 5, 4};
+        HalfEdges half_edges;
+        build_half_edges(indices.data(), indices.size(), 7, &half_edges);
+
+        THEN("only the inner edges have twins")
+        {
+            check_half_edges(indices, half_edges);
+            REQUIRE(half_edges.edge_half_edge.size() == 9);
+            size_t paired = 0;
+            for (auto const twin : half_edges.twin) {
+                paired += twin != kNoHalfEdge ? 1 : 0;
+            }
+            REQUIRE(paired == 6);
+        }
+        THEN("the fans around border vertices start at the border")
+        {
+            size_t const expected[] = {2, 3, 1, 1, 3, 2, 0};
+            for (size_t vertex = 0; vertex < 6; ++vertex) {
+                INFO("vertex " << vertex);
+                uint32_t const half_edge = half_edges.vertex_half_edge[vertex];
+                REQUIRE(indices[half_edge] == vertex);
+                REQUIRE(half_edges.twin[half_edge] == kNoHalfEdge);
+                REQUIRE(fan_size(half_edges, vertex) == expected[vertex]);
+            }
+            REQUIRE(half_edges.vertex_half_edge[6] == kNoHalfEdge);
+            REQUIRE(fan_size(half_edges, 6) == 0);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#include "catch.hpp"
+
+#include <atomic>
+#include <vector>
+
+#include "job-system.h"
+
+TEST_CASE("job system parallel_for")
+{
+    GIVEN("a job system with several threads")
+    {
+        JobSystem jobs(4);
+        REQUIRE(jobs.num_threads() == 4);
+
+        WHEN("a range is split into chunks")
+        {
+            size_t const count = 100003;
+            std::vector<int> visits(count, 0);
+            std::atomic<size_t> chunks(0);
+            std::atomic<size_t> bad_chunks(0);
+            // Catch assertions are not thread safe, so only count inside the jobs
+            jobs.parallel_for(count, 1000, [&](size_t const begin, size_t const end) {
+                if (begin >= end || end - begin > 1000) {
+                    ++bad_chunks;
+                }
+                for (size_t ii = begin; ii < end; ++ii) {
+                    ++visits[ii];
+                }
+                ++chunks;
+            });
+
+            THEN("every element is visited exactly once")
+            {
+                REQUIRE(chunks == 101);
+                REQUIRE(bad_chunks == 0);
+                for (auto const visit_count : visits) {
+                    REQUIRE(visit_count == 1);
+                }
+            }
+        }
+        WHEN("the job system is reused for many small dispatches")
+        {
+            std::atomic<size_t> total(0);
+            for (int ii = 0; ii < 1000; ++ii) {
+                jobs.parallel_for(64, 1, [&](size_t const begin, size_t const end) {
+                    total += end - begin;
+                });
+            }
+            THEN("no work is lost")
+            {
+                REQUIRE(total == 64000);
+            }
+        }
+    }
+    GIVEN("a chunk size for float arrays")
+    {
+        JobSystem jobs(3);
+        THEN("chunks are whole cache lines")
+        {
+            size_t const sizes[] = {1, 15, 1000, 50000, 1000003};
+            for (auto const size : sizes) {
+                auto const chunk_size = jobs.chunk_size(size, sizeof(float));
+                REQUIRE(chunk_size > 0);
+                REQUIRE((chunk_size * sizeof(float)) % kCacheLineSize == 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,136 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "mesh-cache.h"
+
+namespace {
+
+char const kCachePath[] = "mesh-cache-test.cache";
+
+MeshCacheView view_of(PackedMesh const& mesh, std::vector<unsigned int> const& offsets,
+                      unsigned int const vertices_per_mesh)
+{
+    MeshCacheView view = {};
+    view.vertices = mesh.vertices.data();
+    view.vertex_count = mesh.vertices.size();
+    view.indices = mesh.indices.data();
+    view.index_count = mesh.indices.size();
+    view.subdiv_index_offsets = offsets.data();
+    view.subdiv_offset_count = offsets.size();
+    view.position_scales = mesh.positionScales.data();
+    view.mesh_count = mesh.positionScales.size();
+    view.meshlets = mesh.meshlets.data();
+    view.meshlet_count = mesh.meshlets.size();
+    view.meshlet_bounds = mesh.meshletBounds.data();
+    view.lod_index_offsets = mesh.lodIndexOffsets.data();
+    view.lod_errors = mesh.lodErrors.data();
+    view.lod_count = static_cast<unsigned int>(mesh.lodErrors.size() / view.mesh_count);
+    view.vertices_per_mesh = vertices_per_mesh;
+    view.bounding_radius = 1.5f;
+    return view;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("mesh cache")
+{
+    unsigned int const levels = 2;
+    unsigned int const count = 3;
+    unsigned int const seed = 7;
+    AsteroidNoiseParams const params;
+    std::vector<unsigned int> offsets(levels + 2);
+    unsigned int vertices_per_mesh = 0;
+    PackedMesh mesh;
+    float const ratios[] = {0.125f, 0.5f};
+    unsigned int const lod_count = 2;
+    CreateAsteroidsFromGeospheres(&mesh, levels, count, seed, offsets.data(), &vertices_per_mesh);
+    SimplifyAsteroidLods(&mesh, levels, offsets.data(), vertices_per_mesh, ratios, lod_count);
+    auto const key = asteroid_mesh_cache_key(levels, count, seed, params, ratios, lod_count);
+    std::remove(kCachePath);
+
+    GIVEN("no cache file")
+    {
+        THEN("the cache is a miss") { REQUIRE_FALSE(MeshCache(kCachePath, key).valid()); }
+    }
+    GIVEN("a mesh written to the cache")
+    {
+        REQUIRE(MeshCache::write(kCachePath, key, view_of(mesh, offsets, vertices_per_mesh)));
+
+        WHEN("it is opened with the same key")
+        {
+            MeshCache const cache(kCachePath, key);
+            REQUIRE(cache.valid());
+            auto const& cached = cache.mesh();
+
+            THEN("the mapped arrays hold the mesh")
+            {
+                REQUIRE(cached.vertex_count == mesh.vertices.size());
+                REQUIRE(memcmp(cached.vertices, mesh.vertices.data(),
+                               mesh.vertices.size() * sizeof(PackedVertex)) == 0);
+                REQUIRE(cached.index_count == mesh.indices.size());
+                REQUIRE(memcmp(cached.indices, mesh.indices.data(),
+                               mesh.indices.size() * sizeof(IndexType)) == 0);
+                REQUIRE(std::vector<unsigned int>(
+                            cached.subdiv_index_offsets,
+                            cached.subdiv_index_offsets + cached.subdiv_offset_count) == offsets);
+                REQUIRE(std::vector<float>(cached.position_scales,
+                                           cached.position_scales + cached.mesh_count) ==
+                        mesh.positionScales);
+                REQUIRE(cached.meshlet_count == mesh.meshlets.size());
+                REQUIRE(memcmp(cached.meshlets, mesh.meshlets.data(),
+                               mesh.meshlets.size() * sizeof(Meshlet)) == 0);
+                REQUIRE(memcmp(cached.meshlet_bounds, mesh.meshletBounds.data(),
+                               mesh.meshletBounds.size() * sizeof(MeshletBounds)) == 0);
+                REQUIRE(cached.lod_count == lod_count);
+                REQUIRE(std::vector<unsigned int>(
+                            cached.lod_index_offsets,
+                            cached.lod_index_offsets + count * lod_count + 1) ==
+                        mesh.lodIndexOffsets);
+                REQUIRE(std::vector<float>(cached.lod_errors,
+                                           cached.lod_errors + count * lod_count) ==
+                        mesh.lodErrors);
+                REQUIRE(cached.vertices_per_mesh == vertices_per_mesh);
+                REQUIRE(cached.bounding_radius == 1.5f);
+            }
+        }
+        WHEN("any generation parameter differs")
+        {
+            AsteroidNoiseParams rougher;
+            rougher.radiusScale *= 2.0f;
+            float const finer[] = {0.125f, 0.75f};
+            uint64_t const other_keys[] = {
+                asteroid_mesh_cache_key(levels + 1, count, seed, params, ratios, lod_count),
+                asteroid_mesh_cache_key(levels, count + 1, seed, params, ratios, lod_count),
+                asteroid_mesh_cache_key(levels, count, seed + 1, params, ratios, lod_count),
+                asteroid_mesh_cache_key(levels, count, seed, rougher, ratios, lod_count),
+                asteroid_mesh_cache_key(levels, count, seed, params, finer, lod_count),
+                asteroid_mesh_cache_key(levels, count, seed, params, ratios, lod_count - 1),
+            };
+            THEN("the cache is a miss")
+            {
+                for (auto const other_key : other_keys) {
+                    REQUIRE(other_key != key);
+                    REQUIRE_FALSE(MeshCache(kCachePath, other_key).valid());
+                }
+            }
+        }
+        WHEN("the file is truncated")
+        {
+            std::vector<char> contents;
+            {
+                std::ifstream file(kCachePath, std::ios::binary);
+                contents.assign(std::istreambuf_iterator<char>(file),
+                                std::istreambuf_iterator<char>());
+            }
+            std::ofstream(kCachePath, std::ios::binary | std::ios::trunc)
+                .write(contents.data(), static_cast<std::streamsize>(contents.size() - 4));
+
+            THEN("the cache is a miss") { REQUIRE_FALSE(MeshCache(kCachePath, key).valid()); }
+        }
+        std::remove(kCachePath);
+    }
+}
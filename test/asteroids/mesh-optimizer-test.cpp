@@ -0,0 +1,330 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+#include "mesh-optimizer.h"
+#include "mesh.h"
+
+namespace {
+
+using Triangle = std::array<float, 9>;
+
+/// @brief The triangles of indices [begin, end) as vertex positions, each
+///     rotated to start at its smallest corner so that reordering triangles
+///     and renumbering vertices does not change the result
+template<typename Index>
+std::vector<Triangle> triangle_positions(BasicMesh<Index> const& mesh, size_t const begin,
+                                         size_t const end)
+{
+    std::vector<Triangle> triangles;
+    for (size_t ii = begin; ii < end; ii += 3) {
+        std::array<Vertex, 3> corners = {mesh.vertices[mesh.indices[ii]],
+                                         mesh.vertices[mesh.indices[ii + 1]],
+                                         mesh.vertices[mesh.indices[ii + 2]]};
+        auto const less = [](Vertex const& a, Vertex const& b) {
+            return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+        };
+        std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end(), less),
+                    corners.end());
+        Triangle triangle;
+        for (size_t corner = 0; corner < 3; ++corner) {
+            triangle[corner * 3 + 0] = corners[corner].x;
+            triangle[corner * 3 + 1] = corners[corner].y;
+            triangle[corner * 3 + 2] = corners[corner].z;
+        }
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+/// @brief Number of edges not shared by exactly one other triangle in the
+///     opposite direction
+template<typename Index>
+size_t unpaired_edges(std::vector<Index> const& indices)
+{
+    std::vector<std::pair<Index, Index>> edges;
+    for (size_t ii = 0; ii < indices.size(); ++ii) {
+        edges.emplace_back(indices[ii], indices[ii - ii % 3 + (ii + 1) % 3]);
+    }
+    std::sort(edges.begin(), edges.end());
+    size_t unpaired = 0;
+    for (auto const& edge : edges) {
+        auto const reverse = std::equal_range(edges.begin(), edges.end(),
+                                              std::make_pair(edge.second, edge.first));
+        unpaired += reverse.second - reverse.first == 1 ? 0 : 1;
+    }
+    return unpaired;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("vertex cache analysis")
+{
+    GIVEN("a strip of two triangles")
+    {
+        uint16_t const indices[] = {0, 1, 2, 2, 1, 3};
+        auto const stats = analyze_vertex_cache(indices, 6, 4);
+        THEN("only the four distinct vertices miss")
+        {
+            REQUIRE(stats.acmr == Approx(2.0));
+            REQUIRE(stats.atvr == Approx(1.0));
+        }
+    }
+    GIVEN("a cache too small to keep a shared vertex")
+    {
+        uint16_t const indices[] = {0, 1, 2, 3, 4, 5, 0, 6, 7};
+        auto const stats = analyze_vertex_cache(indices, 9, 8, 4);
+        THEN("the vertex is transformed twice")
+        {
+            REQUIRE(stats.acmr == Approx(3.0));
+            REQUIRE(stats.atvr == Approx(9.0 / 8.0));
+        }
+    }
+}
+
+TEST_CASE("mesh optimization")
+{
+    GIVEN("a subdivided icosahedron")
+    {
+        Mesh mesh;
+        CreateIcosahedron(&mesh);
+        for (int level = 0; level < 5; ++level) {
+            SubdivideInPlace(&mesh);
+        }
+        auto const before = analyze_vertex_cache(mesh.indices.data(), mesh.indices.size(),
+                                                 mesh.vertices.size());
+        auto const triangles = triangle_positions(mesh, 0, mesh.indices.size());
+
+        WHEN("its triangles are reordered for the vertex cache")
+        {
+            optimize_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+            auto const after = analyze_vertex_cache(mesh.indices.data(), mesh.indices.size(),
+                                                    mesh.vertices.size());
+            INFO("ACMR " << before.acmr << " -> " << after.acmr);
+
+            THEN("the same triangles, with the same winding, miss the cache less often")
+            {
+                REQUIRE(triangle_positions(mesh, 0, mesh.indices.size()) == triangles);
+                REQUIRE(after.acmr < before.acmr);
+                REQUIRE(after.acmr < 0.8);
+                REQUIRE(after.atvr < 1.5);
+            }
+
+            AND_WHEN("its vertices are reordered for fetch")
+            {
+                auto const remap = optimize_vertex_fetch(mesh.indices.data(),
+                                                         mesh.indices.size(), mesh.vertices.size());
+                remap_vertices(&mesh.vertices, remap);
+
+                THEN("vertices are numbered in order of first use")
+                {
+                    IndexType next = 0;
+                    for (auto const index : mesh.indices) {
+                        REQUIRE(index <= next);
+                        if (index == next) {
+                            ++next;
+                        }
+                    }
+                    REQUIRE(next == mesh.vertices.size());
+                }
+                THEN("the mesh and its cache behaviour are unchanged")
+                {
+                    REQUIRE(triangle_positions(mesh, 0, mesh.indices.size()) == triangles);
+                    auto const fetched = analyze_vertex_cache(
+                        mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+                    REQUIRE(fetched.acmr == after.acmr);
+                }
+            }
+        }
+    }
+    GIVEN("geospheres with several levels")
+    {
+        unsigned int const levels = 4;
+        unsigned int offsets[levels + 2] = {};
+        Mesh32 mesh;
+        CreateGeospheres(&mesh, levels, offsets);
+        Mesh32 const original = mesh;
+
+        WHEN("they are optimized")
+        {
+            OptimizeGeospheres(&mesh, levels, offsets);
+
+            THEN("every level keeps its triangles and its own range of vertices")
+            {
+                REQUIRE(mesh.vertices.size() == original.vertices.size());
+                unsigned int first_vertex = 0;
+                for (unsigned int level = 0; level <= levels; ++level) {
+                    INFO("level " << level);
+                    REQUIRE(triangle_positions(mesh, offsets[level], offsets[level + 1]) ==
+                            triangle_positions(original, offsets[level], offsets[level + 1]));
+                    auto const first = mesh.indices.begin();
+                    auto const range = std::minmax_element(first + offsets[level],
+                                                           first + offsets[level + 1]);
+                    unsigned int const level_vertices = (10u << (2 * level)) + 2;
+                    REQUIRE(*range.first == first_vertex);
+                    REQUIRE(*range.second == first_vertex + level_vertices - 1);
+                    first_vertex += level_vertices;
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("mesh simplification")
+{
+    GIVEN("a subdivided icosahedron on the unit sphere")
+    {
+        Mesh mesh;
+        CreateIcosahedron(&mesh);
+        for (int level = 0; level < 4; ++level) {
+            SubdivideInPlace(&mesh);
+        }
+        SpherifyInPlace(&mesh);
+        size_t const index_count = mesh.indices.size();
+        std::vector<IndexType> simplified(index_count);
+
+        WHEN("it is simplified to a quarter of its triangles")
+        {
+            float error = -1.0f;
+            size_t const count = simplify_mesh(
+                simplified.data(), mesh.indices.data(), index_count, &mesh.vertices[0].x,
+                mesh.vertices.size(), sizeof(Vertex), index_count / 4,
+                std::numeric_limits<float>::max(), &error);
+            simplified.resize(count);
+
+            THEN("it is a closed mesh of about that size with the same orientation")
+            {
+                REQUIRE(count <= index_count / 4);
+                REQUIRE(count >= index_count / 5);
+                REQUIRE(unpaired_edges(simplified) == 0);
+                size_t degenerate = 0;
+                size_t outward = 0;
+                for (size_t ii = 0; ii < count; ii += 3) {
+                    Vertex const& a = mesh.vertices[simplified[ii]];
+                    Vertex const& b = mesh.vertices[simplified[ii + 1]];
+                    Vertex const& c = mesh.vertices[simplified[ii + 2]];
+                    degenerate += simplified[ii] == simplified[ii + 1] ||
+                                          simplified[ii + 1] == simplified[ii + 2] ||
+                                          simplified[ii + 2] == simplified[ii]
+                                      ? 1
+                                      : 0;
+                    // The geospheres' triangles face inwards
+                    float const e1[] = {b.x - a.x, b.y - a.y, b.z - a.z};
+                    float const e2[] = {c.x - a.x, c.y - a.y, c.z - a.z};
+                    float const normal[] = {e1[1] * e2[2] - e1[2] * e2[1],
+                                            e1[2] * e2[0] - e1[0] * e2[2],
+                                            e1[0] * e2[1] - e1[1] * e2[0]};
+                    outward += normal[0] * a.x + normal[1] * a.y + normal[2] * a.z < 0.0f ? 0 : 1;
+                }
+                REQUIRE(degenerate == 0);
+                REQUIRE(outward == 0);
+            }
+            THEN("the error is about the distance from the sphere to the flat triangles")
+            {
+                float worst = 0.0f;
+                for (size_t ii = 0; ii < count; ii += 3) {
+                    float centroid[3] = {};
+                    for (size_t corner = 0; corner < 3; ++corner) {
+                        auto const& v = mesh.vertices[simplified[ii + corner]];
+                        centroid[0] += v.x / 3.0f;
+                        centroid[1] += v.y / 3.0f;
+                        centroid[2] += v.z / 3.0f;
+                    }
+                    float const length = std::sqrt(centroid[0] * centroid[0] +
+                                                   centroid[1] * centroid[1] +
+                                                   centroid[2] * centroid[2]);
+                    worst = std::max(worst, 1.0f - length);
+                }
+                INFO("error " << error << ", centroid depth " << worst);
+                REQUIRE(error > 0.0f);
+                REQUIRE(error < 4.0f * worst);
+                REQUIRE(worst < 4.0f * error);
+            }
+        }
+        WHEN("the error allowed is smaller than any collapse needs")
+        {
+            float error = -1.0f;
+            size_t const count = simplify_mesh(simplified.data(), mesh.indices.data(), index_count,
+                                               &mesh.vertices[0].x, mesh.vertices.size(),
+                                               sizeof(Vertex), 0, 1e-6f, &error);
+            THEN("nothing changes")
+            {
+                REQUIRE(count == index_count);
+                REQUIRE(simplified == mesh.indices);
+                REQUIRE(error == 0.0f);
+            }
+        }
+    }
+    GIVEN("a flat grid")
+    {
+        uint32_t const size = 8;
+        std::vector<float> positions;
+        for (uint32_t yy = 0; yy <= size; ++yy) {
+            for (uint32_t xx = 0; xx <= size; ++xx) {
+                positions.insert(positions.end(),
+                                 {static_cast<float>(xx), static_cast<float>(yy), 0.0f});
+            }
+        }
+        std::vector<uint32_t> indices;
+        for (uint32_t yy = 0; yy < size; ++yy) {
+            for (uint32_t xx = 0; xx < size; ++xx) {
+                uint32_t const corner = yy * (size + 1) + xx;
+                indices.insert(indices.end(), {corner, corner + 1, corner + size + 2});
+                indices.insert(indices.end(), {corner, corner + size + 2, corner + size + 1});
+            }
+        }
+
+        WHEN("it is simplified as far as it goes")
+        {
+            std::vector<uint32_t> simplified(indices.size());
+            float error = -1.0f;
+            simplified.resize(simplify_mesh(simplified.data(), indices.data(), indices.size(),
+                                            positions.data(), positions.size() / 3,
+                                            3 * sizeof(float), 0, 0.0f, &error));
+
+            THEN("only the border vertices remain, with no error")
+            {
+                REQUIRE(!simplified.empty());
+                REQUIRE(simplified.size() < indices.size() / 2);
+                REQUIRE(error == 0.0f);
+                for (auto const index : simplified) {
+                    size_t const xx = index % (size + 1);
+                    size_t const yy = index / (size + 1);
+                    REQUIRE((xx == 0 || yy == 0 || xx == size || yy == size));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("mesh optimization benchmark", "[.][benchmark]")
+{
+    unsigned int const levels = 7;
+    unsigned int offsets[levels + 2] = {};
+    Mesh32 mesh;
+    CreateGeospheres(&mesh, levels, offsets);
+    Mesh32 optimized = mesh;
+    auto const start = std::chrono::high_resolution_clock::now();
+    OptimizeGeospheres(&optimized, levels, offsets);
+    auto const end = std::chrono::high_resolution_clock::now();
+
+    for (unsigned int level = 0; level <= levels; ++level) {
+        size_t const count = offsets[level + 1] - offsets[level];
+        auto const before = analyze_vertex_cache(mesh.indices.data() + offsets[level], count,
+                                                 mesh.vertices.size());
+        auto const after = analyze_vertex_cache(optimized.indices.data() + offsets[level], count,
+                                                optimized.vertices.size());
+        std::cout << "level " << level << ": ACMR " << before.acmr << " -> " << after.acmr
+                  << ", ATVR " << before.atvr << " -> " << after.atvr << "\n";
+    }
+    std::cout << "optimize levels 0-" << levels << ": "
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+}
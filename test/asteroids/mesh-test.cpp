@@ -0,0 +1,559 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "job-system.h"
+#include "mesh.h"
+
+namespace {
+
+/// @brief Subdivision levels whose vertices still fit in `IndexType`
+constexpr int kMaxSubdivLevel = 6;
+/// @brief Deepest level tested with 32-bit indices
+constexpr int kMaxSubdivLevel32 = 7;
+
+template<typename Index>
+void check_subdivision(int const max_level)
+{
+    BasicMesh<Index> mesh;
+    CreateIcosahedron(&mesh);
+    for (int level = 1; level <= max_level; ++level) {
+        INFO("level " << level);
+        SubdivideInPlace(&mesh);
+
+        size_t const faces = size_t{20} << (2 * level);
+        REQUIRE(mesh.indices.size() == faces * 3);
+        // Euler: V - E + F = 2 with E = 3F / 2
+        REQUIRE(mesh.vertices.size() == faces / 2 + 2);
+
+        REQUIRE(size_t{*std::max_element(mesh.indices.begin(), mesh.indices.end())} <
+                mesh.vertices.size());
+        std::vector<std::pair<Index, Index>> edges;
+        edges.reserve(mesh.indices.size());
+        for (size_t ii = 0; ii < mesh.indices.size(); ii += 3) {
+            for (size_t jj = 0; jj < 3; ++jj) {
+                Index const a = mesh.indices[ii + jj];
+                Index const b = mesh.indices[ii + (jj + 1) % 3];
+                edges.emplace_back(std::min(a, b), std::max(a, b));
+            }
+        }
+        // Every edge is shared by exactly two faces
+        std::sort(edges.begin(), edges.end());
+        size_t unpaired = 0;
+        for (size_t ii = 0; ii < edges.size(); ii += 2) {
+            bool const paired = edges[ii] == edges[ii + 1] &&
+                                (ii + 2 == edges.size() || edges[ii + 2] != edges[ii]);
+            unpaired += paired ? 0 : 1;
+        }
+        REQUIRE(unpaired == 0);
+    }
+}
+
+}  // anonymous namespace
+
+TEST_CASE("mesh subdivision")
+{
+    GIVEN("an icosahedron")
+    {
+        WHEN("it is subdivided repeatedly")
+        {
+            THEN("every level is a closed mesh with no duplicate midpoints")
+            {
+                check_subdivision<IndexType>(kMaxSubdivLevel);
+            }
+        }
+        WHEN("it is subdivided past 65535 vertices with 32-bit indices")
+        {
+            THEN("every level is a closed mesh with no duplicate midpoints")
+            {
+                check_subdivision<unsigned int>(kMaxSubdivLevel32);
+            }
+        }
+    }
+}
+
+TEST_CASE("geospheres")
+{
+    GIVEN("geospheres with several subdivision levels")
+    {
+        unsigned int const levels = 3;
+        unsigned int offsets[levels + 2] = {};
+        Mesh mesh;
+        CreateGeospheres(&mesh, levels, offsets);
+
+        THEN("each level starts where the previous one ends")
+        {
+            REQUIRE(offsets[0] == 0);
+            for (unsigned int level = 0; level <= levels; ++level) {
+                REQUIRE(offsets[level + 1] - offsets[level] == (60u << (2 * level)));
+            }
+            REQUIRE(offsets[levels + 1] == mesh.indices.size());
+        }
+        THEN("every vertex of every level lies on the unit sphere")
+        {
+            for (auto const& v : mesh.vertices) {
+                REQUIRE(std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z) == Approx(1.0f));
+            }
+        }
+    }
+}
+
+TEST_CASE("32-bit geospheres")
+{
+    GIVEN("geospheres with more vertices than 16-bit indices can address")
+    {
+        unsigned int const levels = 7;
+        unsigned int offsets[levels + 2] = {};
+        Mesh32 mesh;
+        CreateGeospheres(&mesh, levels, offsets);
+
+        THEN("the finest level addresses its own vertices, past 65535")
+        {
+            size_t const finest_vertices = (size_t{10} << (2 * levels)) + 2;
+            REQUIRE(mesh.vertices.size() > 65536);
+            REQUIRE(offsets[levels + 1] == mesh.indices.size());
+            auto const finest = std::minmax_element(mesh.indices.begin() + offsets[levels],
+                                                    mesh.indices.end());
+            REQUIRE(*finest.first == mesh.vertices.size() - finest_vertices);
+            REQUIRE(*finest.second == mesh.vertices.size() - 1);
+        }
+    }
+}
+
+TEST_CASE("asteroid mesh generation")
+{
+    unsigned int const levels = 2;
+    unsigned int const seed = 1234;
+
+    GIVEN("asteroids generated serially")
+    {
+        unsigned int const count = 37;
+        unsigned int offsets[levels + 2] = {};
+        unsigned int vertices_per_mesh = 0;
+        Mesh serial;
+        CreateAsteroidsFromGeospheres(&serial, levels, count, seed, offsets, &vertices_per_mesh);
+        REQUIRE(serial.vertices.size() == count * vertices_per_mesh);
+
+        THEN("generating them in parallel gives identical vertices")
+        {
+            JobSystem jobs(4);
+            Mesh parallel;
+            CreateAsteroidsFromGeospheres(&parallel, levels, count, seed, offsets,
+                                          &vertices_per_mesh, &jobs);
+            REQUIRE(parallel.indices == serial.indices);
+            REQUIRE(parallel.vertices.size() == serial.vertices.size());
+            REQUIRE(memcmp(parallel.vertices.data(), serial.vertices.data(),
+                           serial.vertices.size() * sizeof(Vertex)) == 0);
+        }
+        THEN("each mesh only depends on the seed and its own index")
+        {
+            Mesh fewer;
+            CreateAsteroidsFromGeospheres(&fewer, levels, 5, seed, offsets, &vertices_per_mesh);
+            REQUIRE(memcmp(fewer.vertices.data(), serial.vertices.data(),
+                           fewer.vertices.size() * sizeof(Vertex)) == 0);
+        }
+        THEN("different meshes differ")
+        {
+            REQUIRE(memcmp(serial.vertices.data(), serial.vertices.data() + vertices_per_mesh,
+                           vertices_per_mesh * sizeof(Vertex)) != 0);
+        }
+    }
+}
+
+TEST_CASE("asteroid normals")
+{
+    GIVEN("asteroids with normals from the analytic noise gradient")
+    {
+        unsigned int const levels = 5;
+        unsigned int const count = levels;
+        unsigned int offsets[levels + 2] = {};
+        unsigned int vertices_per_mesh = 0;
+        Mesh mesh;
+        CreateAsteroidsFromGeospheres(&mesh, levels, count, 99, offsets, &vertices_per_mesh);
+
+        THEN("they are unit length and agree with normals averaged from the faces")
+        {
+            for (auto const& v : mesh.vertices) {
+                REQUIRE(std::sqrt(v.nx * v.nx + v.ny * v.ny + v.nz * v.nz) == Approx(1.0f));
+            }
+
+            // Only the finest level is dense enough for the face average to
+            // approximate the surface well
+            for (size_t m = 0; m < count; ++m) {
+                INFO("mesh " << m);
+                auto const first = mesh.vertices.begin() + m * vertices_per_mesh;
+                Mesh faces;
+                faces.vertices.assign(first, first + vertices_per_mesh);
+                faces.indices.assign(mesh.indices.begin() + offsets[levels],
+                                     mesh.indices.begin() + offsets[levels + 1]);
+                ComputeAvgNormalsInPlace(&faces);
+
+                std::vector<bool> on_finest_level(vertices_per_mesh, false);
+                for (auto const index : faces.indices) {
+                    on_finest_level[index] = true;
+                }
+                double sum = 0.0;
+                size_t compared = 0;
+                for (size_t ii = 0; ii < vertices_per_mesh; ++ii) {
+                    if (on_finest_level[ii]) {
+                        auto const& v = first[ii];
+                        auto const& f = faces.vertices[ii];
+                        float const agreement = v.nx * f.nx + v.ny * f.ny + v.nz * f.nz;
+                        REQUIRE(agreement > 0.9f);
+                        sum += agreement;
+                        ++compared;
+                    }
+                }
+                REQUIRE(sum / compared > 0.99);
+            }
+        }
+    }
+}
+
+TEST_CASE("packed vertices")
+{
+    GIVEN("unit normals in every octant and along the axes")
+    {
+        std::vector<Vertex> normals;
+        float const axes[][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0},
+                                 {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+        for (auto const& axis : axes) {
+            normals.push_back({0, 0, 0, axis[0], axis[1], axis[2]});
+        }
+        std::mt19937 rng(5);
+        std::normal_distribution<float> gaussian;
+        for (int ii = 0; ii < 10000; ++ii) {
+            float const x = gaussian(rng);
+            float const y = gaussian(rng);
+            float const z = gaussian(rng);
+            float const n = 1.0f / std::sqrt(x * x + y * y + z * z);
+            normals.push_back({0, 0, 0, x * n, y * n, z * n});
+        }
+
+        THEN("they survive octahedral encoding to within a hundredth of a degree")
+        {
+            for (auto const& v : normals) {
+                INFO("normal " << v.nx << ", " << v.ny << ", " << v.nz);
+                short ex = 0;
+                short ey = 0;
+                EncodeOctahedralNormal(v.nx, v.ny, v.nz, &ex, &ey);
+                float nx = 0.0f;
+                float ny = 0.0f;
+                float nz = 0.0f;
+                DecodeOctahedralNormal(ex, ey, &nx, &ny, &nz);
+                // chord length, which for small errors is the angle in radians
+                float const dx = nx - v.nx;
+                float const dy = ny - v.ny;
+                float const dz = nz - v.nz;
+                REQUIRE(std::sqrt(dx * dx + dy * dy + dz * dz) < 0.01f * 3.14159265f / 180);
+            }
+        }
+    }
+    GIVEN("asteroids generated straight into the packed format")
+    {
+        unsigned int const levels = 2;
+        unsigned int const count = 9;
+        unsigned int offsets[levels + 2] = {};
+        unsigned int vertices_per_mesh = 0;
+        JobSystem jobs(3);
+        PackedMesh packed;
+        CreateAsteroidsFromGeospheres(&packed, levels, count, 42, offsets, &vertices_per_mesh,
+                                      &jobs);
+        Mesh mesh;
+        CreateAsteroidsFromGeospheres(&mesh, levels, count, 42, offsets, &vertices_per_mesh);
+
+        THEN("they are the full precision meshes, packed")
+        {
+            REQUIRE(sizeof(PackedVertex) == 12);
+            REQUIRE(packed.indices == mesh.indices);
+            REQUIRE(packed.vertices.size() == mesh.vertices.size());
+            REQUIRE(packed.positionScales.size() == count);
+            for (unsigned int m = 0; m < count; ++m) {
+                Vertex const* const first = mesh.vertices.data() + m * vertices_per_mesh;
+                float const scale = ComputePositionScale(first, vertices_per_mesh);
+                REQUIRE(packed.positionScales[m] == scale);
+
+                std::vector<PackedVertex> expected(vertices_per_mesh);
+                PackVertices(first, vertices_per_mesh, scale, expected.data());
+                REQUIRE(memcmp(expected.data(), packed.vertices.data() + m * vertices_per_mesh,
+                               vertices_per_mesh * sizeof(PackedVertex)) == 0);
+            }
+        }
+        THEN("positions are within a quantization step")
+        {
+            for (size_t ii = 0; ii < mesh.vertices.size(); ++ii) {
+                auto const& v = mesh.vertices[ii];
+                auto const& p = packed.vertices[ii];
+                float const step = packed.positionScales[ii / vertices_per_mesh] / 32767.0f;
+                REQUIRE(p.w == 32767);
+                REQUIRE(std::abs(p.x * step - v.x) <= step);
+                REQUIRE(std::abs(p.y * step - v.y) <= step);
+                REQUIRE(std::abs(p.z * step - v.z) <= step);
+            }
+        }
+    }
+}
+
+TEST_CASE("meshlets")
+{
+    GIVEN("asteroids generated with meshlets")
+    {
+        unsigned int const levels = 4;
+        unsigned int const count = 4;
+        unsigned int offsets[levels + 2] = {};
+        unsigned int vertices_per_mesh = 0;
+        PackedMesh packed;
+        CreateAsteroidsFromGeospheres(&packed, levels, count, 42, offsets, &vertices_per_mesh);
+        Mesh mesh;
+        CreateAsteroidsFromGeospheres(&mesh, levels, count, 42, offsets, &vertices_per_mesh);
+        auto const& meshlets = packed.meshlets;
+        REQUIRE(!meshlets.empty());
+
+        THEN("they split the most detailed level in order, within the limits")
+        {
+            unsigned int next = offsets[levels];
+            std::vector<unsigned int> used;
+            for (auto const& meshlet : meshlets) {
+                REQUIRE(meshlet.indexOffset == next);
+                REQUIRE(meshlet.indexCount % 3 == 0);
+                REQUIRE(meshlet.indexCount > 0);
+                REQUIRE(meshlet.indexCount <= 3 * kMeshletMaxTriangles);
+                used.assign(packed.indices.begin() + meshlet.indexOffset,
+                            packed.indices.begin() + meshlet.indexOffset + meshlet.indexCount);
+                std::sort(used.begin(), used.end());
+                auto const vertices =
+                    static_cast<size_t>(std::unique(used.begin(), used.end()) - used.begin());
+                REQUIRE(vertices <= kMeshletMaxVertices);
+                next += meshlet.indexCount;
+            }
+            REQUIRE(next == offsets[levels + 1]);
+            // Tipsify order keeps the greedy clusters compact
+            size_t const triangles = (offsets[levels + 1] - offsets[levels]) / 3;
+            REQUIRE(triangles / meshlets.size() >= 64);
+        }
+        THEN("each instance's bounds contain its meshlets' vertices and face normals")
+        {
+            REQUIRE(packed.meshletBounds.size() == count * meshlets.size());
+            for (unsigned int m = 0; m < count; ++m) {
+                Vertex const* const vertices = mesh.vertices.data() + m * vertices_per_mesh;
+                for (size_t ii = 0; ii < meshlets.size(); ++ii) {
+                    auto const& bounds = packed.meshletBounds[m * meshlets.size() + ii];
+                    float const min_dot = bounds.coneCutoff < 1.0f
+                                              ? std::sqrt(1.0f - bounds.coneCutoff *
+                                                                     bounds.coneCutoff)
+                                              : -1.0f;
+                    size_t outside = 0;
+                    size_t outside_cone = 0;
+                    auto const first = mesh.indices.begin() + meshlets[ii].indexOffset;
+                    for (auto index = first; index != first + meshlets[ii].indexCount;
+                         index += 3) {
+                        Vertex const& a = vertices[index[0]];
+                        Vertex const& b = vertices[index[1]];
+                        Vertex const& c = vertices[index[2]];
+                        for (auto const* v : {&a, &b, &c}) {
+                            float const dx = v->x - bounds.center[0];
+                            float const dy = v->y - bounds.center[1];
+                            float const dz = v->z - bounds.center[2];
+                            bool const inside = std::sqrt(dx * dx + dy * dy + dz * dz) <=
+                                                bounds.radius * 1.0001f;
+                            outside += inside ? 0 : 1;
+                        }
+                        // Outward normal of a clockwise front face
+                        float const e1[] = {c.x - a.x, c.y - a.y, c.z - a.z};
+                        float const e2[] = {b.x - a.x, b.y - a.y, b.z - a.z};
+                        float const n[] = {e1[1] * e2[2] - e1[2] * e2[1],
+                                           e1[2] * e2[0] - e1[0] * e2[2],
+                                           e1[0] * e2[1] - e1[1] * e2[0]};
+                        float const dot = n[0] * bounds.coneAxis[0] + n[1] * bounds.coneAxis[1] +
+                                          n[2] * bounds.coneAxis[2];
+                        float const length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                        outside_cone += dot >= (min_dot - 1e-4f) * length ? 0 : 1;
+                    }
+                    REQUIRE(outside == 0);
+                    REQUIRE(outside_cone == 0);
+                }
+            }
+        }
+        THEN("most meshlets have a cone narrow enough to cull with")
+        {
+            size_t const cullable = static_cast<size_t>(
+                std::count_if(packed.meshletBounds.begin(), packed.meshletBounds.end(),
+                              [](MeshletBounds const& b) { return b.coneCutoff < 1.0f; }));
+            REQUIRE(cullable * 2 > packed.meshletBounds.size());
+        }
+    }
+}
+
+TEST_CASE("asteroid levels of detail")
+{
+    GIVEN("asteroids simplified into levels of detail")
+    {
+        unsigned int const levels = 3;
+        unsigned int const count = 5;
+        unsigned int offsets[levels + 2] = {};
+        unsigned int vertices_per_mesh = 0;
+        float const ratios[] = {1.0f / 64.0f, 1.0f / 16.0f, 1.0f / 4.0f};
+        unsigned int const lod_count = 3;
+        PackedMesh mesh;
+        CreateAsteroidsFromGeospheres(&mesh, levels, count, 42, offsets, &vertices_per_mesh);
+        PackedMesh parallel = mesh;
+        SimplifyAsteroidLods(&mesh, levels, offsets, vertices_per_mesh, ratios, lod_count);
+        JobSystem jobs(3);
+        SimplifyAsteroidLods(&parallel, levels, offsets, vertices_per_mesh, ratios, lod_count,
+                             &jobs);
+
+        THEN("every level is about its share of the full detail triangles")
+        {
+            REQUIRE(mesh.lodIndexOffsets.size() == count * lod_count + 1);
+            REQUIRE(mesh.lodIndexOffsets.front() == offsets[levels + 1]);
+            REQUIRE(mesh.lodIndexOffsets.back() == mesh.indices.size());
+            unsigned int const full_count = offsets[levels + 1] - offsets[levels];
+            for (unsigned int m = 0; m < count; ++m) {
+                for (unsigned int l = 0; l < lod_count; ++l) {
+                    INFO("mesh " << m << " level " << l);
+                    auto const begin = mesh.lodIndexOffsets[m * lod_count + l];
+                    auto const end = mesh.lodIndexOffsets[m * lod_count + l + 1];
+                    auto const target = static_cast<float>(full_count) * ratios[l];
+                    REQUIRE(end - begin <= target);
+                    REQUIRE(end - begin >= target * 0.75f);
+                    REQUIRE((end - begin) % 3 == 0);
+                }
+            }
+        }
+        THEN("they only use the vertices of the full detail level")
+        {
+            auto const full = std::minmax_element(mesh.indices.begin() + offsets[levels],
+                                                  mesh.indices.begin() + offsets[levels + 1]);
+            auto const used = std::minmax_element(
+                mesh.indices.begin() + mesh.lodIndexOffsets.front(), mesh.indices.end());
+            REQUIRE(*used.first >= *full.first);
+            REQUIRE(*used.second <= *full.second);
+        }
+        THEN("errors shrink from coarse to fine")
+        {
+            REQUIRE(mesh.lodErrors.size() == count * lod_count);
+            for (unsigned int m = 0; m < count; ++m) {
+                float const* const errors = mesh.lodErrors.data() + m * lod_count;
+                REQUIRE(errors[lod_count - 1] > 0.0f);
+                for (unsigned int l = 1; l < lod_count; ++l) {
+                    REQUIRE(errors[l] <= errors[l - 1]);
+                }
+            }
+        }
+        THEN("simplifying in parallel gives the same levels")
+        {
+            REQUIRE(parallel.indices == mesh.indices);
+            REQUIRE(parallel.lodIndexOffsets == mesh.lodIndexOffsets);
+            REQUIRE(parallel.lodErrors == mesh.lodErrors);
+        }
+        WHEN("the coarse geosphere levels are dropped")
+        {
+            PackedMesh dropped = mesh;
+            unsigned int dropped_offsets[levels + 2] = {};
+            std::copy(offsets, offsets + levels + 2, dropped_offsets);
+            unsigned int dropped_vertices_per_mesh = vertices_per_mesh;
+            DropCoarseGeosphereLevels(&dropped, levels, dropped_offsets,
+                                      &dropped_vertices_per_mesh);
+
+            THEN("only the full detail and simplified levels are left, at the same indices")
+            {
+                auto const removed = offsets[levels];
+                for (unsigned int l = 0; l <= levels; ++l) {
+                    REQUIRE(dropped_offsets[l] == 0);
+                }
+                REQUIRE(dropped_offsets[levels + 1] == offsets[levels + 1] - removed);
+                REQUIRE(dropped.indices.size() == mesh.indices.size() - removed);
+                REQUIRE(dropped.meshlets.size() == mesh.meshlets.size());
+                for (size_t ii = 0; ii < mesh.meshlets.size(); ++ii) {
+                    REQUIRE(dropped.meshlets[ii].indexOffset ==
+                            mesh.meshlets[ii].indexOffset - removed);
+                }
+                for (size_t ii = 0; ii < mesh.lodIndexOffsets.size(); ++ii) {
+                    REQUIRE(dropped.lodIndexOffsets[ii] == mesh.lodIndexOffsets[ii] - removed);
+                }
+            }
+            THEN("each instance keeps only the full detail vertices, which the indices use")
+            {
+                auto const full_vertices = (10u << (2 * levels)) + 2;
+                auto const first_vertex = vertices_per_mesh - full_vertices;
+                REQUIRE(dropped_vertices_per_mesh == full_vertices);
+                REQUIRE(dropped.vertices.size() == count * full_vertices);
+                for (unsigned int m = 0; m < count; ++m) {
+                    REQUIRE(memcmp(dropped.vertices.data() + m * full_vertices,
+                                   mesh.vertices.data() + m * vertices_per_mesh + first_vertex,
+                                   full_vertices * sizeof(PackedVertex)) == 0);
+                }
+                auto const removed = offsets[levels];
+                for (size_t ii = 0; ii < dropped.indices.size(); ++ii) {
+                    REQUIRE(dropped.indices[ii] + first_vertex == mesh.indices[removed + ii]);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("asteroid mesh generation benchmark", "[.][benchmark]")
+{
+    unsigned int const count = 10000;
+    unsigned int offsets[5] = {};
+    unsigned int vertices_per_mesh = 0;
+    JobSystem jobs;
+    Mesh mesh;
+    auto const start = std::chrono::high_resolution_clock::now();
+    CreateAsteroidsFromGeospheres(&mesh, 3, count, 1234, offsets, &vertices_per_mesh, &jobs);
+    auto const end = std::chrono::high_resolution_clock::now();
+    std::cout << count << " asteroid meshes on " << jobs.num_threads() << " threads: "
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+}
+
+TEST_CASE("asteroid simplification benchmark", "[.][benchmark]")
+{
+    unsigned int const count = 1000;
+    unsigned int offsets[5] = {};
+    unsigned int vertices_per_mesh = 0;
+    float const ratios[] = {1.0f / 64.0f, 1.0f / 16.0f, 1.0f / 4.0f};
+    JobSystem jobs;
+    PackedMesh mesh;
+    CreateAsteroidsFromGeospheres(&mesh, 3, count, 1234, offsets, &vertices_per_mesh, &jobs);
+    auto const start = std::chrono::high_resolution_clock::now();
+    SimplifyAsteroidLods(&mesh, 3, offsets, vertices_per_mesh, ratios, 3, &jobs);
+    auto const end = std::chrono::high_resolution_clock::now();
+    std::cout << "simplify " << count << " asteroid meshes on " << jobs.num_threads()
+              << " threads: " << std::chrono::duration<double, std::milli>(end - start).count()
+              << " ms\n";
+    float mean_errors[3] = {};
+    for (unsigned int m = 0; m < count; ++m) {
+        for (unsigned int l = 0; l < 3; ++l) {
+            mean_errors[l] += mesh.lodErrors[m * 3 + l] / count;
+        }
+    }
+    std::cout << "mean error per level: " << mean_errors[0] << ", " << mean_errors[1] << ", "
+              << mean_errors[2] << "\n";
+}
+
+TEST_CASE("mesh subdivision benchmark", "[.][benchmark]")
+{
+    int const repetitions = 10;
+    for (int level = 1; level <= kMaxSubdivLevel32; ++level) {
+        double best = 1.0e9;
+        for (int rep = 0; rep < repetitions; ++rep) {
+            Mesh32 mesh;
+            CreateIcosahedron(&mesh);
+            for (int ii = 1; ii < level; ++ii) {
+                SubdivideInPlace(&mesh);
+            }
+            auto const start = std::chrono::high_resolution_clock::now();
+            SubdivideInPlace(&mesh);
+            auto const end = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        std::cout << "subdivide to level " << level << ": " << best << " ms\n";
+    }
+}
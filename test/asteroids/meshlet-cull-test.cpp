@@ -0,0 +1,173 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "asteroid-field.h"
+#include "mesh.h"
+#include "meshlet-cull.h"
+
+namespace {
+
+// A perspective projection from the origin looking down +z with a 90 degree
+// field of view: clip = (x, y, 1, z). The side planes are z = |x| and z = |y|.
+mathfu::float4x4 const kViewproj(1.0f, 0.0f, 0.0f, 0.0f,  //
+                                 0.0f, 1.0f, 0.0f, 0.0f,  //
+                                 0.0f, 0.0f, 0.0f, 1.0f,  //
+                                 0.0f, 0.0f, 1.0f, 0.0f);
+mathfu::float3 const kCamera(0.0f, 0.0f, 0.0f);
+
+/// @brief Meshlet bounds of a sphere at `center` and a cone around `axis`
+MeshletBounds make_bounds(mathfu::float3 const& center, float const radius,
+                          mathfu::float3 const& axis, float const cutoff)
+{
+    return {{center.x, center.y, center.z}, radius, {axis.x, axis.y, axis.z}, cutoff};
+}
+
+}  // anonymous namespace
+
+TEST_CASE("meshlet culling")
+{
+    MeshletCuller const culler(kViewproj, kCamera);
+    mathfu::float4x4 const identity = mathfu::float4x4::Identity();
+    Meshlet const meshlets[] = {{0, 30}, {30, 60}, {90, 12}};
+    std::vector<IndexRange> ranges(3);
+
+    GIVEN("meshlets in front of the camera, facing it")
+    {
+        MeshletBounds const bounds[] = {
+            make_bounds({0.0f, 0.0f, 10.0f}, 1.0f, {0.0f, 0.0f, -1.0f}, 0.5f),
+            make_bounds({1.0f, 0.0f, 10.0f}, 1.0f, {0.0f, 0.0f, -1.0f}, 0.5f),
+            make_bounds({2.0f, 0.0f, 10.0f}, 1.0f, {0.0f, 0.0f, -1.0f}, 0.5f),
+        };
+        THEN("they are drawn as a single range")
+        {
+            REQUIRE(culler.cull(identity, 1.0f, meshlets, bounds, 3, ranges.data()) == 1);
+            REQUIRE(ranges[0].first_index == 0);
+            REQUIRE(ranges[0].index_count == 102);
+        }
+    }
+    GIVEN("a meshlet facing away from the camera between two facing it")
+    {
+        MeshletBounds const bounds[] = {
+            make_bounds({0.0f, 0.0f, 10.0f}, 1.0f, {0.0f, 0.0f, -1.0f}, 0.5f),
+            make_bounds({0.0f, 0.0f, 10.0f}, 1.0f, {0.0f, 0.0f, 1.0f}, 0.5f),
+            make_bounds({0.0f, 0.0f, 10.0f}, 1.0f, {0.0f, 0.0f, -1.0f}, 0.5f),
+        };
+        THEN("it is culled and the others are drawn separately")
+        {
+            REQUIRE(culler.cull(identity, 1.0f, meshlets, bounds, 3, ranges.data()) == 2);
+            REQUIRE(ranges[0].first_index == 0);
+            REQUIRE(ranges[0].index_count == 30);
+            REQUIRE(ranges[1].first_index == 90);
+            REQUIRE(ranges[1].index_count == 12);
+        }
+        THEN("a cone too wide to cull with keeps it")
+        {
+            MeshletBounds wide[] = {bounds[0], bounds[1], bounds[2]};
+            wide[1].coneCutoff = 1.0f;
+            REQUIRE(culler.cull(identity, 1.0f, meshlets, wide, 3, ranges.data()) == 1);
+        }
+    }
+    GIVEN("meshlets outside the frustum")
+    {
+        MeshletBounds const bounds[] = {
+            make_bounds({20.0f, 0.0f, 10.0f}, 1.0f, {0.0f, 0.0f, -1.0f}, 1.0f),
+            make_bounds({0.0f, -20.0f, 10.0f}, 1.0f, {0.0f, 0.0f, -1.0f}, 1.0f),
+            make_bounds({0.0f, 0.0f, -10.0f}, 1.0f, {0.0f, 0.0f, 1.0f}, 1.0f),
+        };
+        THEN("they are culled, unless the instance transform moves them into it")
+        {
+            REQUIRE(culler.cull(identity, 1.0f, meshlets, bounds, 3, ranges.data()) == 0);
+            mathfu::float4x4 const scaled(0.5f, 0.0f, 0.0f, 0.0f,  //
+                                          0.0f, 0.5f, 0.0f, 0.0f,  //
+                                          0.0f, 0.0f, 0.5f, 0.0f,  //
+                                          0.0f, 0.0f, 10.0f, 1.0f);
+            REQUIRE(culler.cull(scaled, 0.5f, meshlets, bounds, 3, ranges.data()) == 1);
+            REQUIRE(ranges[0].first_index == 0);
+            REQUIRE(ranges[0].index_count == 102);
+        }
+    }
+}
+
+TEST_CASE("meshlet culling of asteroids")
+{
+    GIVEN("asteroids in and around the frustum, in random orientations")
+    {
+        unsigned int const levels = 4;
+        unsigned int const count = 4;
+        unsigned int offsets[levels + 2] = {};
+        unsigned int vertices_per_mesh = 0;
+        PackedMesh packed;
+        CreateAsteroidsFromGeospheres(&packed, levels, count, 42, offsets, &vertices_per_mesh);
+        Mesh mesh;
+        CreateAsteroidsFromGeospheres(&mesh, levels, count, 42, offsets, &vertices_per_mesh);
+        auto const& meshlets = packed.meshlets;
+
+        std::mt19937 gen(99);
+        std::uniform_real_distribution<float> position_dist(-8.0f, 8.0f);
+        std::uniform_real_distribution<float> depth_dist(0.0f, 12.0f);
+        std::uniform_real_distribution<float> scale_dist(0.5f, 3.0f);
+        std::normal_distribution<float> axis_dist;
+        size_t const placements = 64;
+        AsteroidField field;
+        field.allocate(placements);
+        for (size_t ii = 0; ii < placements; ++ii) {
+            auto const axis =
+                mathfu::float3(axis_dist(gen), axis_dist(gen), axis_dist(gen)).Normalized();
+            field.set_transform(
+                ii, {position_dist(gen), position_dist(gen), depth_dist(gen)},
+                mathfu::Quaternion<float>::FromAngleAxis(position_dist(gen), axis),
+                scale_dist(gen));
+        }
+
+        THEN("every triangle facing the camera inside the frustum is kept")
+        {
+            MeshletCuller const culler(kViewproj, kCamera);
+            std::vector<IndexRange> ranges(meshlets.size());
+            size_t kept_triangles = 0;
+            size_t all_triangles = 0;
+            size_t missing = 0;
+            for (size_t ii = 0; ii < placements; ++ii) {
+                size_t const m = ii % count;
+                auto const world = field.world(ii);
+                auto const range_count =
+                    culler.cull(world, field.scale[ii], meshlets.data(),
+                                packed.meshletBounds.data() + m * meshlets.size(),
+                                meshlets.size(), ranges.data());
+                std::vector<bool> kept(mesh.indices.size() / 3, false);
+                for (size_t rr = 0; rr < range_count; ++rr) {
+                    for (uint32_t jj = 0; jj < ranges[rr].index_count; jj += 3) {
+                        kept[(ranges[rr].first_index + jj) / 3] = true;
+                    }
+                    kept_triangles += ranges[rr].index_count / 3;
+                }
+                all_triangles += (offsets[levels + 1] - offsets[levels]) / 3;
+
+                Vertex const* const vertices = mesh.vertices.data() + m * vertices_per_mesh;
+                for (unsigned int jj = offsets[levels]; jj < offsets[levels + 1]; jj += 3) {
+                    mathfu::float3 p[3];
+                    bool inside = false;
+                    for (unsigned int corner = 0; corner < 3; ++corner) {
+                        auto const& v = vertices[mesh.indices[jj + corner]];
+                        p[corner] = (world * mathfu::float4(v.x, v.y, v.z, 1.0f)).xyz();
+                        inside = inside || (p[corner].z >= std::abs(p[corner].x) &&
+                                            p[corner].z >= std::abs(p[corner].y));
+                    }
+                    // Clockwise front faces
+                    auto const normal = mathfu::float3::CrossProduct(p[2] - p[0], p[1] - p[0]);
+                    bool const facing = mathfu::float3::DotProduct(normal, kCamera - p[0]) > 0.0f;
+                    if (inside && facing && !kept[jj / 3]) {
+                        ++missing;
+                    }
+                }
+            }
+            REQUIRE(missing == 0);
+            // and a good share of the rest is culled
+            INFO(kept_triangles << " of " << all_triangles << " triangles kept");
+            REQUIRE(kept_triangles * 10 < all_triangles * 7);
+        }
+    }
+}
@@ -0,0 +1,209 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "noise.h"
+
+namespace {
+
+simd::InstructionSet const kInstructionSets[] = {
+    simd::InstructionSet::kScalar, simd::InstructionSet::kSSE2, simd::InstructionSet::kAVX2,
+    simd::InstructionSet::kAVX512,
+};
+
+/// @brief Random points in structure-of-arrays order, w spanning the offsets
+///     the asteroid meshes use
+struct NoisePoints
+{
+    explicit NoisePoints(size_t count)
+        : x(count)
+        , y(count)
+        , z(count)
+        , w(count)
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> position(-2.0f, 2.0f);
+        std::uniform_real_distribution<float> offset(0.0f, 10000.0f);
+        for (size_t ii = 0; ii < count; ++ii) {
+            x[ii] = position(rng);
+            y[ii] = position(rng);
+            z[ii] = position(rng);
+            w[ii] = ii % 2 == 0 ? position(rng) : offset(rng);
+        }
+    }
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> w;
+};
+
+}  // anonymous namespace
+
+TEST_CASE("batched simplex noise")
+{
+    GIVEN("points spread over many noise cells, in a count that leaves a remainder")
+    {
+        size_t const count = 1003;
+        NoisePoints const points(count);
+
+        for (auto const isa : kInstructionSets) {
+            if (isa > simd::best_instruction_set()) {
+                continue;
+            }
+            INFO("instruction set: " << simd::instruction_set_name(isa));
+
+            WHEN("single octave noise is evaluated in batches")
+            {
+                std::vector<float> out(count, 0.0f);
+                SimplexNoiseData data = {};
+                data.tables = &simplex_noise_tables();
+                data.coords[0] = points.x.data();
+                data.coords[1] = points.y.data();
+                data.coords[2] = points.z.data();
+                data.coords[3] = points.w.data();
+                data.scale = 1.0f;
+                data.weight = 1.0f;
+                data.out = out.data();
+                simplex_noise(data, isa, 0, count);
+
+                THEN("it matches the scalar noise")
+                {
+                    for (size_t ii = 0; ii < count; ++ii) {
+                        INFO("point " << ii);
+                        float const expected = SimplexNoise1234::noise(
+                            points.x[ii], points.y[ii], points.z[ii], points.w[ii]);
+                        REQUIRE(out[ii] == Approx(expected).epsilon(0.0).margin(1.0e-4));
+                    }
+                }
+            }
+            WHEN("noise octaves are evaluated in batches")
+            {
+                NoiseOctaves<4> const octaves(0.9f);
+                std::vector<float> out(count);
+                octaves(points.x.data(), points.y.data(), points.z.data(), points.w.data(), count,
+                        out.data(), isa);
+
+                THEN("they match the scalar octaves")
+                {
+                    for (size_t ii = 0; ii < count; ++ii) {
+                        INFO("point " << ii);
+                        float const expected =
+                            octaves(points.x[ii], points.y[ii], points.z[ii], points.w[ii]);
+                        REQUIRE(out[ii] == Approx(expected).epsilon(0.0).margin(1.0e-4));
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("simplex noise derivatives")
+{
+    GIVEN("points away from the huge offsets, where finite differences are accurate")
+    {
+        size_t const count = 203;
+        NoisePoints const points(count);
+
+        THEN("the analytic derivatives match central differences")
+        {
+            float const h = 1.0e-3f;
+            for (size_t ii = 0; ii < count; ii += 2) {
+                INFO("point " << ii);
+                float p[4] = {points.x[ii], points.y[ii], points.z[ii], points.w[ii]};
+                float gradient[4];
+                float const n = SimplexNoise1234::noise(p[0], p[1], p[2], p[3], gradient);
+                REQUIRE(n == SimplexNoise1234::noise(p[0], p[1], p[2], p[3]));
+                for (size_t axis = 0; axis < 4; ++axis) {
+                    INFO("axis " << axis);
+                    float hi[4] = {p[0], p[1], p[2], p[3]};
+                    float lo[4] = {p[0], p[1], p[2], p[3]};
+                    hi[axis] += h;
+                    lo[axis] -= h;
+                    float const difference = (SimplexNoise1234::noise(hi[0], hi[1], hi[2], hi[3]) -
+                                              SimplexNoise1234::noise(lo[0], lo[1], lo[2], lo[3])) /
+                                             (hi[axis] - lo[axis]);
+                    REQUIRE(gradient[axis] == Approx(difference).epsilon(0.0).margin(2.0e-2));
+                }
+            }
+        }
+    }
+    GIVEN("points spread over many noise cells")
+    {
+        size_t const count = 1003;
+        NoisePoints const points(count);
+        NoiseOctaves<4> const octaves(0.9f);
+
+        for (auto const isa : kInstructionSets) {
+            if (isa > simd::best_instruction_set()) {
+                continue;
+            }
+            INFO("instruction set: " << simd::instruction_set_name(isa));
+
+            WHEN("noise octaves and their derivatives are evaluated in batches")
+            {
+                std::vector<float> out(count);
+                std::vector<float> gradients(4 * count);
+                float* const gradient[4] = {&gradients[0], &gradients[count], &gradients[2 * count],
+                                            &gradients[3 * count]};
+                octaves(points.x.data(), points.y.data(), points.z.data(), points.w.data(), count,
+                        out.data(), gradient, isa);
+
+                THEN("they match the scalar octaves")
+                {
+                    for (size_t ii = 0; ii < count; ++ii) {
+                        INFO("point " << ii);
+                        float expected_gradient[4];
+                        float const expected = octaves(points.x[ii], points.y[ii], points.z[ii],
+                                                       points.w[ii], expected_gradient);
+                        REQUIRE(out[ii] == Approx(expected).epsilon(0.0).margin(1.0e-4));
+                        for (size_t axis = 0; axis < 4; ++axis) {
+                            REQUIRE(gradient[axis][ii] ==
+                                    Approx(expected_gradient[axis]).epsilon(0.0).margin(1.0e-3));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("batched simplex noise benchmark", "[.][benchmark]")
+{
+    size_t const count = 1 << 16;
+    int const repetitions = 10;
+    NoisePoints const points(count);
+    NoiseOctaves<4> const octaves(0.9f);
+    std::vector<float> out(count);
+
+    double best = 1.0e9;
+    for (int rep = 0; rep < repetitions; ++rep) {
+        auto const start = std::chrono::high_resolution_clock::now();
+        for (size_t ii = 0; ii < count; ++ii) {
+            out[ii] = octaves(points.x[ii], points.y[ii], points.z[ii], points.w[ii]);
+        }
+        auto const end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::cout << "noise octaves, one point per call: " << best << " ms\n";
+
+    for (auto const isa : kInstructionSets) {
+        if (isa > simd::best_instruction_set()) {
+            continue;
+        }
+        best = 1.0e9;
+        for (int rep = 0; rep < repetitions; ++rep) {
+            auto const start = std::chrono::high_resolution_clock::now();
+            octaves(points.x.data(), points.y.data(), points.z.data(), points.w.data(), count,
+                    out.data(), isa);
+            auto const end = std::chrono::high_resolution_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        std::cout << "noise octaves, batched " << simd::instruction_set_name(isa) << ": " << best
+                  << " ms\n";
+    }
+}
@@ -1,37 +1,77 @@
 #include "catch.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// The null device needs no window, so Linux, which has no GPU backend, runs
+// the tests without one
+#if defined(_WIN32) || defined(__APPLE__)
+#define AK_TEST_WINDOWS 1
 #if defined(_WIN32)
 #define GLFW_EXPOSE_NATIVE_WIN32
-#elif defined(__APPLE__)
+#else
 #define GLFW_EXPOSE_NATIVE_COCOA
-#elif defined(__linux__)
-#define GLFW_EXPOSE_NATIVE_X11
 #endif
 #include <GLFW/glfw3.h>
 #include <GLFW/glfw3native.h>
+#endif
 #include <gsl/gsl>
 
 #include "graphics/graphics.h"
+#include "graphics/software-shader.h"
+#include "null/graphics-null.h"
+#include "software/graphics-software.h"
 
 namespace {
 
+#if defined(AK_TEST_WINDOWS)
 // Global initialization
 int const glfwInitialized = glfwInit();
 int const glfwTerminationRegistered = atexit(glfwTerminate);
+#endif
 
+#if defined(_WIN32)
 constexpr ak::Graphics::API kTestApi = ak::Graphics::kVulkan;
+#else
+constexpr ak::Graphics::API kTestApi = ak::Graphics::kNull;
+#endif
 
-void* native_window(GLFWwindow* const window)
+/// A small OS window to create swap chains for, where the platform has windows
+class TestWindow
 {
+   public:
+#if defined(AK_TEST_WINDOWS)
+    TestWindow()
+    {
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        _window = glfwCreateWindow(10, 10, "Gfx Test", NULL, NULL);
+    }
+    ~TestWindow() { glfwDestroyWindow(_window); }
+
+    bool valid() const
+    {
+        return glfwInitialized && glfwTerminationRegistered == 0 && _window != nullptr;
+    }
 #if defined(_WIN32)
-    return glfwGetWin32Window(window);
-#elif defined(__APPLE__)
-    return glfwGetCocoaWindow(window);
+    void* native() const { return glfwGetWin32Window(_window); }
 #else
-#warning "Not passing native window to Gfx"
-    return nullptr;
+    void* native() const { return glfwGetCocoaWindow(_window); }
+#endif
+#else
+    bool valid() const { return true; }
+    void* native() const { return nullptr; }
 #endif
-}
+
+   private:
+#if defined(AK_TEST_WINDOWS)
+    GLFWwindow* _window = nullptr;
+#endif
+};
 
 void* native_instance(void)
 {
@@ -40,8 +80,7 @@ void* native_instance(void)
 #elif defined(__APPLE__)
     return nullptr;  // TODO: Get NSApp
 #else
-#warning "Not passing native application"
-    return nullptr;
+    return nullptr;  // headless; the null device needs no native application
 #endif
 }
 
@@ -70,13 +109,8 @@ TEST_CASE("Window interaction")
 {
     GIVEN("a graphics device and OS window")
     {
-        REQUIRE(glfwInitialized);
-        REQUIRE(glfwTerminationRegistered == 0);
-
-        // Create window
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        GLFWwindow* const window = glfwCreateWindow(10, 10, "Gfx Test", NULL, NULL);
-        REQUIRE(window);
+        TestWindow const window;
+        REQUIRE(window.valid());
 
         // Gfx initialization
         auto graphics = ak::create_graphics(kTestApi);
@@ -94,14 +128,11 @@ TEST_CASE("Window interaction")
         }
         WHEN("a swap chain is created")
         {
-            bool const result =
-                graphics->create_swap_chain(native_window(window), native_instance());
+            bool const result = graphics->create_swap_chain(window.native(), native_instance());
             THEN("the creation was successful") { REQUIRE(result); }
             THEN("the swap chain can be resized") { REQUIRE(graphics->resize(10, 10)); }
             THEN("the swap chain can be presented") { REQUIRE(graphics->present()); }
         }
-
-        glfwDestroyWindow(window);
     }
 }
 TEST_CASE("graphics command interface")
@@ -157,10 +188,9 @@ TEST_CASE("graphics command interface")
         }
         WHEN("a swap chain is created")
         {
-            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-            GLFWwindow* const window = glfwCreateWindow(10, 10, "Gfx Test", NULL, NULL);
-            REQUIRE(window);
-            REQUIRE(graphics->create_swap_chain(native_window(window), native_instance()));
+            TestWindow const window;
+            REQUIRE(window.valid());
+            REQUIRE(graphics->create_swap_chain(window.native(), native_instance()));
 
             THEN("a render pass can be begun")
             {
@@ -169,8 +199,6 @@ TEST_CASE("graphics command interface")
             }
 
             // TODO(kw): end with no begin
-
-            glfwDestroyWindow(window);
         }
     }
 }
@@ -232,12 +260,869 @@ TEST_CASE("graphics resources")
         }
         WHEN("an index buffer is created")
         {
-            size_t const data[] = {
+            uint16_t const data[] = {
                 0, 1, 2, 3,
             };
-            auto index_buffer = graphics->create_index_buffer(sizeof(data), data);
+            auto index_buffer =
+                graphics->create_index_buffer(sizeof(data), data, ak::IndexFormat::kUInt16);
             THEN("a valid buffer is returned") { REQUIRE(index_buffer); }
         }
+        WHEN("a 32-bit index buffer is created")
+        {
+            uint32_t const data[] = {
+                0, 1, 2, 70000,
+            };
+            auto index_buffer =
+                graphics->create_index_buffer(sizeof(data), data, ak::IndexFormat::kUInt32);
+            THEN("a valid buffer is returned") { REQUIRE(index_buffer); }
+        }
+    }
+}
+
+TEST_CASE("null graphics")
+{
+    ak::GraphicsNull graphics;
+    REQUIRE(graphics.create_swap_chain(nullptr, nullptr));
+    uint16_t const indices[] = {0, 1, 2, 2, 1, 3};
+    auto const index_buffer =
+        graphics.create_index_buffer(sizeof(indices), indices, ak::IndexFormat::kUInt16);
+    size_t const half_upload = ak::GraphicsNull::kUploadBufferSize / 2;
+
+    GIVEN("a recorded command buffer")
+    {
+        auto* const command_buffer =
+            static_cast<ak::CommandBufferNull*>(graphics.command_buffer());
+        REQUIRE(command_buffer);
+        auto* const constants = static_cast<float*>(graphics.get_upload_data(64, 256));
+        REQUIRE(constants);
+        REQUIRE(command_buffer->begin_render_pass());
+        command_buffer->set_vertex_constant_data(1, constants + 4, 16);
+        command_buffer->set_index_buffer(index_buffer.get());
+        command_buffer->draw_indexed(3, 3, 10);
+        command_buffer->end_render_pass();
+
+        THEN("the commands are in memory")
+        {
+            auto const& commands = command_buffer->commands();
+            REQUIRE(commands.size() == 5);
+            REQUIRE(commands[0].type == ak::CommandTypeNull::kBeginRenderPass);
+            REQUIRE(commands[1].type == ak::CommandTypeNull::kSetVertexConstantData);
+            REQUIRE(commands[1].slot == 1);
+            REQUIRE(commands[1].size == 16);
+            REQUIRE(commands[1].upload_offset % 256 == 16);
+            REQUIRE(commands[2].object == index_buffer.get());
+            REQUIRE(commands[3].type == ak::CommandTypeNull::kDrawIndexed);
+            REQUIRE(commands[3].count == 3);
+            REQUIRE(commands[3].first_index == 3);
+            REQUIRE(commands[3].base_vertex == 10);
+            REQUIRE(commands[4].type == ak::CommandTypeNull::kEndRenderPass);
+        }
+        WHEN("it is executed")
+        {
+            REQUIRE(graphics.execute(command_buffer));
+
+            THEN("its commands are read back and it returns to the pool empty")
+            {
+                auto const stats = graphics.stats();
+                REQUIRE(stats.command_buffers == 1);
+                REQUIRE(stats.commands == 5);
+                REQUIRE(stats.draws == 1);
+                REQUIRE(stats.elements == 3);
+                REQUIRE(stats.constant_bytes == 16);
+                REQUIRE(graphics.num_available_command_buffers() ==
+                        ak::Graphics::kMaxCommandBuffers);
+                REQUIRE(command_buffer->commands().empty());
+            }
+        }
+    }
+    GIVEN("an instanced draw")
+    {
+        auto* const command_buffer =
+            static_cast<ak::CommandBufferNull*>(graphics.command_buffer());
+        REQUIRE(command_buffer);
+        auto* const instances = graphics.get_upload_data(4 * 64, 256);
+        REQUIRE(instances);
+        REQUIRE(command_buffer->begin_render_pass());
+        command_buffer->set_index_buffer(index_buffer.get());
+        command_buffer->set_instance_data(instances, 4 * 64);
+        command_buffer->draw_indexed_instanced(6, 3, 0, 10, 1);
+        command_buffer->end_render_pass();
+
+        THEN("it is recorded with its instance range")
+        {
+            auto const& commands = command_buffer->commands();
+            REQUIRE(commands.size() == 5);
+            REQUIRE(commands[2].type == ak::CommandTypeNull::kSetInstanceData);
+            REQUIRE(commands[2].size == 4 * 64);
+            REQUIRE(commands[3].type == ak::CommandTypeNull::kDrawIndexedInstanced);
+            REQUIRE(commands[3].count == 6);
+            REQUIRE(commands[3].instance_count == 3);
+            REQUIRE(commands[3].base_vertex == 10);
+            REQUIRE(commands[3].first_instance == 1);
+        }
+        WHEN("it is executed")
+        {
+            REQUIRE(graphics.execute(command_buffer));
+            THEN("it counts as one draw of every instance")
+            {
+                auto const stats = graphics.stats();
+                REQUIRE(stats.draws == 1);
+                REQUIRE(stats.elements == 6 * 3);
+                REQUIRE(stats.instances == 3);
+                REQUIRE(stats.instance_bytes == 4 * 64);
+                REQUIRE(stats.constant_bytes == 0);
+            }
+        }
+    }
+    GIVEN("an indirect draw")
+    {
+        auto* const command_buffer =
+            static_cast<ak::CommandBufferNull*>(graphics.command_buffer());
+        REQUIRE(command_buffer);
+        // Padded arguments, as a culling pass may write them
+        uint32_t const stride = sizeof(ak::DrawIndexedArguments) + 12;
+        auto* const arguments = static_cast<uint8_t*>(graphics.get_upload_data(3 * stride, 256));
+        REQUIRE(arguments);
+        ak::DrawIndexedArguments const draws[] = {
+            {6, 2, 0, 0, 0},
+            {3, 1, 3, 10, 2},
+            {6, 0, 0, 0, 0},
+        };
+        for (size_t ii = 0; ii < 3; ++ii) {
+            memcpy(arguments + ii * stride, &draws[ii], sizeof(draws[ii]));
+        }
+        REQUIRE(command_buffer->begin_render_pass());
+        command_buffer->set_index_buffer(index_buffer.get());
+        command_buffer->draw_indexed_indirect(arguments, 3, stride);
+        command_buffer->end_render_pass();
+
+        THEN("it is recorded as one command")
+        {
+            auto const& commands = command_buffer->commands();
+            REQUIRE(commands.size() == 4);
+            REQUIRE(commands[2].type == ak::CommandTypeNull::kDrawIndexedIndirect);
+            REQUIRE(commands[2].count == 3);
+            REQUIRE(commands[2].stride == stride);
+            REQUIRE(commands[2].upload_offset % 256 == 0);
+        }
+        WHEN("it is executed")
+        {
+            REQUIRE(graphics.execute(command_buffer));
+            THEN("each of its arguments counts as a draw")
+            {
+                auto const stats = graphics.stats();
+                REQUIRE(stats.commands == 4);
+                REQUIRE(stats.draws == 3);
+                REQUIRE(stats.elements == 6 * 2 + 3);
+                REQUIRE(stats.instances == 3);
+                REQUIRE(stats.argument_bytes == 3 * sizeof(ak::DrawIndexedArguments));
+            }
+        }
+    }
+    GIVEN("an indirect draw on a device where indirect draws start at instance 0")
+    {
+        ak::GraphicsNull basic(false);
+        REQUIRE(basic.create_swap_chain(nullptr, nullptr));
+        auto const basic_index_buffer =
+            basic.create_index_buffer(sizeof(indices), indices, ak::IndexFormat::kUInt16);
+        auto* const command_buffer = static_cast<ak::CommandBufferNull*>(basic.command_buffer());
+        REQUIRE(command_buffer);
+        auto* const arguments = static_cast<ak::DrawIndexedArguments*>(
+            basic.get_upload_data(2 * sizeof(ak::DrawIndexedArguments), 256));
+        REQUIRE(arguments);
+        arguments[0] = {6, 2, 0, 0, 0};
+        arguments[1] = {3, 1, 3, 10, 2};
+        REQUIRE(command_buffer->begin_render_pass());
+        command_buffer->set_index_buffer(basic_index_buffer.get());
+        command_buffer->draw_indexed_indirect(arguments, 2, sizeof(ak::DrawIndexedArguments));
+        command_buffer->end_render_pass();
+
+        THEN("the draws are recorded directly, starting at their own instances")
+        {
+            auto const& commands = command_buffer->commands();
+            REQUIRE(commands.size() == 5);
+            REQUIRE(commands[2].type == ak::CommandTypeNull::kDrawIndexedInstanced);
+            REQUIRE(commands[2].instance_count == 2);
+            REQUIRE(commands[3].type == ak::CommandTypeNull::kDrawIndexedInstanced);
+            REQUIRE(commands[3].first_index == 3);
+            REQUIRE(commands[3].base_vertex == 10);
+            REQUIRE(commands[3].first_instance == 2);
+        }
+        WHEN("it is executed")
+        {
+            REQUIRE(basic.execute(command_buffer));
+            THEN("the draws and instances are the same")
+            {
+                auto const stats = basic.stats();
+                REQUIRE(stats.draws == 2);
+                REQUIRE(stats.instances == 3);
+                REQUIRE(stats.argument_bytes == 0);
+            }
+        }
+    }
+    GIVEN("render pass command buffers recorded on several threads")
+    {
+        size_t const num_threads = 4;
+        std::vector<ak::CommandBuffer*> pass_buffers(num_threads);
+        std::vector<std::thread> threads;
+        for (size_t ii = 0; ii < num_threads; ++ii) {
+            threads.emplace_back([&, ii] {
+                auto* const buffer = graphics.render_pass_command_buffer();
+                if (buffer == nullptr) {
+                    return;
+                }
+                // Small allocations share the buffer's block of upload memory
+                auto* const first = static_cast<uint8_t*>(buffer->get_upload_data(16, 256));
+                auto* const second = static_cast<uint8_t*>(buffer->get_upload_data(16, 256));
+                if (first != nullptr && second == first + 256) {
+                    buffer->set_vertex_constant_data(0, second, 16);
+                }
+                buffer->set_index_buffer(index_buffer.get());
+                buffer->draw_indexed(3, 0, static_cast<int32_t>(ii));
+                pass_buffers[ii] = buffer;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (auto const* const buffer : pass_buffers) {
+            REQUIRE(buffer);
+        }
+        auto* const command_buffer =
+            static_cast<ak::CommandBufferNull*>(graphics.command_buffer());
+        REQUIRE(command_buffer);
+        REQUIRE(command_buffer->execute_render_pass(pass_buffers.data(), num_threads));
+
+        THEN("the primary buffer runs them in order inside one render pass")
+        {
+            auto const& commands = command_buffer->commands();
+            REQUIRE(commands.size() == num_threads + 2);
+            REQUIRE(commands.front().type == ak::CommandTypeNull::kBeginRenderPass);
+            for (size_t ii = 0; ii < num_threads; ++ii) {
+                REQUIRE(commands[ii + 1].type == ak::CommandTypeNull::kExecuteCommands);
+                REQUIRE(commands[ii + 1].object == pass_buffers[ii]);
+                auto const& pass_commands =
+                    static_cast<ak::CommandBufferNull const*>(pass_buffers[ii])->commands();
+                REQUIRE(pass_commands.size() == 3);
+                REQUIRE(pass_commands.back().base_vertex == static_cast<int32_t>(ii));
+            }
+            REQUIRE(commands.back().type == ak::CommandTypeNull::kEndRenderPass);
+        }
+        WHEN("it is executed")
+        {
+            REQUIRE(graphics.execute(command_buffer));
+            THEN("every buffer's commands are read back and all return to the pool")
+            {
+                auto const stats = graphics.stats();
+                REQUIRE(stats.command_buffers == num_threads + 1);
+                REQUIRE(stats.commands == 3 * num_threads + num_threads + 2);
+                REQUIRE(stats.draws == num_threads);
+                REQUIRE(stats.constant_bytes == 16 * num_threads);
+                REQUIRE(graphics.num_available_command_buffers() ==
+                        ak::Graphics::kMaxCommandBuffers);
+            }
+        }
+    }
+    GIVEN("several command buffers")
+    {
+        ak::CommandBuffer* command_buffers[] = {graphics.command_buffer(),
+                                                graphics.command_buffer()};
+        for (auto* const command_buffer : command_buffers) {
+            REQUIRE(command_buffer);
+            REQUIRE(command_buffer->begin_render_pass());
+            command_buffer->draw(3);
+            command_buffer->end_render_pass();
+        }
+        WHEN("they are executed as a batch")
+        {
+            REQUIRE(graphics.execute(command_buffers, 2));
+            THEN("they are all executed and return to the pool")
+            {
+                auto const stats = graphics.stats();
+                REQUIRE(stats.command_buffers == 2);
+                REQUIRE(stats.draws == 2);
+                REQUIRE(graphics.num_available_command_buffers() ==
+                        ak::Graphics::kMaxCommandBuffers);
+            }
+        }
+    }
+    GIVEN("a command buffer held open")
+    {
+        auto* const held = graphics.command_buffer();
+        REQUIRE(held);
+
+        THEN("the others can still be used over and over")
+        {
+            for (int ii = 0; ii < 4 * ak::Graphics::kMaxCommandBuffers; ++ii) {
+                auto* const command_buffer = graphics.command_buffer();
+                REQUIRE(command_buffer);
+                REQUIRE(command_buffer != held);
+                REQUIRE(graphics.execute(command_buffer));
+            }
+            REQUIRE(graphics.num_available_command_buffers() ==
+                    ak::Graphics::kMaxCommandBuffers - 1);
+        }
+        THEN("upload data allocated while it is open is not handed out again")
+        {
+            void* const first = graphics.get_upload_data(half_upload, 256);
+            REQUIRE(first);
+            REQUIRE(graphics.get_upload_data(half_upload, 256));
+            REQUIRE(graphics.get_upload_data(half_upload, 256) == nullptr);
+
+            AND_WHEN("it has been executed")
+            {
+                REQUIRE(graphics.execute(held));
+                THEN("the upload buffer wraps around")
+                {
+                    REQUIRE(graphics.get_upload_data(half_upload, 256) == first);
+                }
+            }
+        }
+    }
+    GIVEN("no open command buffers")
+    {
+        THEN("upload data is aligned and wraps around as it runs out")
+        {
+            auto* const first = static_cast<uint8_t*>(graphics.get_upload_data(1, 256));
+            auto* const second = static_cast<uint8_t*>(graphics.get_upload_data(1, 1024));
+            REQUIRE(second - first == 1024);
+            REQUIRE(graphics.get_upload_data(half_upload, 256));
+            REQUIRE(graphics.get_upload_data(half_upload, 256) == first);
+        }
+    }
+}
+
+/// Vertex with a clip space position and a color to interpolate
+struct ColorVertex
+{
+    float position[4];
+    float color[4];
+};
+
+ak::InputLayout const kColorVertexLayout[] = {
+    {"POSITION", 0, ak::VertexFormat::kFloat4, ak::InputRate::kPerVertex},
+    {"COLOR", 1, ak::VertexFormat::kFloat4, ak::InputRate::kPerVertex},
+    ak::kEndLayout,
+};
+
+ak::SoftwareVertexShader const kColorVertexShader = {
+    [](void const* const* /*constants*/, float const (*attributes)[4],
+       ak::SoftwareVertex* vertex) {
+        std::copy_n(attributes[0], 4, vertex->position);
+        std::copy_n(attributes[1], 4, vertex->varyings);
+    },
+    4,
+};
+ak::SoftwarePixelShader const kColorPixelShader = {
+    [](void const* /*constants*/, float const* varyings, float* color) {
+        std::copy_n(varyings, 4, color);
+    },
+};
+
+constexpr uint32_t kClearRgba8 = 0xffffbf00;
+constexpr uint32_t kRedRgba8 = 0xff0000ff;
+constexpr uint32_t kGreenRgba8 = 0xff00ff00;
+constexpr float kRed[] = {1.0f, 0.0f, 0.0f, 1.0f};
+constexpr float kGreen[] = {0.0f, 1.0f, 0.0f, 1.0f};
+
+/// @brief A vertex at a position in pixels from the top left, with depth `z`
+ColorVertex pixel_vertex(ak::GraphicsSoftware const& graphics, float const x, float const y,
+                         float const z, float const (&color)[4])
+{
+    ColorVertex vertex = {
+        {2.0f * x / static_cast<float>(graphics.width()) - 1.0f,
+         1.0f - 2.0f * y / static_cast<float>(graphics.height()), z, 1.0f},
+        {color[0], color[1], color[2], color[3]},
+    };
+    return vertex;
+}
+
+/// @brief Draws a triangle list in one render pass, presents it and reads the
+///     frame back
+std::vector<uint32_t> render(ak::GraphicsSoftware* const graphics,
+                             std::vector<ColorVertex> const& vertices)
+{
+    auto const render_state = graphics->create_render_state({
+        {&kColorVertexShader, sizeof(kColorVertexShader)},
+        {&kColorPixelShader, sizeof(kColorPixelShader)},
+        kColorVertexLayout,
+        "Color",
+    });
+    auto const vertex_buffer = graphics->create_vertex_buffer(
+        static_cast<uint32_t>(vertices.size() * sizeof(ColorVertex)), vertices.data());
+    auto* const command_buffer = graphics->command_buffer();
+    REQUIRE(command_buffer);
+    REQUIRE(command_buffer->begin_render_pass());
+    command_buffer->set_render_state(render_state.get());
+    command_buffer->set_vertex_buffer(vertex_buffer.get());
+    command_buffer->draw(static_cast<uint32_t>(vertices.size()));
+    command_buffer->end_render_pass();
+    REQUIRE(graphics->execute(command_buffer));
+    REQUIRE(graphics->present());
+
+    std::vector<uint32_t> image;
+    graphics->read_back(&image);
+    REQUIRE(image.size() == size_t(graphics->width()) * size_t(graphics->height()));
+    return image;
+}
+
+/// @brief Pixels of `image` that are `color`
+size_t count_pixels(std::vector<uint32_t> const& image, uint32_t const color)
+{
+    return static_cast<size_t>(std::count(image.begin(), image.end(), color));
+}
+
+TEST_CASE("software graphics")
+{
+    // Not a multiple of the tile size, or of the four pixels rasterized at once
+    int const width = 203;
+    int const height = 150;
+    ak::GraphicsSoftware graphics;
+    REQUIRE(graphics.api_type() == ak::Graphics::kSoftware);
+    REQUIRE(graphics.create_swap_chain(nullptr, nullptr));
+    REQUIRE(graphics.resize(width, height));
+
+    GIVEN("an empty render pass")
+    {
+        auto const image = render(&graphics, {});
+        THEN("the frame is cleared") { REQUIRE(count_pixels(image, kClearRgba8) == image.size()); }
+    }
+    GIVEN("a rectangle of two triangles across several tiles")
+    {
+        // The second triangle is closer, so a pixel on the shared edge covered
+        // by both would be shaded twice
+        float const left = 10.0f;
+        float const top = 20.0f;
+        float const right = 130.0f;
+        float const bottom = 90.0f;
+        std::vector<ColorVertex> vertices = {
+            pixel_vertex(graphics, left, top, 0.5f, kRed),
+            pixel_vertex(graphics, right, top, 0.5f, kRed),
+            pixel_vertex(graphics, right, bottom, 0.5f, kRed),
+            pixel_vertex(graphics, left, top, 0.6f, kGreen),
+            pixel_vertex(graphics, right, bottom, 0.6f, kGreen),
+            pixel_vertex(graphics, left, bottom, 0.6f, kGreen),
+        };
+        auto const image = render(&graphics, vertices);
+
+        THEN("every pixel inside is shaded exactly once and none outside")
+        {
+            size_t const area = size_t(right - left) * size_t(bottom - top);
+            REQUIRE(graphics.raster_stats().triangles == 2);
+            REQUIRE(graphics.raster_stats().pixels == area);
+            REQUIRE(count_pixels(image, kClearRgba8) == image.size() - area);
+            REQUIRE(image[size_t(top) * width + size_t(right) - 1] == kRedRgba8);
+            REQUIRE(image[size_t(bottom - 1) * width + size_t(left)] == kGreenRgba8);
+            REQUIRE(image[size_t(top - 1) * width + size_t(left)] == kClearRgba8);
+            REQUIRE(image[size_t(top) * width + size_t(right)] == kClearRgba8);
+        }
+        AND_WHEN("each triangle is recorded into its own render pass command buffer")
+        {
+            auto const render_state = graphics.create_render_state({
+                {&kColorVertexShader, sizeof(kColorVertexShader)},
+                {&kColorPixelShader, sizeof(kColorPixelShader)},
+                kColorVertexLayout,
+                "Color",
+            });
+            std::unique_ptr<ak::Buffer> vertex_buffers[2];
+            ak::CommandBuffer* pass_buffers[2] = {};
+            for (size_t ii = 0; ii < 2; ++ii) {
+                vertex_buffers[ii] = graphics.create_vertex_buffer(3 * sizeof(ColorVertex),
+                                                                   vertices.data() + 3 * ii);
+                pass_buffers[ii] = graphics.render_pass_command_buffer();
+                REQUIRE(pass_buffers[ii]);
+            }
+            // Recorded out of order, run in order
+            for (size_t ii = 2; ii-- > 0;) {
+                pass_buffers[ii]->set_render_state(render_state.get());
+                pass_buffers[ii]->set_vertex_buffer(vertex_buffers[ii].get());
+                pass_buffers[ii]->draw(3);
+            }
+            auto* const command_buffer = graphics.command_buffer();
+            REQUIRE(command_buffer);
+            REQUIRE(command_buffer->execute_render_pass(pass_buffers, 2));
+            REQUIRE(graphics.execute(command_buffer));
+            REQUIRE(graphics.present());
+            std::vector<uint32_t> passes;
+            graphics.read_back(&passes);
+            THEN("the frame is the same as from one buffer")
+            {
+                REQUIRE(passes == image);
+            }
+        }
+        AND_WHEN("the triangles are wound the other way")
+        {
+            std::swap(vertices[1], vertices[2]);
+            std::swap(vertices[4], vertices[5]);
+            auto const culled = render(&graphics, vertices);
+            THEN("they face away and are culled")
+            {
+                REQUIRE(count_pixels(culled, kClearRgba8) == culled.size());
+            }
+        }
+    }
+    GIVEN("overlapping triangles at different depths")
+    {
+        auto const triangle = [&](float const z, float const (&color)[4]) {
+            return std::vector<ColorVertex>{
+                pixel_vertex(graphics, 0.0f, 0.0f, z, color),
+                pixel_vertex(graphics, 200.0f, 0.0f, z, color),
+                pixel_vertex(graphics, 0.0f, 140.0f, z, color),
+            };
+        };
+        auto const near_triangle = triangle(0.75f, kGreen);
+        auto const far_triangle = triangle(0.25f, kRed);
+        std::vector<ColorVertex> far_first = far_triangle;
+        far_first.insert(far_first.end(), near_triangle.begin(), near_triangle.end());
+        std::vector<ColorVertex> near_first = near_triangle;
+        near_first.insert(near_first.end(), far_triangle.begin(), far_triangle.end());
+
+        THEN("the one with the greater depth is drawn in either order")
+        {
+            auto const image = render(&graphics, far_first);
+            REQUIRE(count_pixels(image, kRedRgba8) == 0);
+            REQUIRE(count_pixels(image, kGreenRgba8) > 0);
+            REQUIRE(render(&graphics, near_first) == image);
+        }
+    }
+    GIVEN("a triangle with a vertex behind the eye")
+    {
+        // Clipped, it runs from the first two vertices down off the screen
+        std::vector<ColorVertex> vertices = {
+            pixel_vertex(graphics, 20.0f, 40.0f, 0.5f, kGreen),
+            pixel_vertex(graphics, 180.0f, 40.0f, 0.5f, kGreen),
+            {{0.0f, -2.0f, 0.5f, -0.1f}, {0.0f, 1.0f, 0.0f, 1.0f}},
+        };
+        THEN("it is clipped to the near plane and its visible part drawn")
+        {
+            auto const image = render(&graphics, vertices);
+            REQUIRE(count_pixels(image, kGreenRgba8) > 0);
+            REQUIRE(count_pixels(image, kGreenRgba8) + count_pixels(image, kClearRgba8) ==
+                    image.size());
+        }
+    }
+    GIVEN("many random triangles")
+    {
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> position(-1.5f, 1.5f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<ColorVertex> vertices(3 * 3000);
+        for (auto& vertex : vertices) {
+            float const w = 0.5f + unit(generator);
+            vertex = {{position(generator) * w, position(generator) * w, unit(generator) * w, w},
+                      {unit(generator), unit(generator), unit(generator), 1.0f}};
+        }
+
+        THEN("one thread draws the same frame as several")
+        {
+            ak::GraphicsSoftware single(1);
+            ak::GraphicsSoftware multiple(4);
+            for (auto* const device : {&single, &multiple}) {
+                REQUIRE(device->create_swap_chain(nullptr, nullptr));
+                REQUIRE(device->resize(width, height));
+            }
+            auto const image = render(&single, vertices);
+            REQUIRE(render(&multiple, vertices) == image);
+            REQUIRE(count_pixels(image, kClearRgba8) < image.size());
+        }
+    }
+    GIVEN("instances of a triangle moved by per-instance offsets")
+    {
+        // The color vertex with a clip space offset per instance
+        ak::InputLayout const layout[] = {
+            {"POSITION", 0, ak::VertexFormat::kFloat4, ak::InputRate::kPerVertex},
+            {"COLOR", 1, ak::VertexFormat::kFloat4, ak::InputRate::kPerVertex},
+            {"OFFSET", 2, ak::VertexFormat::kFloat2, ak::InputRate::kPerInstance},
+            ak::kEndLayout,
+        };
+        ak::SoftwareVertexShader const offset_shader = {
+            [](void const* const* /*constants*/, float const (*attributes)[4],
+               ak::SoftwareVertex* vertex) {
+                std::copy_n(attributes[0], 4, vertex->position);
+                vertex->position[0] += attributes[2][0] * attributes[0][3];
+                vertex->position[1] += attributes[2][1] * attributes[0][3];
+                std::copy_n(attributes[1], 4, vertex->varyings);
+            },
+            4,
+        };
+        auto const render_state = graphics.create_render_state({
+            {&offset_shader, sizeof(offset_shader)},
+            {&kColorPixelShader, sizeof(kColorPixelShader)},
+            layout,
+            "Offset",
+        });
+        std::vector<ColorVertex> const triangle = {
+            pixel_vertex(graphics, 10.0f, 10.0f, 0.5f, kGreen),
+            pixel_vertex(graphics, 50.0f, 10.0f, 0.5f, kGreen),
+            pixel_vertex(graphics, 10.0f, 50.0f, 0.5f, kGreen),
+        };
+        auto const vertex_buffer =
+            graphics.create_vertex_buffer(sizeof(ColorVertex) * 3, triangle.data());
+        uint16_t const indices[] = {0, 1, 2};
+        auto const index_buffer =
+            graphics.create_index_buffer(sizeof(indices), indices, ak::IndexFormat::kUInt16);
+        // Offsets of 0, 60 and 120 pixels to the right, of which the last two are drawn
+        auto* const offsets = static_cast<float*>(graphics.get_upload_data(6 * sizeof(float), 256));
+        REQUIRE(offsets);
+        for (int ii = 0; ii < 3; ++ii) {
+            offsets[2 * ii] = 2.0f * 60.0f * static_cast<float>(ii) / width;
+            offsets[2 * ii + 1] = 0.0f;
+        }
+        auto* const command_buffer = graphics.command_buffer();
+        REQUIRE(command_buffer);
+        REQUIRE(command_buffer->begin_render_pass());
+        command_buffer->set_render_state(render_state.get());
+        command_buffer->set_vertex_buffer(vertex_buffer.get());
+        command_buffer->set_index_buffer(index_buffer.get());
+        command_buffer->set_instance_data(offsets, 6 * sizeof(float));
+        command_buffer->draw_indexed_instanced(3, 2, 0, 0, 1);
+        command_buffer->end_render_pass();
+        REQUIRE(graphics.execute(command_buffer));
+        REQUIRE(graphics.present());
+        std::vector<uint32_t> image;
+        graphics.read_back(&image);
+
+        THEN("each instance is drawn where its offset puts it")
+        {
+            std::vector<ColorVertex> moved;
+            for (float const x : {60.0f, 120.0f}) {
+                for (auto const& vertex : triangle) {
+                    auto copy = vertex;
+                    copy.position[0] += 2.0f * x / width;
+                    moved.push_back(copy);
+                }
+            }
+            REQUIRE(render(&graphics, moved) == image);
+            REQUIRE(image[15 * width + 15] == kClearRgba8);
+            REQUIRE(image[15 * width + 75] == kGreenRgba8);
+            REQUIRE(image[15 * width + 135] == kGreenRgba8);
+        }
+        AND_WHEN("the instances are drawn by indirect arguments")
+        {
+            // One draw per instance, around a draw of no instances
+            ak::DrawIndexedArguments const draws[] = {
+                {3, 1, 0, 0, 2},
+                {3, 0, 0, 0, 0},
+                {3, 1, 0, 0, 1},
+            };
+            auto* const arguments = graphics.get_upload_data(sizeof(draws), 256);
+            REQUIRE(arguments);
+            memcpy(arguments, draws, sizeof(draws));
+            auto* const indirect_buffer = graphics.command_buffer();
+            REQUIRE(indirect_buffer);
+            REQUIRE(indirect_buffer->begin_render_pass());
+            indirect_buffer->set_render_state(render_state.get());
+            indirect_buffer->set_vertex_buffer(vertex_buffer.get());
+            indirect_buffer->set_index_buffer(index_buffer.get());
+            indirect_buffer->set_instance_data(offsets, 6 * sizeof(float));
+            indirect_buffer->draw_indexed_indirect(arguments, 3,
+                                                   sizeof(ak::DrawIndexedArguments));
+            indirect_buffer->end_render_pass();
+            REQUIRE(graphics.execute(indirect_buffer));
+            REQUIRE(graphics.present());
+            std::vector<uint32_t> indirect;
+            graphics.read_back(&indirect);
+
+            THEN("the frame matches the instanced draw")
+            {
+                REQUIRE(indirect == image);
+                REQUIRE(graphics.stats().draws == 1 + 3);
+            }
+        }
+    }
+}
+
+TEST_CASE("software rasterizer benchmark", "[.][benchmark]")
+{
+    // A 1080p grid of small indexed triangles, about the size of distant
+    // asteroids, drawn in many draw calls
+    int const width = 1920;
+    int const height = 1080;
+    int const cell = 4;
+    ak::GraphicsSoftware graphics;
+    REQUIRE(graphics.create_swap_chain(nullptr, nullptr));
+    REQUIRE(graphics.resize(width, height));
+
+    std::vector<ColorVertex> vertices;
+    int const columns = width / cell + 1;
+    int const rows = height / cell + 1;
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            float const color[] = {float(x % 2), float(y % 2), 0.5f, 1.0f};
+            vertices.push_back(pixel_vertex(graphics, float(x * cell), float(y * cell),
+                                            0.5f, {color[0], color[1], color[2], color[3]}));
+        }
+    }
+    std::vector<uint32_t> indices;
+    for (int y = 0; y + 1 < rows; ++y) {
+        for (int x = 0; x + 1 < columns; ++x) {
+            auto const corner = static_cast<uint32_t>(y * columns + x);
+            auto const below = corner + static_cast<uint32_t>(columns);
+            indices.insert(indices.end(),
+                           {corner, corner + 1, below + 1, corner, below + 1, below});
+        }
+    }
+    auto const render_state = graphics.create_render_state({
+        {&kColorVertexShader, sizeof(kColorVertexShader)},
+        {&kColorPixelShader, sizeof(kColorPixelShader)},
+        kColorVertexLayout,
+        "Color",
+    });
+    auto const vertex_buffer = graphics.create_vertex_buffer(
+        static_cast<uint32_t>(vertices.size() * sizeof(ColorVertex)), vertices.data());
+    auto const index_buffer = graphics.create_index_buffer(
+        static_cast<uint32_t>(indices.size() * sizeof(uint32_t)), indices.data(),
+        ak::IndexFormat::kUInt32);
+
+    int const frames = 20;
+    uint32_t const indices_per_draw = 3 * 256;
+    auto const index_count = static_cast<uint32_t>(indices.size());
+    auto const start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        auto* const command_buffer = graphics.command_buffer();
+        REQUIRE(command_buffer);
+        command_buffer->begin_render_pass();
+        command_buffer->set_render_state(render_state.get());
+        command_buffer->set_vertex_buffer(vertex_buffer.get());
+        command_buffer->set_index_buffer(index_buffer.get());
+        for (uint32_t first = 0; first < index_count; first += indices_per_draw) {
+            command_buffer->draw_indexed(std::min(indices_per_draw, index_count - first), first,
+                                         0);
+        }
+        command_buffer->end_render_pass();
+        graphics.execute(command_buffer);
+        graphics.present();
+    }
+    auto const seconds =
+        std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    auto const& stats = graphics.raster_stats();
+    std::cout << "software rasterizer: " << stats.triangles / stats.seconds / 1.0e6
+              << " M triangles/s, " << stats.pixels / stats.seconds / 1.0e6
+              << " M pixels/s, " << frames / seconds << " frames/s on "
+              << std::thread::hardware_concurrency() << " threads\n";
+}
+
+TEST_CASE("command submission benchmark", "[.][benchmark]")
+{
+    // Measures the CPU cost of the recording interface itself, so runs on the
+    // null device on every platform
+    ak::GraphicsNull graphics;
+    REQUIRE(graphics.create_swap_chain(nullptr, nullptr));
+    std::vector<uint16_t> const indices(3 * 1024, 0);
+    auto const index_buffer = graphics.create_index_buffer(
+        static_cast<uint32_t>(indices.size() * sizeof(uint16_t)), indices.data(),
+        ak::IndexFormat::kUInt16);
+    auto const vertex_buffer = graphics.create_vertex_buffer(64, nullptr);
+    auto const render_state = graphics.create_render_state({});
+
+    int const frames = 100;
+    uint32_t const objects = 20000;
+    // Each object drawn on its own with its constants, or the objects drawn
+    // as instances in groups of `instances_per_draw` sharing a mesh, by a call
+    // per group or by one indirect call
+    auto const run = [&](char const* const name, uint32_t const instances_per_draw,
+                         bool const indirect) {
+        double record_ms = 0.0;
+        double execute_ms = 0.0;
+        for (int frame = 0; frame < frames; ++frame) {
+            auto const start = std::chrono::high_resolution_clock::now();
+            auto* const command_buffer = graphics.command_buffer();
+            REQUIRE(command_buffer);
+            command_buffer->begin_render_pass();
+            command_buffer->set_render_state(render_state.get());
+            command_buffer->set_vertex_buffer(vertex_buffer.get());
+            command_buffer->set_index_buffer(index_buffer.get());
+            if (instances_per_draw == 0) {
+                for (uint32_t ii = 0; ii < objects; ++ii) {
+                    auto* const constants = static_cast<float*>(graphics.get_upload_data(64, 256));
+                    constants[0] = static_cast<float>(ii);
+                    command_buffer->set_vertex_constant_data(1, constants, 64);
+                    command_buffer->draw_indexed(3 * (ii % 1024), 0, 0);
+                }
+            } else if (indirect) {
+                auto* const instances =
+                    static_cast<float*>(graphics.get_upload_data(objects * 64, 256));
+                auto const draw_count = (objects + instances_per_draw - 1) / instances_per_draw;
+                auto* const arguments = static_cast<ak::DrawIndexedArguments*>(
+                    graphics.get_upload_data(draw_count * sizeof(ak::DrawIndexedArguments), 256));
+                for (uint32_t ii = 0; ii < objects; ++ii) {
+                    instances[16 * ii] = static_cast<float>(ii);
+                }
+                for (uint32_t ii = 0; ii < objects; ii += instances_per_draw) {
+                    arguments[ii / instances_per_draw] = {
+                        3 * (ii % 1024), std::min(instances_per_draw, objects - ii), 0, 0, ii};
+                }
+                command_buffer->set_instance_data(instances, objects * 64);
+                command_buffer->draw_indexed_indirect(arguments, draw_count,
+                                                      sizeof(ak::DrawIndexedArguments));
+            } else {
+                auto* const instances =
+                    static_cast<float*>(graphics.get_upload_data(objects * 64, 256));
+                for (uint32_t ii = 0; ii < objects; ++ii) {
+                    instances[16 * ii] = static_cast<float>(ii);
+                }
+                command_buffer->set_instance_data(instances, objects * 64);
+                for (uint32_t ii = 0; ii < objects; ii += instances_per_draw) {
+                    command_buffer->draw_indexed_instanced(
+                        3 * (ii % 1024), std::min(instances_per_draw, objects - ii), 0, 0, ii);
+                }
+            }
+            command_buffer->end_render_pass();
+            auto const recorded = std::chrono::high_resolution_clock::now();
+            graphics.execute(command_buffer);
+            auto const end = std::chrono::high_resolution_clock::now();
+            record_ms += std::chrono::duration<double, std::milli>(recorded - start).count();
+            execute_ms += std::chrono::duration<double, std::milli>(end - recorded).count();
+        }
+        std::cout << name << " record: " << record_ms * 1.0e6 / (frames * double(objects))
+                  << " ns per object, execute: "
+                  << execute_ms * 1.0e6 / (frames * double(objects)) << " ns per object\n";
+    };
+    run("draw_indexed", 0, false);
+    run("draw_indexed_instanced", 50, false);
+    run("draw_indexed_indirect", 50, true);
+
+    // Each object drawn on its own, split across render pass command buffers
+    // recorded on `num_threads` threads at once
+    auto const run_parallel = [&](size_t const num_threads) {
+        std::vector<ak::CommandBuffer*> pass_buffers(num_threads);
+        double record_ms = 0.0;
+        for (int frame = 0; frame < frames; ++frame) {
+            auto const start = std::chrono::high_resolution_clock::now();
+            std::vector<std::thread> threads;
+            for (size_t tt = 0; tt < num_threads; ++tt) {
+                threads.emplace_back([&, tt] {
+                    auto* const buffer = graphics.render_pass_command_buffer();
+                    buffer->set_render_state(render_state.get());
+                    buffer->set_vertex_buffer(vertex_buffer.get());
+                    buffer->set_index_buffer(index_buffer.get());
+                    for (uint32_t ii = static_cast<uint32_t>(tt); ii < objects;
+                         ii += static_cast<uint32_t>(num_threads)) {
+                        auto* const constants = static_cast<float*>(buffer->get_upload_data(64));
+                        constants[0] = static_cast<float>(ii);
+                        buffer->set_vertex_constant_data(1, constants, 64);
+                        buffer->draw_indexed(3 * (ii % 1024), 0, 0);
+                    }
+                    pass_buffers[tt] = buffer;
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            auto* const command_buffer = graphics.command_buffer();
+            REQUIRE(command_buffer);
+            command_buffer->execute_render_pass(pass_buffers.data(), num_threads);
+            auto const recorded = std::chrono::high_resolution_clock::now();
+            graphics.execute(command_buffer);
+            record_ms += std::chrono::duration<double, std::milli>(recorded - start).count();
+        }
+        std::cout << "draw_indexed on " << num_threads
+                  << " threads record: " << record_ms * 1.0e6 / (frames * double(objects))
+                  << " ns per object\n";
+    };
+    for (size_t num_threads = 1; num_threads <= std::thread::hardware_concurrency();
+         num_threads *= 2) {
+        run_parallel(num_threads);
     }
 }
 